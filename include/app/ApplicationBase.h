@@ -26,6 +26,7 @@ protected:
     State m_state;
     // event loop for sending/receiving events for AMQP-CPP library
     rabbitmq::EventLoop m_eventLoop;
+    ThreadPlacementCfg m_eventLoopPlacement;
 
 protected:
     ApplicationBase();
@@ -0,0 +1,66 @@
+#ifndef MY_APP_AUTOSCALER_H
+#define MY_APP_AUTOSCALER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace app
+{
+// Decides the count of active workers by the backlog of the processors and the latency from dequeue to ack.
+// Workers are added at once when the backlog or the latency grows, they are removed one by one
+// when the load stays low for several ticks, so the count does not flap
+class Autoscaler
+{
+private:
+    uint32_t m_min;
+    uint32_t m_max;
+    // backlog per worker that is handled without scaling up
+    size_t m_queueDepth;
+    double m_targetLatency;
+    uint32_t m_scaleDownTicks;
+    uint32_t m_lowLoadTicks = 0;
+
+public:
+    Autoscaler(const uint32_t min, const uint32_t max, const size_t queueDepth,
+        const int64_t targetLatencyUs, const uint32_t scaleDownTicks);
+
+    // called once per tick, returns the new count of workers
+    uint32_t update(const uint32_t workersCount, const size_t backlog, const double averageLatencyUs);
+};
+
+inline Autoscaler::Autoscaler(const uint32_t min, const uint32_t max, const size_t queueDepth,
+    const int64_t targetLatencyUs, const uint32_t scaleDownTicks):
+    m_min(std::max<uint32_t>(min, 1)),
+    m_max(std::max(max, m_min)),
+    m_queueDepth(std::max<size_t>(queueDepth, 1)),
+    m_targetLatency(static_cast<double>(targetLatencyUs)),
+    m_scaleDownTicks(std::max<uint32_t>(scaleDownTicks, 1))
+{
+}
+
+inline uint32_t Autoscaler::update(const uint32_t workersCount, const size_t backlog, const double averageLatencyUs)
+{
+    const uint32_t workers = std::min(std::max(workersCount, m_min), m_max);
+    if (backlog > m_queueDepth * workers || averageLatencyUs > m_targetLatency)
+    {
+        m_lowLoadTicks = 0;
+        return std::min(m_max, workers + std::max<uint32_t>(workers / 2, 1));
+    }
+
+    // the remaining workers handle the load without the backlog
+    if (backlog < m_queueDepth * (workers - 1) / 2 && averageLatencyUs < m_targetLatency / 2)
+    {
+        if (++ m_lowLoadTicks >= m_scaleDownTicks)
+        {
+            m_lowLoadTicks = 0;
+            return std::max(m_min, workers - 1);
+        }
+        return workers;
+    }
+    m_lowLoadTicks = 0;
+    return workers;
+}
+} // namespace app
+
+#endif // MY_APP_AUTOSCALER_H
\ No newline at end of file
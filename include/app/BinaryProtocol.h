@@ -0,0 +1,135 @@
+#ifndef MY_APP_BINARY_PROTOCOL_H
+#define MY_APP_BINARY_PROTOCOL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "../common/Types.h"
+#include "Command.h"
+
+namespace app
+{
+// Fixed layout binary encoding of the commands, all integers are little-endian:
+//    uint8_t type
+//    int64_t id
+//    user_registered, user_renamed:  uint16_t name size, name chars
+//    user_deal, user_deal_won:       int64_t epoch seconds, int64_t amount
+//    user_connected, user_disconnected: nothing
+namespace binary
+{
+using common::Result;
+
+static constexpr size_t headerSize = sizeof(uint8_t) + sizeof(int64_t);
+static constexpr size_t nameSizeSize = sizeof(uint16_t);
+static constexpr size_t dealSize = sizeof(int64_t) + sizeof(int64_t);
+
+template<class T>
+inline T load(const char* const buf)
+{
+    T value;
+    std::memcpy(&value, buf, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    char* bytes = reinterpret_cast<char*>(&value);
+    std::reverse(bytes, bytes + sizeof(value));
+#endif
+    return value;
+}
+
+template<class T>
+inline void store(std::string& buf, T value)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    char* bytes = reinterpret_cast<char*>(&value);
+    std::reverse(bytes, bytes + sizeof(value));
+#endif
+    buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// command name references the body
+inline Result decode(const StringView& body, Command& cmd)
+{
+    if (body.size() < headerSize)
+    {
+        return Result::INVALID_FORMAT;
+    }
+    const char* const data = body.data();
+    cmd.m_type = static_cast<CommandType>(load<uint8_t>(data));
+    cmd.m_id = load<int64_t>(data + 1);
+
+    const size_t size = body.size() - headerSize;
+    const char* const payload = data + headerSize;
+    switch (cmd.m_type)
+    {
+        case CommandType::USER_REGISTERED:
+        case CommandType::USER_RENAMED:
+        {
+            if (size < nameSizeSize)
+            {
+                return Result::INVALID_FORMAT;
+            }
+            const uint16_t nameSize = load<uint16_t>(payload);
+            if (0 == nameSize || size != nameSizeSize + nameSize)
+            {
+                return Result::INVALID_FORMAT;
+            }
+            cmd.m_name = StringView(payload + nameSizeSize, nameSize);
+            return Result::SUCCESS;
+        }
+        case CommandType::USER_DEAL:
+        case CommandType::USER_DEAL_WON:
+            if (size != dealSize)
+            {
+                return Result::INVALID_FORMAT;
+            }
+            cmd.m_time = static_cast<std::time_t>(load<int64_t>(payload));
+            cmd.m_amount = load<int64_t>(payload + sizeof(int64_t));
+            return Result::SUCCESS;
+        case CommandType::USER_CONNECTED:
+        case CommandType::USER_DISCONNECTED:
+            return (0 == size) ? Result::SUCCESS : Result::INVALID_FORMAT;
+        case CommandType::UNKNOWN:
+        default:
+            break;
+    }
+    return Result::CMD_NOT_SUPPORTED;
+}
+
+// appends the encoded command to the buffer, the buffer is not changed if the command cannot be encoded
+inline Result encode(std::string& buf, const Command& cmd)
+{
+    const size_t size = buf.size();
+    store<uint8_t>(buf, static_cast<uint8_t>(cmd.m_type));
+    store<int64_t>(buf, cmd.m_id);
+    switch (cmd.m_type)
+    {
+        case CommandType::USER_REGISTERED:
+        case CommandType::USER_RENAMED:
+            if (cmd.m_name.empty() || cmd.m_name.size() > UINT16_MAX)
+            {
+                buf.resize(size);
+                return Result::INVALID_FORMAT;
+            }
+            store<uint16_t>(buf, static_cast<uint16_t>(cmd.m_name.size()));
+            buf.append(cmd.m_name.data(), cmd.m_name.size());
+            return Result::SUCCESS;
+        case CommandType::USER_DEAL:
+        case CommandType::USER_DEAL_WON:
+            store<int64_t>(buf, static_cast<int64_t>(cmd.m_time));
+            store<int64_t>(buf, cmd.m_amount);
+            return Result::SUCCESS;
+        case CommandType::USER_CONNECTED:
+        case CommandType::USER_DISCONNECTED:
+            return Result::SUCCESS;
+        case CommandType::UNKNOWN:
+        default:
+            break;
+    }
+    buf.resize(size);
+    return Result::CMD_NOT_SUPPORTED;
+}
+} // namespace binary
+} // namespace app
+
+#endif // MY_APP_BINARY_PROTOCOL_H
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef MY_APP_COMMAND_H
+#define MY_APP_COMMAND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include "../common/StringView.h"
+
+namespace app
+{
+using common::StringView;
+
+enum class CommandType : uint8_t
+{
+    UNKNOWN = 0,
+    // user_registered(id,name)
+    USER_REGISTERED = 1,
+    // user_renamed(id,name)
+    USER_RENAMED = 2,
+    // user_deal(id,time,amount)
+    USER_DEAL = 3,
+    // user_deal_won(id,time,amount)
+    USER_DEAL_WON = 4,
+    // user_connected(id)
+    USER_CONNECTED = 5,
+    // user_disconnected(id)
+    USER_DISCONNECTED = 6,
+};
+// including UNKNOWN
+static constexpr size_t commandTypesCount = 7;
+
+// typed command arguments, parsed in place without allocations.
+// The name references the message body
+struct Command
+{
+    CommandType m_type = CommandType::UNKNOWN;
+    int64_t m_id = 0;
+    StringView m_name;
+    std::time_t m_time = 0;
+    int64_t m_amount = 0;
+};
+
+inline const char* commandTypeToStr(const CommandType type)
+{
+    switch (type)
+    {
+        case CommandType::USER_REGISTERED:
+            return "user_registered";
+        case CommandType::USER_RENAMED:
+            return "user_renamed";
+        case CommandType::USER_DEAL:
+            return "user_deal";
+        case CommandType::USER_DEAL_WON:
+            return "user_deal_won";
+        case CommandType::USER_CONNECTED:
+            return "user_connected";
+        case CommandType::USER_DISCONNECTED:
+            return "user_disconnected";
+        case CommandType::UNKNOWN:
+            return "unknown";
+    }
+    return "unknown";
+}
+} // namespace app
+
+#endif // MY_APP_COMMAND_H
\ No newline at end of file
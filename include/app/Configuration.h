@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../common/Types.h"
+#include "../common/ThreadTopology.h"
 #include "../logger/LoggerFwd.h"
 
 namespace libconfig
@@ -45,6 +46,14 @@ struct RmqConsumerCfg : public RmqHandlerCfg
     Result read(const libconfig::Config& cfg, const std::string& section, logger::CategoryPtr& log);
 };
 
+// CPUs and memory policy of the threads of one role, threads.<role> section
+struct ThreadPlacementCfg : public common::ThreadPlacement
+{
+    Result read(const libconfig::Config& cfg, const std::string& section, logger::CategoryPtr& log);
+    // names and places the current thread, the effective mapping is logged
+    void apply(const std::string& name, const size_t index, logger::CategoryPtr& log) const;
+};
+
 } // namespace app
 
 #endif // MY_APP_CONFIGURATION_H
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef MY_APP_DEAL_COALESCER_H
+#define MY_APP_DEAL_COALESCER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace app
+{
+// Merges deals of the same user and time bucket, so a burst of deals is stored by one write.
+// Every deal has a token (delivery) which is passed to the write of its merged deal.
+// It is used by one processor thread, so it is not thread safe
+template<class T>
+class DealCoalescer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    struct Key
+    {
+        int64_t m_id;
+        std::time_t m_bucket;
+
+        bool operator==(const Key& key) const
+        {
+            return m_id == key.m_id && m_bucket == key.m_bucket;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<int64_t>()(key.m_id) ^ (std::hash<int64_t>()(key.m_bucket) << 1);
+        }
+    };
+
+    struct Deal
+    {
+        int64_t m_amount = 0;
+        std::vector<T> m_tokens;
+    };
+
+private:
+    std::time_t m_bucketSeconds;
+    Clock::duration m_window;
+    size_t m_maxDeals;
+
+    std::unordered_map<Key, Deal, KeyHash> m_deals;
+    // count of deals before merging
+    size_t m_dealsCount = 0;
+    // when the oldest deal is added
+    Clock::time_point m_since;
+
+public:
+    DealCoalescer(const std::time_t bucketSeconds, const Clock::duration& window, const size_t maxDeals);
+    DealCoalescer(const DealCoalescer&) = delete;
+    DealCoalescer& operator=(const DealCoalescer&) = delete;
+
+    // the deal is stored with the start time of its bucket
+    void add(const int64_t id, const std::time_t t, const int64_t amount, T&& token);
+
+    bool empty() const;
+    // the window of the oldest deal is elapsed or there are too many deals
+    bool isReady(const Clock::time_point& now) const;
+
+    // Calls the function for every merged deal and clears the coalescer:
+    //    void apply(const int64_t id, const std::time_t t, const int64_t amount, std::vector<T>&& tokens);
+    template<class Func>
+    void flush(Func&& apply);
+};
+} // namespace app
+
+#include "DealCoalescerImpl.hpp"
+
+#endif // MY_APP_DEAL_COALESCER_H
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef MY_APP_DEAL_COALESCER_IMPL_HPP
+#define MY_APP_DEAL_COALESCER_IMPL_HPP
+
+namespace app
+{
+
+template<class T>
+inline DealCoalescer<T>::DealCoalescer(const std::time_t bucketSeconds, const Clock::duration& window, const size_t maxDeals):
+    m_bucketSeconds(bucketSeconds),
+    m_window(window),
+    m_maxDeals(maxDeals)
+{}
+
+template<class T>
+inline void DealCoalescer<T>::add(const int64_t id, const std::time_t t, const int64_t amount, T&& token)
+{
+    if (m_deals.empty())
+    {
+        m_since = Clock::now();
+    }
+
+    // times before epoch are rounded down as well
+    const std::time_t offset = ((t % m_bucketSeconds) + m_bucketSeconds) % m_bucketSeconds;
+    Deal& deal = m_deals[Key{id, t - offset}];
+    deal.m_amount += amount;
+    deal.m_tokens.push_back(std::move(token));
+    ++ m_dealsCount;
+}
+
+template<class T>
+inline bool DealCoalescer<T>::empty() const
+{
+    return m_deals.empty();
+}
+
+template<class T>
+inline bool DealCoalescer<T>::isReady(const Clock::time_point& now) const
+{
+    return !m_deals.empty() && (m_dealsCount >= m_maxDeals || now - m_since >= m_window);
+}
+
+template<class T>
+template<class Func>
+inline void DealCoalescer<T>::flush(Func&& apply)
+{
+    for (auto&& deal : m_deals)
+    {
+        apply(deal.first.m_id, deal.first.m_bucket, deal.second.m_amount, std::move(deal.second.m_tokens));
+    }
+    m_deals.clear();
+    m_dealsCount = 0;
+}
+
+} // namespace app
+
+#endif // MY_APP_DEAL_COALESCER_IMPL_HPP
\ No newline at end of file
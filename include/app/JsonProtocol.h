@@ -0,0 +1,38 @@
+#ifndef MY_APP_JSON_PROTOCOL_H
+#define MY_APP_JSON_PROTOCOL_H
+
+#include <cstddef>
+#include <string>
+
+#include "../common/Types.h"
+#include "Command.h"
+
+namespace app
+{
+// JSON encoding of the commands, one object per message:
+//    {"type":"deal","id":666,"time":"2006-06-06T06:06:06","amount":9}
+// type:    registered, renamed, deal, deal_won, connected, disconnected or the text command name
+// name:    user_registered, user_renamed
+// time:    user_deal, user_deal_won; local time in %Y-%m-%dT%H:%M:%S format or epoch seconds
+// amount:  user_deal, user_deal_won
+// Keys may go in any order, unknown keys are skipped
+namespace json
+{
+using common::Result;
+
+// The body is tokenized in place without allocations: escaped name is unescaped
+// into the body and the command name references it
+Result decode(char* const body, const size_t size, Command& cmd);
+// appends the encoded command to the buffer, time is encoded as epoch seconds.
+// The buffer is not changed if the command cannot be encoded
+Result encode(std::string& buf, const Command& cmd);
+// Extracts the type and the id of the object without decoding it, the body is not modified.
+// Only the top-level keys are matched, strings and nested values are skipped by the tokenizer.
+// Returns false if the object is malformed or it has no id, type is UNKNOWN if it is not found
+bool peek(const char* const body, const size_t size, Command& cmd);
+// short name or the text command name, UNKNOWN if the type is not supported
+CommandType typeFromString(const StringView& type);
+} // namespace json
+} // namespace app
+
+#endif // MY_APP_JSON_PROTOCOL_H
\ No newline at end of file
@@ -7,12 +7,24 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
 
 #include "../common/Types.h"
+#include "../common/BoundedQueue.h"
+#include "../common/ObjectPool.h"
+#include "../common/ThreadPool.h"
+#include "../common/LatencyHistogram.h"
 #include "../logger/LoggerFwd.h"
 #include "../db/Fwd.h"
+#include "../db/Storage.h"
+#include "../rabbitmq/Acknowledger.h"
 #include "Configuration.h"
 #include "MessageParser.h"
+#include "DealCoalescer.h"
+#include "Autoscaler.h"
+#include "MessageDedup.h"
 
 namespace libconfig
 {
@@ -24,33 +36,225 @@ namespace app
 using common::State;
 using common::Result;
 
-class Logic
+// final: the parser calls the command handlers directly, so the calls are devirtualized
+class Logic final
 {
 private:
+    struct Processor;
+
+    // Delivery that is processed by a processor. It is settled once when the processor and
+    // all storage operations started by its commands are completed: acked if all of them
+    // are succeeded, rejected otherwise. The last completion returns it to the pool of the processor
+    struct Delivery
+    {
+        rabbitmq::ProcessingItemPtr m_item;
+        Processor* m_processor = nullptr;
+        // latency from dequeue to ack is measured for the autoscaling
+        std::chrono::steady_clock::time_point m_dequeueTime;
+        // the processor and every storage operation in flight
+        std::atomic<uint32_t> m_pendingCount{1};
+        std::atomic<bool> m_isFailed{false};
+        // the message id is in flight in the duplicates filter of the processor until the delivery is settled
+        bool m_isDedupStarted = false;
+
+        // the item is returned to the consumer pool
+        void reset();
+    };
+
+    // Settlements of the deliveries completed by one drain or storage batch. They are posted
+    // to the acknowledger by one task, so acks of the range are sent as one
+    struct Settlements
+    {
+        rabbitmq::AcknowledgerPtr m_acknowledger;
+        std::vector<rabbitmq::Acknowledger::Settlement> m_settlements;
+
+        void add(const rabbitmq::AcknowledgerPtr& acknowledger, const uint64_t deliveryTag, const bool isSucceeded)
+        {
+            // deliveries of another channel (after reconnect) are settled separately
+            if (acknowledger != m_acknowledger)
+            {
+                flush();
+                m_acknowledger = acknowledger;
+            }
+            m_settlements.emplace_back(deliveryTag, isSucceeded);
+        }
+
+        void flush()
+        {
+            if (m_acknowledger)
+            {
+                m_acknowledger->settle(std::move(m_settlements));
+            }
+            m_settlements.clear();
+        }
+    };
+
+    // Deals of the drained messages that are stored by one storage call. Every deal settles its deliveries
+    // (many ones if the deal is merged), so failed deals reject their deliveries only
+    struct DealBatch
+    {
+        db::Deals m_deals;
+        std::vector<Delivery*> m_deliveries;
+        // end of the deliveries of every deal
+        std::vector<size_t> m_ends;
+
+        void add(const int64_t id, const std::time_t t, const int64_t amount, Delivery* const* begin, Delivery* const* end)
+        {
+            m_deals.emplace_back(id, t, amount);
+            m_deliveries.insert(m_deliveries.end(), begin, end);
+            m_ends.push_back(m_deliveries.size());
+        }
+
+        bool empty() const
+        {
+            return m_deals.empty();
+        }
+    };
+
+    // Processor has its own queues, so processors do not contend with each other.
+    // Users are partitioned between processors by their ids. The queues are drained by a task of the pool,
+    // there is at most one such task at a time, so messages of the processor are processed in order.
+    // Control commands have their own lane which is drained first, so they do not wait for the deals backlog
+    struct Processor
+    {
+        // registered, renamed, connected, disconnected
+        common::BoundedQueue<rabbitmq::ProcessingItemPtr> m_controlQueue;
+        // deals and messages which cannot be classified
+        common::BoundedQueue<rabbitmq::ProcessingItemPtr> m_dealsQueue;
+        // the drain task is posted or running
+        std::atomic<bool> m_isScheduled{false};
+        // deliveries are in flight until their storage operations are completed
+        common::ObjectPool<Delivery> m_deliveries;
+        // deals which are not stored yet, every delivery waits for the writes of its deals
+        DealCoalescer<Delivery*> m_deals;
+        DealBatch m_dealBatch;
+        // time from the push to the queue to the start of processing in nanoseconds, since the last report
+        common::LatencyHistogram m_enqueueLatency;
+        // ids of the recently processed messages, redelivered duplicates are acked without processing.
+        // nullptr if it is disabled
+        std::unique_ptr<MessageDedup> m_dedup;
+        // deliveries settled since the last autoscaling tick
+        std::atomic<uint64_t> m_latencySumUs{0};
+        std::atomic<uint64_t> m_settledCount{0};
+
+        Processor(const size_t queueSize, const std::time_t dealBucketSeconds,
+            const std::chrono::milliseconds& dealWindow, const size_t maxCoalescedDeals):
+            m_controlQueue(queueSize),
+            m_dealsQueue(queueSize),
+            m_deliveries(queueSize),
+            m_deals(dealBucketSeconds, dealWindow, maxCoalescedDeals)
+        {}
+
+        bool tryPop(rabbitmq::ProcessingItemPtr& item)
+        {
+            return m_controlQueue.tryPop(item) || m_dealsQueue.tryPop(item);
+        }
+
+        bool empty() const
+        {
+            return m_controlQueue.empty() && m_dealsQueue.empty();
+        }
+
+        size_t size() const
+        {
+            return m_controlQueue.size() + m_dealsQueue.size();
+        }
+    };
+    typedef std::unique_ptr<Processor> ProcessorPtr;
+
+private:
+    // delivery that is processed by the current processor thread
+    static thread_local Delivery* m_currentDelivery;
+    // settlements of the current drain or storage batch, deliveries are settled at once if it is nullptr
+    static thread_local Settlements* m_currentSettlements;
+
     logger::CategoryPtr m_logger;
     State m_state = State::CREATED;
     int32_t m_loopIntervalSeconds = 60;
-    volatile bool m_loopIsRunning = false;
-    std::thread m_loopThread;
+    std::atomic<bool> m_loopIsRunning{false};
+    // leaderboards requested from the storage and not posted to the pool yet
+    std::atomic<uint32_t> m_loopFetchesCount{0};
 
     int32_t m_processorsCount = 1;
-    std::vector<std::thread> m_processingThreads;
-    volatile bool m_isProcessingThreadsRunning;
+    int32_t m_processorQueueSize = 1024;
+    // created on configure, messages are accepted between start and stop only
+    std::vector<ProcessorPtr> m_processors;
+    std::atomic<bool> m_isProcessing{false};
+
+    // processors and the logic loop share the workers, messages have the higher priority
+    int32_t m_workersCount = 2;
+    common::ThreadPool m_pool;
+    ThreadPlacementCfg m_workersPlacement;
+    // idle workers spin before they sleep, so the latency of a message after an idle period is lower
+    int32_t m_workerSpinUs = 0;
+    // p50/p99 of the enqueue-to-process latency are logged every interval, 0 disables it
+    int32_t m_latencyReportIntervalSeconds = 10;
 
-    std::queue<rabbitmq::ProcessingItem> m_processingQueue;
-    std::mutex m_processingQueueGuard;
-    std::condition_variable m_processingQueueCv;
+    // count of active workers is changed at runtime between min and max
+    bool m_isAutoscaling = false;
+    int32_t m_minWorkersCount = 1;
+    int32_t m_maxWorkersCount = 2;
+    int32_t m_autoscalingIntervalMs = 1000;
+    int32_t m_autoscalingTargetLatencyMs = 100;
+    int32_t m_autoscalingQueueDepth = 64;
+    int32_t m_scaleDownTicks = 30;
+    std::unique_ptr<Autoscaler> m_autoscaler;
+
+    // messages processed by one drain task, their deliveries are settled together
+    int32_t m_drainBatchSize = 64;
+    // deals of the drained messages are stored by one storage call
+    bool m_isDealBatching = false;
+    int32_t m_maxBatchedDeals = 1024;
+
+    // deals of a user are merged by time buckets before they are stored
+    bool m_isDealCoalescing = false;
+    int32_t m_dealWindowMs = 10;
+    int32_t m_dealBucketSeconds = 1;
+    int32_t m_maxCoalescedDeals = 1024;
+
+    // messages with the ids seen within the ttl are dropped, so replays do not change scores twice
+    bool m_isDedup = false;
+    int32_t m_dedupCapacity = 100000;
+    int32_t m_dedupTtlSeconds = 600;
 
     rabbitmq::PublisherPtr m_publisher;
     RmqHandlerCfg m_publisherCfg;
 
-    MessageParser m_parser;
+    BasicMessageParser<Logic> m_parser;
     db::StoragePtr m_storage;
 
 private:
+    // one iteration, the next one is scheduled by the pool
     void loop();
-    void loopFunc(const time_t startTime);
-    void processingThreadFunc();
+    // schedules the next iteration
+    void finishLoop(const time_t startTime);
+    void loopFunc(const time_t startTime, const db::Leaderboards& leaderboards);
+    // posts the drain task if it is not posted yet
+    void schedule(Processor& processor);
+    // processes a limited number of messages, so processors share the workers fairly
+    void drain(Processor& processor);
+    void processItem(Processor& processor, rabbitmq::ProcessingItemPtr&& item);
+    // one autoscaling tick, the next one is scheduled by the pool
+    void autoscale();
+    // logs the latency percentiles of all processors and schedules the next report
+    void scheduleLatencyReport();
+    void reportLatency();
+    // the last completion settles the delivery
+    void completeDelivery(Delivery& delivery, const Result res);
+
+    // Starts asynchronous storage operation. If it is called by a processor then
+    // the current delivery is not settled until the operation is completed,
+    // otherwise it waits for the completion
+    template<class Func>
+    Result deferDelivery(Func&& func);
+
+    // the current delivery is settled when the merged deal is stored
+    Result coalesceDeal(const int64_t id, const std::time_t t, const int64_t amount);
+    // stores all merged and batched deals of the processor
+    void flushDeals(Processor& processor);
+    // the current delivery is settled when the batch of the processor is stored
+    Result batchDeal(const int64_t id, const std::time_t t, const int64_t amount);
+    void storeDealBatch(Processor& processor);
 
 public:
     Logic();
@@ -77,7 +281,7 @@ public:
     // user_disconnected(id)
     virtual Result onUserDisconnected(const int64_t id);
 
-    Result processMessage(rabbitmq::ProcessingItem&& item);
+    Result processMessage(rabbitmq::ProcessingItemPtr&& item);
 };
 } // namespace app
 
@@ -0,0 +1,53 @@
+#ifndef MY_APP_MESSAGE_DEDUP_H
+#define MY_APP_MESSAGE_DEDUP_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../common/DedupFilter.h"
+#include "../rabbitmq/ProcessingItem.h"
+
+namespace app
+{
+// Drops redelivered duplicates of the processed messages by their ids. Id is in flight from the start
+// of processing until the delivery is settled and it is remembered only if the delivery is succeeded.
+// Redeliveries of a message whose writes are pending are held until the delivery is finished: they are acked
+// if it is succeeded and requeued once otherwise, so they are processed again if the writes fail.
+// Messages are started by the processor, deliveries may be finished by storage threads, so it is locked
+class MessageDedup
+{
+public:
+    enum class Verdict
+    {
+        // the id is in flight now, the delivery must be finished
+        PROCESS,
+        // the message is processed already, it is acked without processing
+        DUPLICATE,
+        // the message is being processed, the item is held
+        IN_FLIGHT,
+    };
+
+private:
+    std::mutex m_guard;
+    // ids of the succeeded deliveries
+    common::DedupFilter m_committed;
+    // in flight ids and their held duplicates, count of ids is limited by the count of deliveries in flight
+    std::unordered_map<std::string, std::vector<rabbitmq::ProcessingItemPtr> > m_inFlight;
+
+public:
+    MessageDedup(const size_t capacity, const common::DedupFilter::Clock::duration& ttl);
+    MessageDedup(const MessageDedup&) = delete;
+    MessageDedup& operator=(const MessageDedup&) = delete;
+
+    // the item is taken for the IN_FLIGHT verdict
+    Verdict start(rabbitmq::ProcessingItemPtr& item);
+    // Called for the PROCESS verdict only. The held duplicates are returned,
+    // they are settled as the delivery: acked if it is succeeded, requeued otherwise
+    void finish(const std::string& id, const bool isSucceeded, std::vector<rabbitmq::ProcessingItemPtr>& duplicates);
+};
+} // namespace app
+
+#endif // MY_APP_MESSAGE_DEDUP_H
\ No newline at end of file
@@ -1,8 +1,9 @@
 #ifndef MY_APP_MESSAGE_PARSER_H
 #define MY_APP_MESSAGE_PARSER_H
 
+#include <cstdint>
+#include <ctime>
 #include <functional>
-#include <unordered_map>
 #include <string>
 
 #include <amqpcpp.h>
@@ -11,14 +12,104 @@
 #include "../logger/LoggerDefines.h"
 
 #include "../common/Types.h"
+#include "../common/StringView.h"
+#include "../common/ByteScanner.h"
 
 #include "../rabbitmq/ProcessingItem.h"
 
+#include "Command.h"
+
 namespace app
 {
 using common::Result;
+using common::StringView;
+
+// Decodes messages into commands, used by all parser instantiations
+class MessageParserBase
+{
+protected:
+    // results of the commands of one message
+    struct BatchStats
+    {
+        uint32_t m_commandsCount = 0;
+        uint32_t m_failedCounts[commandTypesCount] = {};
+        // the first failure
+        Result m_result = Result::SUCCESS;
+    };
+
+protected:
+    logger::CategoryPtr m_logger;
+
+protected:
+    MessageParserBase();
+
+    static bool parseChar(const char*& it, const char* const end, const char c);
+    static bool parseTime(const char*& it, const char* const end, const char delimiter, std::time_t& t);
+    // command has the same length as the name, so only chars are compared
+    template<size_t N>
+    static bool isCommand(const StringView& command, const char (&name)[N]);
+
+    // command(args)
+    Result splitMessage(const StringView& message, StringView& command, StringView& args);
+    // the text command table, UNKNOWN if the command is not supported
+    static CommandType textCommandType(const StringView& command);
+    Result parseText(const StringView& message, Command& cmd);
+    Result parseBinary(const StringView& message, Command& cmd);
+    // the message is modified in place
+    Result parseJson(char* const message, const size_t size, Command& cmd);
+
+    static void addCommandResult(BatchStats& stats, const Command& cmd, const Result r);
+    void logBatchStats(const BatchStats& stats);
+
+    // (id,name)
+    Result parseIdName(const StringView& command, const StringView& args, Command& cmd);
+    // (id,time,amount)
+    Result parseIdTimeAmount(const StringView& command, const StringView& args, Command& cmd);
+    // (id)
+    Result parseId(const StringView& command, const StringView& args, Command& cmd);
+
+public:
+    // Extracts the user id without parsing the message, it is used for routing. All commands of a batch
+    // must belong to the same user, so they are processed in order with the other events of the user.
+    // INVALID_FORMAT if there is no id (the message fails on parsing), CMD_NOT_SUPPORTED if the batch
+    // has commands of different users
+    static Result peekUserId(const rabbitmq::ProcessingItem& item, int64_t& id);
+    // Type which selects the lane of the message: the first control command of a batch, otherwise the type
+    // of its first command. UNKNOWN if it cannot be extracted
+    static CommandType peekCommandType(const rabbitmq::ProcessingItem& item);
+};
 
-class MessageParser
+// Parser with the dispatch resolved at compile time: the handler methods are called directly,
+// so they can be inlined:
+//    Result onUserRegistered(const int64_t id, const std::string& name);
+//    Result onUserRenamed(const int64_t id, const std::string& name);
+//    Result onUserDeal(const int64_t id, const std::time_t t, const int64_t amount);
+//    Result onUserDealWon(const int64_t id, const std::time_t t, const int64_t amount);
+//    Result onUserConnected(const int64_t id);
+//    Result onUserDisconnected(const int64_t id);
+template<class Handler>
+class BasicMessageParser : public MessageParserBase
+{
+private:
+    Handler& m_handler;
+
+private:
+    Result dispatch(const Command& cmd);
+    // dispatches the command if it is parsed successfully
+    Result processCommand(const Result parseResult, const Command& cmd);
+
+public:
+    explicit BasicMessageParser(Handler& handler);
+    BasicMessageParser(const BasicMessageParser&) = delete;
+    BasicMessageParser& operator=(const BasicMessageParser&) = delete;
+
+    // Text message contains one or many newline delimited commands, they are processed in order.
+    // The message is failed if any of its commands is failed, the first failure is returned
+    Result parseMessage(rabbitmq::ProcessingItem&& item);
+};
+
+// Parser with callbacks which are registered at runtime
+class MessageParser : public BasicMessageParser<MessageParser>
 {
 private:
     typedef std::function<Result(const int64_t, const std::string&)> OnUserRegisteredCallback;
@@ -28,9 +119,6 @@ private:
     typedef std::function<Result(const int64_t)> OnUserConnectedCallback;
     typedef std::function<Result(const int64_t)> OnUserDisconnectedCallback;
 
-    typedef std::function<Result(MessageParser&, const std::string&, rabbitmq::ProcessingItem&&)> MessageProcFunc;
-    typedef std::unordered_map<std::string, MessageProcFunc> MessageProcFuncsMap;
-
 private:
     OnUserRegisteredCallback m_onUserRegisteredCallback;
     OnUserRenamedCallback m_onUserRenamedCallback;
@@ -39,48 +127,9 @@ private:
     OnUserConnectedCallback m_onUserConnectedCallback;
     OnUserDisconnectedCallback m_onUserDisconnectedCallback;
 
-    static const MessageProcFuncsMap m_messageProcFuncsMap;
-
-    logger::CategoryPtr m_logger;
-
-private:
-    template<class... Args>
-    Result getArguments(
-        const std::string& command,
-        const std::string& str,
-        const char* fmt,
-        Args... args);
-
-    // user_registered(id,name)
-    static Result processUserRegistered(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_renamed(id,name)
-    static Result processUserRenamed(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_deal(id,time,amount)
-    static Result processUserDeal(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_deal_won(id,time,amount)
-    static Result processUserDealWon(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_connected(id)
-    static Result processUserConnected(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_disconnected(id)
-    static Result processUserDisconnected(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item);
-
-    // user_registered(id,name)
-    virtual Result onUserRegistered(const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_renamed(id,name)
-    virtual Result onUserRenamed(const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_deal(id,time,amount)
-    virtual Result onUserDeal(const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_deal_won(id,time,amount)
-    virtual Result onUserDealWon(const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_connected(id)
-    virtual Result onUserConnected(const std::string& command, rabbitmq::ProcessingItem&& item);
-    // user_disconnected(id)
-    virtual Result onUserDisconnected(const std::string& command, rabbitmq::ProcessingItem&& item);
-
 public:
     MessageParser();
     ~MessageParser();
-    Result parseMessage(rabbitmq::ProcessingItem&& item);
 
     void registerOnUserRegisteredCallback(const OnUserRegisteredCallback& cb);
     void registerOnUserRenamedCallback(const OnUserRenamedCallback& cb);
@@ -90,6 +139,19 @@ public:
     void registerOnUserDisconnectedCallback(const OnUserDisconnectedCallback& cb);
     template<class T>
     void registerCallbackObject(T& obj);
+
+    // user_registered(id,name)
+    Result onUserRegistered(const int64_t id, const std::string& name);
+    // user_renamed(id,name)
+    Result onUserRenamed(const int64_t id, const std::string& name);
+    // user_deal(id,time,amount)
+    Result onUserDeal(const int64_t id, const std::time_t t, const int64_t amount);
+    // user_deal_won(id,time,amount)
+    Result onUserDealWon(const int64_t id, const std::time_t t, const int64_t amount);
+    // user_connected(id)
+    Result onUserConnected(const int64_t id);
+    // user_disconnected(id)
+    Result onUserDisconnected(const int64_t id);
 };
 
 } // namespace app
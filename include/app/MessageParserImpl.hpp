@@ -4,23 +4,114 @@
 namespace app
 {
 
-template<class... Args>
-Result MessageParser::getArguments(
-    const std::string& command,
-    const std::string& str,
-    const char* fmt,
-    Args... args)
+inline bool MessageParserBase::parseChar(const char*& it, const char* const end, const char c)
 {
-    const size_t countOfExpectedArgs = sizeof...(Args);
-    int res = sscanf(str.c_str(), fmt, std::forward<Args>(args)...);
-    if (res != countOfExpectedArgs)
+    if (it == end || *it != c)
     {
-        LOG_ERROR(m_logger, "Cannot process command '%s': invalid arguments format: "
-            "actual number of arguments[%d] does not equal to expected number of arguments[%zu]",
-            command.c_str(), res, countOfExpectedArgs);
-        return Result::INVALID_FORMAT;
+        return false;
     }
-    return Result::SUCCESS;
+    ++ it;
+    return true;
+}
+
+template<size_t N>
+inline bool MessageParserBase::isCommand(const StringView& command, const char (&name)[N])
+{
+    return 0 == std::memcmp(command.data(), name, N - 1);
+}
+
+template<class Handler>
+inline BasicMessageParser<Handler>::BasicMessageParser(Handler& handler):
+    m_handler(handler)
+{
+}
+
+template<class Handler>
+inline Result BasicMessageParser<Handler>::dispatch(const Command& cmd)
+{
+    switch (cmd.m_type)
+    {
+        case CommandType::USER_REGISTERED:
+            return m_handler.onUserRegistered(cmd.m_id, cmd.m_name.toString());
+        case CommandType::USER_RENAMED:
+            return m_handler.onUserRenamed(cmd.m_id, cmd.m_name.toString());
+        case CommandType::USER_DEAL:
+            return m_handler.onUserDeal(cmd.m_id, cmd.m_time, cmd.m_amount);
+        case CommandType::USER_DEAL_WON:
+            return m_handler.onUserDealWon(cmd.m_id, cmd.m_time, cmd.m_amount);
+        case CommandType::USER_CONNECTED:
+            return m_handler.onUserConnected(cmd.m_id);
+        case CommandType::USER_DISCONNECTED:
+            return m_handler.onUserDisconnected(cmd.m_id);
+        case CommandType::UNKNOWN:
+            break;
+    }
+    return Result::CMD_NOT_SUPPORTED;
+}
+
+template<class Handler>
+inline Result BasicMessageParser<Handler>::processCommand(const Result parseResult, const Command& cmd)
+{
+    if (Result::SUCCESS != parseResult)
+    {
+        return parseResult;
+    }
+
+    const Result r = dispatch(cmd);
+    if (Result::SUCCESS != r)
+    {
+        LOG_ERROR(m_logger, "Cannot process command '%s'. Result: %u(%s)",
+            commandTypeToStr(cmd.m_type), static_cast<uint16_t>(r), resultToStr(r));
+    }
+    return r;
+}
+
+template<class Handler>
+inline Result BasicMessageParser<Handler>::parseMessage(rabbitmq::ProcessingItem&& item)
+{
+    // the body is parsed in place
+    Command cmd;
+    switch (item.m_contentType)
+    {
+        case rabbitmq::ProcessingItem::ContentType::BINARY:
+            return processCommand(parseBinary(StringView(item.m_message), cmd), cmd);
+        case rabbitmq::ProcessingItem::ContentType::JSON:
+            return processCommand(parseJson(&item.m_message[0], item.m_message.size(), cmd), cmd);
+        case rabbitmq::ProcessingItem::ContentType::TEXT:
+            break;
+    }
+
+    BatchStats stats;
+    const char* it = item.m_message.data();
+    const char* const end = it + item.m_message.size();
+    while (it != end)
+    {
+        const char* const lineEnd = common::findByte(it, end, '\n');
+        StringView line(it, lineEnd - it);
+        it = lineEnd + (lineEnd != end);
+
+        if (!line.empty() && '\r' == line.back())
+        {
+            line = line.substr(0, line.size() - 1);
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+
+        cmd = Command();
+        addCommandResult(stats, cmd, processCommand(parseText(line, cmd), cmd));
+    }
+
+    if (0 == stats.m_commandsCount)
+    {
+        return parseText(StringView(), cmd);
+    }
+    if (stats.m_commandsCount > 1 && Result::SUCCESS != stats.m_result)
+    {
+        logBatchStats(stats);
+    }
+    return stats.m_result;
 }
 
 inline void MessageParser::registerOnUserRegisteredCallback(const OnUserRegisteredCallback& cb)
@@ -61,7 +152,7 @@ inline void MessageParser::registerCallbackObject(T& obj)
     registerOnUserRegisteredCallback(std::bind(&T::onUserRegistered, std::ref(obj), _1, _2));
     registerOnUserRenamedCallback(std::bind(&T::onUserRenamed, std::ref(obj), _1, _2));
     registerOnUserDealCallback(std::bind(&T::onUserDeal, std::ref(obj), _1, _2, _3));
-    registerOnUserDealWonCallback(std::bind(&T::onUserDeal, std::ref(obj), _1, _2, _3));
+    registerOnUserDealWonCallback(std::bind(&T::onUserDealWon, std::ref(obj), _1, _2, _3));
     registerOnUserConnectedCallback(std::bind(&T::onUserConnected, std::ref(obj), _1));
     registerOnUserDisconnectedCallback(std::bind(&T::onUserDisconnected, std::ref(obj), _1));
 }
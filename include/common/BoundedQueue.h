@@ -0,0 +1,59 @@
+#ifndef COMMON_BOUNDED_QUEUE_H
+#define COMMON_BOUNDED_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace common
+{
+// Lock-free bounded ring buffer for many producers and many consumers.
+// Every cell has a sequence number, so producers and consumers synchronize on the cell only
+// and push/pop do not wait for other threads. Capacity is rounded up to the power of two
+template<class T>
+class BoundedQueue
+{
+private:
+    static constexpr size_t cacheLineSize = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> m_sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+    };
+
+private:
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    // positions are updated by different threads, so they are padded to different cache lines.
+    // Padding is used instead of alignas since C++14 new does not support extended alignment
+    char m_pushPadding[cacheLineSize];
+    std::atomic<size_t> m_pushPosition;
+    char m_popPadding[cacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_popPosition;
+    char m_endPadding[cacheLineSize - sizeof(std::atomic<size_t>)];
+
+public:
+    explicit BoundedQueue(const size_t capacity);
+    ~BoundedQueue();
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // returns false if the queue is full, value is not moved then
+    bool tryPush(T&& value);
+    // returns false if the queue is empty
+    bool tryPop(T& value);
+
+    // approximate, it can be changed by other threads at once
+    bool empty() const;
+    // approximate, count of values which are pushed and not popped yet
+    size_t size() const;
+    size_t capacity() const;
+};
+} // namespace common
+
+#include "BoundedQueueImpl.hpp"
+
+#endif // COMMON_BOUNDED_QUEUE_H
\ No newline at end of file
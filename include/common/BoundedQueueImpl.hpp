@@ -0,0 +1,128 @@
+#ifndef COMMON_BOUNDED_QUEUE_IMPL_HPP
+#define COMMON_BOUNDED_QUEUE_IMPL_HPP
+
+namespace common
+{
+
+template<class T>
+inline BoundedQueue<T>::BoundedQueue(const size_t capacity)
+{
+    size_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    m_cells.reset(new Cell[size]);
+    m_mask = size - 1;
+    for (size_t i = 0; i < size; ++ i)
+    {
+        m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+    }
+    m_pushPosition.store(0, std::memory_order_relaxed);
+    m_popPosition.store(0, std::memory_order_relaxed);
+}
+
+template<class T>
+inline BoundedQueue<T>::~BoundedQueue()
+{
+    // values which are not popped are destroyed in place
+    for (size_t position = m_popPosition.load(std::memory_order_relaxed); ; ++ position)
+    {
+        Cell& cell = m_cells[position & m_mask];
+        if (cell.m_sequence.load(std::memory_order_acquire) != position + 1)
+        {
+            break;
+        }
+        reinterpret_cast<T*>(&cell.m_storage)->~T();
+    }
+}
+
+template<class T>
+inline bool BoundedQueue<T>::tryPush(T&& value)
+{
+    size_t position = m_pushPosition.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell& cell = m_cells[position & m_mask];
+        const size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (0 == diff)
+        {
+            if (m_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                new (&cell.m_storage) T(std::move(value));
+                cell.m_sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the cell is not popped yet
+            return false;
+        }
+        else
+        {
+            position = m_pushPosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<class T>
+inline bool BoundedQueue<T>::tryPop(T& value)
+{
+    size_t position = m_popPosition.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell& cell = m_cells[position & m_mask];
+        const size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+        if (0 == diff)
+        {
+            if (m_popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                T* const stored = reinterpret_cast<T*>(&cell.m_storage);
+                value = std::move(*stored);
+                stored->~T();
+                cell.m_sequence.store(position + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the cell is not pushed yet
+            return false;
+        }
+        else
+        {
+            position = m_popPosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<class T>
+inline bool BoundedQueue<T>::empty() const
+{
+    const size_t position = m_popPosition.load(std::memory_order_relaxed);
+    const size_t sequence = m_cells[position & m_mask].m_sequence.load(std::memory_order_acquire);
+    return sequence != position + 1;
+}
+
+template<class T>
+inline size_t BoundedQueue<T>::size() const
+{
+    // positions are read separately, so the pop position can be ahead
+    const size_t popPosition = m_popPosition.load(std::memory_order_relaxed);
+    const size_t pushPosition = m_pushPosition.load(std::memory_order_relaxed);
+    return (pushPosition > popPosition) ? std::min(pushPosition - popPosition, capacity()) : 0;
+}
+
+template<class T>
+inline size_t BoundedQueue<T>::capacity() const
+{
+    return m_mask + 1;
+}
+
+} // namespace common
+
+#endif // COMMON_BOUNDED_QUEUE_IMPL_HPP
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef COMMON_BYTE_SCANNER_H
+#define COMMON_BYTE_SCANNER_H
+
+namespace common
+{
+// Returns the first occurrence of the char in [begin, end) or end.
+// Chars are compared by 32 (AVX2, selected at runtime) or 16 (SSE2) at once
+const char* findByte(const char* begin, const char* const end, const char c);
+} // namespace common
+
+#endif // COMMON_BYTE_SCANNER_H
\ No newline at end of file
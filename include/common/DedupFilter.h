@@ -0,0 +1,55 @@
+#ifndef COMMON_DEDUP_FILTER_H
+#define COMMON_DEDUP_FILTER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace common
+{
+// Set of recently seen ids with constant memory, it is used to drop duplicates of messages.
+// Ids are kept as 64-bit fingerprints in buckets of 8 slots, so the lookup touches two cache lines.
+// An id is forgotten when its ttl is elapsed or when its bucket is full and it is the oldest one,
+// so the capacity should be a few times the count of ids received during the ttl. It is not thread safe
+class DedupFilter
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    static constexpr size_t slotsPerBucket = 8;
+
+    struct Slot
+    {
+        // 0 is an empty slot
+        uint64_t m_fingerprint = 0;
+        Clock::rep m_time = 0;
+    };
+
+private:
+    std::vector<Slot> m_slots;
+    size_t m_bucketMask;
+    Clock::rep m_ttl;
+
+private:
+    static uint64_t fingerprintOf(const std::string& id);
+    size_t bucketOf(const uint64_t fingerprint) const;
+
+public:
+    // capacity is rounded up to the power of two
+    DedupFilter(const size_t capacity, const Clock::duration& ttl);
+    DedupFilter(const DedupFilter&) = delete;
+    DedupFilter& operator=(const DedupFilter&) = delete;
+
+    // Remembers the id, returns false if it is seen within the ttl (the id is a duplicate)
+    bool insert(const std::string& id, const Clock::time_point& now = Clock::now());
+    // the id is seen within the ttl, it is not remembered
+    bool contains(const std::string& id, const Clock::time_point& now = Clock::now()) const;
+
+    size_t capacity() const;
+};
+} // namespace common
+
+#endif // COMMON_DEDUP_FILTER_H
\ No newline at end of file
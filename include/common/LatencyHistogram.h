@@ -0,0 +1,143 @@
+#ifndef COMMON_LATENCY_HISTOGRAM_H
+#define COMMON_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace common
+{
+// Log-linear histogram of non-negative values: every power of two range is split into 16 buckets,
+// so percentiles are accurate within 1/16 and recording is one relaxed increment.
+// It is written by one thread at a time and can be moved to another histogram by any thread
+class LatencyHistogram
+{
+private:
+    static constexpr uint32_t subBucketBits = 4;
+    static constexpr uint64_t subBucketsCount = 1 << subBucketBits;
+    static constexpr size_t bucketsCount = (64 - subBucketBits + 1) * subBucketsCount;
+
+    std::atomic<uint64_t> m_counts[bucketsCount];
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_max{0};
+
+private:
+    static size_t bucketIndex(const uint64_t value);
+    // the highest value of the bucket, so percentiles are not underestimated
+    static uint64_t bucketValue(const size_t index);
+
+public:
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(const int64_t value);
+    // adds the values to the histogram and clears this one
+    void moveTo(LatencyHistogram& histogram);
+
+    uint64_t count() const;
+    uint64_t max() const;
+    // value which is not exceeded by the part of the values, part is in [0, 1]. 0 if there are no values
+    uint64_t percentile(const double part) const;
+};
+
+inline LatencyHistogram::LatencyHistogram()
+{
+    for (auto&& count : m_counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+inline size_t LatencyHistogram::bucketIndex(const uint64_t value)
+{
+    if (value < subBucketsCount)
+    {
+        return static_cast<size_t>(value);
+    }
+    const uint32_t msb = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+    const uint32_t shift = msb - subBucketBits;
+    return static_cast<size_t>((shift + 1) * subBucketsCount + ((value >> shift) & (subBucketsCount - 1)));
+}
+
+inline uint64_t LatencyHistogram::bucketValue(const size_t index)
+{
+    if (index < subBucketsCount)
+    {
+        return index;
+    }
+    const uint32_t shift = static_cast<uint32_t>(index / subBucketsCount) - 1;
+    const uint64_t lowest = (subBucketsCount + index % subBucketsCount) << shift;
+    return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+inline void LatencyHistogram::record(const int64_t value)
+{
+    const uint64_t v = static_cast<uint64_t>(std::max<int64_t>(value, 0));
+    m_counts[bucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    if (v > m_max.load(std::memory_order_relaxed))
+    {
+        m_max.store(v, std::memory_order_relaxed);
+    }
+}
+
+inline void LatencyHistogram::moveTo(LatencyHistogram& histogram)
+{
+    for (size_t i = 0; i < bucketsCount; ++ i)
+    {
+        const uint64_t count = m_counts[i].exchange(0, std::memory_order_relaxed);
+        if (0 != count)
+        {
+            histogram.m_counts[i].fetch_add(count, std::memory_order_relaxed);
+            histogram.m_count.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    const uint64_t max = m_max.exchange(0, std::memory_order_relaxed);
+    if (max > histogram.m_max.load(std::memory_order_relaxed))
+    {
+        histogram.m_max.store(max, std::memory_order_relaxed);
+    }
+}
+
+inline uint64_t LatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::percentile(const double part) const
+{
+    uint64_t total = 0;
+    for (auto&& count : m_counts)
+    {
+        total += count.load(std::memory_order_relaxed);
+    }
+    if (0 == total)
+    {
+        return 0;
+    }
+
+    // rank of the value, the first one is 1
+    const double clampedPart = std::min(std::max(part, 0.0), 1.0);
+    const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(clampedPart * total + 0.5), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucketsCount; ++ i)
+    {
+        seen += m_counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return std::min(bucketValue(i), max());
+        }
+    }
+    return max();
+}
+} // namespace common
+
+#endif // COMMON_LATENCY_HISTOGRAM_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef COMMON_OBJECT_POOL_H
+#define COMMON_OBJECT_POOL_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "BoundedQueue.h"
+
+namespace common
+{
+// Pool of objects which are reused instead of being allocated per operation.
+// Objects are acquired and released by any threads, free objects are kept by the lock-free queue.
+// The object is created when the pool is exhausted and destroyed on release if the pool is full.
+// Released objects are reset by their 'void reset()' method, they keep their buffers.
+// The pool must outlive its objects
+template<class T>
+class ObjectPool
+{
+public:
+    typedef std::function<T*()> Factory;
+
+    class Deleter
+    {
+    private:
+        ObjectPool* m_pool = nullptr;
+
+    public:
+        Deleter() = default;
+        explicit Deleter(ObjectPool* pool);
+
+        void operator()(T* object) const;
+    };
+    typedef std::unique_ptr<T, Deleter> Ptr;
+
+private:
+    BoundedQueue<T*> m_free;
+    Factory m_factory;
+
+public:
+    // objects are preallocated by the factory
+    ObjectPool(const size_t capacity, Factory&& factory);
+    explicit ObjectPool(const size_t capacity);
+    ~ObjectPool();
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    Ptr acquire();
+    void release(T* object);
+};
+} // namespace common
+
+#include "ObjectPoolImpl.hpp"
+
+#endif // COMMON_OBJECT_POOL_H
\ No newline at end of file
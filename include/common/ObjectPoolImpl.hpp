@@ -0,0 +1,77 @@
+#ifndef COMMON_OBJECT_POOL_IMPL_HPP
+#define COMMON_OBJECT_POOL_IMPL_HPP
+
+namespace common
+{
+
+template<class T>
+inline ObjectPool<T>::Deleter::Deleter(ObjectPool* pool):
+    m_pool(pool)
+{}
+
+template<class T>
+inline void ObjectPool<T>::Deleter::operator()(T* object) const
+{
+    if (m_pool)
+    {
+        m_pool->release(object);
+        return ;
+    }
+    delete object;
+}
+
+template<class T>
+inline ObjectPool<T>::ObjectPool(const size_t capacity, Factory&& factory):
+    m_free(capacity),
+    m_factory(std::move(factory))
+{
+    for (size_t i = 0; i < m_free.capacity(); ++ i)
+    {
+        T* object = m_factory();
+        m_free.tryPush(std::move(object));
+    }
+}
+
+template<class T>
+inline ObjectPool<T>::ObjectPool(const size_t capacity):
+    ObjectPool(capacity, [] () -> T* { return new T(); })
+{}
+
+template<class T>
+inline ObjectPool<T>::~ObjectPool()
+{
+    T* object = nullptr;
+    while (m_free.tryPop(object))
+    {
+        delete object;
+    }
+}
+
+template<class T>
+inline typename ObjectPool<T>::Ptr ObjectPool<T>::acquire()
+{
+    T* object = nullptr;
+    if (!m_free.tryPop(object))
+    {
+        object = m_factory();
+    }
+    return Ptr(object, Deleter(this));
+}
+
+template<class T>
+inline void ObjectPool<T>::release(T* object)
+{
+    if (!object)
+    {
+        return ;
+    }
+    object->reset();
+    if (!m_free.tryPush(std::move(object)))
+    {
+        delete object;
+    }
+}
+
+} // namespace common
+
+#endif // COMMON_OBJECT_POOL_IMPL_HPP
\ No newline at end of file
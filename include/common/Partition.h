@@ -0,0 +1,24 @@
+#ifndef COMMON_PARTITION_H
+#define COMMON_PARTITION_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace common
+{
+// Maps the user id to one of the partitions. Ids are mixed (splitmix64 finalizer) first,
+// so sequential ids are spread evenly. Every component which partitions users uses it:
+// with equal partitions counts the users of a processor are stored in the same shard
+inline size_t partitionOf(const int64_t id, const size_t partitionsCount)
+{
+    uint64_t x = static_cast<uint64_t>(id);
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<size_t>(x % partitionsCount);
+}
+} // namespace common
+
+#endif // COMMON_PARTITION_H
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef COMMON_STRING_VIEW_H
+#define COMMON_STRING_VIEW_H
+
+#include <cstring>
+#include <string>
+
+namespace common
+{
+// Non-owning reference to a sequence of chars, minimal replacement for std::string_view (C++17).
+// Referenced chars are not null terminated in general, so use "%.*s" to print them
+class StringView
+{
+private:
+    const char* m_data = "";
+    size_t m_size = 0;
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+public:
+    StringView() = default;
+    StringView(const char* data, const size_t size):
+        m_data(data), m_size(size)
+    {}
+    StringView(const char* str):
+        m_data(str), m_size(std::strlen(str))
+    {}
+    StringView(const std::string& str):
+        m_data(str.data()), m_size(str.size())
+    {}
+
+    const char* data() const
+    {
+        return m_data;
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+    // size as an int argument of "%.*s"
+    int length() const
+    {
+        return static_cast<int>(m_size);
+    }
+    bool empty() const
+    {
+        return 0 == m_size;
+    }
+    const char* begin() const
+    {
+        return m_data;
+    }
+    const char* end() const
+    {
+        return m_data + m_size;
+    }
+    char operator[](const size_t pos) const
+    {
+        return m_data[pos];
+    }
+    char front() const
+    {
+        return m_data[0];
+    }
+    char back() const
+    {
+        return m_data[m_size - 1];
+    }
+
+    StringView substr(const size_t pos, const size_t count = npos) const
+    {
+        const size_t size = (count < m_size - pos) ? count : m_size - pos;
+        return StringView(m_data + pos, size);
+    }
+    size_t find(const char c, const size_t pos = 0) const
+    {
+        if (pos >= m_size)
+        {
+            return npos;
+        }
+        const void* res = std::memchr(m_data + pos, c, m_size - pos);
+        return res ? static_cast<const char*>(res) - m_data : npos;
+    }
+
+    std::string toString() const
+    {
+        return std::string(m_data, m_size);
+    }
+
+    bool operator==(const StringView& sv) const
+    {
+        return (m_size == sv.m_size) && (0 == std::memcmp(m_data, sv.m_data, m_size));
+    }
+    bool operator!=(const StringView& sv) const
+    {
+        return !(*this == sv);
+    }
+};
+} // namespace common
+
+#endif // COMMON_STRING_VIEW_H
\ No newline at end of file
@@ -0,0 +1,134 @@
+#ifndef COMMON_THREAD_POOL_H
+#define COMMON_THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace common
+{
+// Work-stealing pool, so different kinds of work share the same threads.
+// Every worker has its own deques, one per priority: tasks posted by a worker go to its own deque,
+// other tasks are distributed round-robin. Workers run tasks of their own deques first and steal
+// tasks of the others when their deques are empty. High priority tasks of all workers are run before
+// low priority ones. Delayed tasks are kept by the timer queue and are posted by workers when they are due.
+// Count of active workers can be changed at runtime: threads are created on start, inactive ones are parked
+// and do not take tasks, their queued tasks are stolen by the active ones.
+// Idle workers can spin for a while before they sleep (spin-then-park)
+class ThreadPool
+{
+public:
+    enum class Priority
+    {
+        HIGH,
+        LOW,
+    };
+    typedef std::function<void()> Task;
+    // called by every worker thread before it takes tasks, e.g. to name it and set its affinity
+    typedef std::function<void(const size_t)> ThreadInit;
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    static constexpr size_t prioritiesCount = 2;
+
+    struct Worker
+    {
+        std::mutex m_guard;
+        std::deque<Task> m_tasks[prioritiesCount];
+        std::thread m_thread;
+    };
+    typedef std::unique_ptr<Worker> WorkerPtr;
+
+    struct Timer
+    {
+        Clock::time_point m_time;
+        // timers with the same time are posted in order
+        uint64_t m_sequence;
+        Priority m_priority;
+        Task m_task;
+
+        bool operator>(const Timer& timer) const
+        {
+            return m_time > timer.m_time || (m_time == timer.m_time && m_sequence > timer.m_sequence);
+        }
+    };
+
+private:
+    // worker of the current thread, nullptr if the thread is not a worker of the pool
+    static thread_local const ThreadPool* m_currentPool;
+    static thread_local size_t m_currentWorker;
+
+    std::vector<WorkerPtr> m_workers;
+    ThreadInit m_threadInit;
+    // workers without tasks spin before they sleep, so tasks posted meanwhile are taken without a wake up
+    Clock::duration m_spinDuration{0};
+    std::atomic<size_t> m_activeCount{0};
+    std::atomic<size_t> m_nextWorker{0};
+    // tasks in deques of all workers
+    std::atomic<size_t> m_queuedCount{0};
+    std::atomic<bool> m_isRunning{false};
+
+    std::mutex m_sleepGuard;
+    std::condition_variable m_sleepCv;
+    std::atomic<uint32_t> m_sleepersCount{0};
+    // inactive workers wait on it
+    std::condition_variable m_parkCv;
+
+    std::mutex m_timersGuard;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer> > m_timers;
+    uint64_t m_timersSequence = 0;
+    // time of the earliest timer, so workers do not lock the timers while there are no due ones
+    std::atomic<Clock::rep> m_nextTimerTime;
+
+private:
+    void workerFunc(const size_t index);
+    // returns true when a task or a due timer appears, the worker is deactivated or the pool is stopped
+    bool spin(const size_t index) const;
+    bool popTask(const size_t index, const bool isWorker, Task& task);
+    // posts due timers and returns the time of the next one
+    Clock::time_point postTimers();
+    void wakeOne();
+
+public:
+    ThreadPool();
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // it is applied to the threads created by the next start
+    void setThreadInit(ThreadInit&& threadInit);
+    // Spinning trades CPU for the latency of the first task after an idle period. 0 disables it
+    void setSpinDuration(const Clock::duration& duration);
+    // all workers are active if the max count is less than the count
+    void start(const size_t workersCount, const size_t maxWorkersCount = 0);
+    // Waits for the running tasks, queued and delayed tasks are dropped.
+    // It is safe to post concurrently with stop, such tasks are dropped as well
+    void stop();
+
+    // count of threads, active and parked ones. Threads of the stopped pool are counted until the next start
+    size_t workersCount() const;
+    size_t activeWorkersCount() const;
+    // the count is limited by [1, workersCount()]
+    void setActiveWorkersCount(const size_t count);
+
+    void post(Task&& task, const Priority priority = Priority::HIGH);
+    void postAfter(const Clock::duration& delay, Task&& task, const Priority priority = Priority::LOW);
+
+    // Runs one queued task in the current thread, returns false if there are no tasks.
+    // It lets a task wait for its subtasks without blocking the worker
+    bool runOne();
+
+    // Calls func(i) for i in [0, count) by the pool and the current thread, returns when all calls are completed
+    void parallelFor(const size_t count, const std::function<void(const size_t)>& func, const Priority priority = Priority::LOW);
+};
+} // namespace common
+
+#endif // COMMON_THREAD_POOL_H
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef COMMON_THREAD_TOPOLOGY_H
+#define COMMON_THREAD_TOPOLOGY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace common
+{
+// CPU numbers, empty list means any CPU
+typedef std::vector<int32_t> CpuList;
+
+// Placement of the threads of one role (event loop, workers)
+struct ThreadPlacement
+{
+    CpuList m_cpus;
+    // threads of the role are pinned to single CPUs of the list round-robin, otherwise to the whole list
+    bool m_isSpread = false;
+    // memory allocated by the thread comes from its NUMA node even if the process has another policy
+    bool m_isNumaLocal = false;
+};
+
+// "0,2-5" to {0, 2, 3, 4, 5}, empty string is any CPU
+bool parseCpuList(const std::string& str, CpuList& cpus);
+std::string cpuListToString(const CpuList& cpus);
+
+// Names the current thread (truncated to 15 chars) and applies the placement,
+// the index selects the CPU of the spread placement. Returns false if any of them fails
+bool applyThreadPlacement(const std::string& name, const ThreadPlacement& placement, const size_t index);
+// CPUs the current thread is allowed to run on
+CpuList currentThreadCpus();
+// NUMA node of the CPU the current thread is running on, -1 if it is unknown
+int32_t currentNumaNode();
+} // namespace common
+
+#endif // COMMON_THREAD_TOPOLOGY_H
\ No newline at end of file
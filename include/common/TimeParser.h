@@ -0,0 +1,49 @@
+#ifndef COMMON_TIME_PARSER_H
+#define COMMON_TIME_PARSER_H
+
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#include "Types.h"
+
+namespace common
+{
+// Offsets of the local time zone around the current time.
+// They are cached on the first use, so local time is converted without mktime and the time zone lock.
+// Changes of TZ after the first use are not noticed
+class LocalTimeZone
+{
+private:
+    struct Transition
+    {
+        // first UTC second with the offset
+        std::time_t m_utcStart;
+        // first local second with the offset
+        std::time_t m_localStart;
+        int32_t m_offset;
+    };
+
+private:
+    std::vector<Transition> m_transitions;
+    std::time_t m_utcEnd;
+
+private:
+    LocalTimeZone();
+    static int32_t offsetAt(const std::time_t t);
+
+public:
+    static const LocalTimeZone& instance();
+
+    // returns false if the local time is out of the cached range
+    bool toUtc(const int64_t localSeconds, std::time_t& t) const;
+};
+
+// length of %Y-%m-%dT%H:%M:%S
+static constexpr size_t isoTimeSize = 19;
+
+// parses local time in %Y-%m-%dT%H:%M:%S format
+Result isoTimeFromString(std::time_t& t, const char* const buf, const size_t size);
+} // namespace common
+
+#endif // COMMON_TIME_PARSER_H
\ No newline at end of file
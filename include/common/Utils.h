@@ -1,6 +1,7 @@
 #ifndef COMMON_UTILS_H
 #define COMMON_UTILS_H
 
+#include <cstdint>
 #include <ctime>
 #include <string>
 #include "Types.h"
@@ -10,6 +11,8 @@ namespace common
 std::string timeToString(const std::time_t t, const char* fmt = "%Y-%m-%dT%H:%M:%S");
 void timeToBuf(char* const buf, const size_t size, const std::time_t t, const char* fmt = "%Y-%m-%dT%H:%M:%S");
 Result timeFromString(time_t& timeRes, const char* buf, const char* fmt = "%Y-%m-%dT%H:%M:%S");
+// decimal integer with optional minus sign, it is moved to the first char after the number
+bool parseInt64(const char*& it, const char* const end, int64_t& value);
 } // namespace common
 
 #include "UtilsImpl.hpp"
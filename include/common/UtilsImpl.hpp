@@ -1,9 +1,14 @@
 #ifndef COMMON_UTILS_IMPL_H
 #define COMMON_UTILS_IMPL_H
 
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
+#include <cstring>
 #include <string>
 
+#include "TimeParser.h"
+
 namespace common
 {
 inline std::string timeToString(const std::time_t t, const char* fmt)
@@ -20,16 +25,52 @@ inline void timeToBuf(char* const buf, const size_t size, const std::time_t t, c
 
 inline Result timeFromString(time_t& timeRes, const char* buf, const char* fmt) 
 {
+    if (0 == std::strcmp(fmt, "%Y-%m-%dT%H:%M:%S"))
+    {
+        return isoTimeFromString(timeRes, buf, std::strlen(buf));
+    }
+
     struct tm timeStruct = {0};
     char* res = strptime(buf, fmt, &timeStruct);
     if (!res)
     {
         return Result::INVALID_FORMAT;
     }
+    // let mktime determine whether DST is in effect
+    timeStruct.tm_isdst = -1;
     timeRes = mktime(&timeStruct);
     return Result::SUCCESS;
 }
 
+inline bool parseInt64(const char*& it, const char* const end, int64_t& value)
+{
+    // 19 digits always fit into uint64_t
+    static constexpr ptrdiff_t maxDigits = 19;
+
+    const bool isNegative = (it != end) && ('-' == *it);
+    it += isNegative;
+
+    const char* const begin = it;
+    const char* const last = (end - it > maxDigits) ? it + maxDigits : end;
+    uint64_t res = 0;
+    uint32_t digit;
+    // chars that are not digits are wrapped around to big unsigned values
+    while (it != last && (digit = static_cast<uint32_t>(static_cast<uint8_t>(*it)) - '0') <= 9)
+    {
+        res = res * 10 + digit;
+        ++ it;
+    }
+
+    const bool isTooLong = (it != end) && (static_cast<uint32_t>(static_cast<uint8_t>(*it)) - '0' <= 9);
+    const uint64_t maxValue = static_cast<uint64_t>(INT64_MAX) + isNegative;
+    if (begin == it || isTooLong || res > maxValue)
+    {
+        return false;
+    }
+    value = static_cast<int64_t>(isNegative ? 0 - res : res);
+    return true;
+}
+
 } // namespace common
 
 #endif // COMMON_UTILS_IMPL_H
\ No newline at end of file
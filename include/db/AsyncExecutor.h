@@ -0,0 +1,81 @@
+#ifndef DB_ASYNC_EXECUTOR_H
+#define DB_ASYNC_EXECUTOR_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+
+namespace db
+{
+
+// Executes tasks on a set of I/O threads.
+// Tasks with the same key are executed by the same thread in the order they were submitted, so every thread
+// executes one task at a time and operations are concurrent across the threads only.
+// Count of tasks that are queued or executed by one thread is bounded by the queue size
+class AsyncExecutor
+{
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct Partition
+    {
+        std::deque<Task> m_tasks;
+        // queued tasks and the executed one
+        size_t m_pendingCount = 0;
+        // tasks are refused after stop, the queued ones are executed
+        bool m_isStopped = false;
+        std::mutex m_guard;
+        std::condition_variable m_notEmptyCv;
+        std::condition_variable m_notFullCv;
+        std::thread m_thread;
+    };
+    typedef std::unique_ptr<Partition> PartitionPtr;
+
+private:
+    // partitions are kept after stop, so tasks which race with stop are refused by them
+    std::vector<PartitionPtr> m_partitions;
+    size_t m_queueSize = 1;
+    volatile bool m_isRunning = false;
+
+private:
+    void partitionFunc(Partition& partition);
+
+public:
+    AsyncExecutor() = default;
+    ~AsyncExecutor();
+    AsyncExecutor(const AsyncExecutor&) = delete;
+    AsyncExecutor(AsyncExecutor&&) = delete;
+    AsyncExecutor& operator=(const AsyncExecutor&) = delete;
+    AsyncExecutor& operator=(AsyncExecutor&&) = delete;
+
+    // it is not called concurrently with execute
+    void start(const size_t partitionsCount, const size_t queueSize);
+    // waits until all submitted tasks are executed
+    void stop();
+    bool isRunning() const;
+    size_t partitionsCount() const;
+
+    // blocks while the queue of the partition is full.
+    // Returns false if the executor is stopped, the task is not executed then
+    bool execute(const int64_t key, Task&& task);
+};
+
+inline bool AsyncExecutor::isRunning() const
+{
+    return m_isRunning;
+}
+
+inline size_t AsyncExecutor::partitionsCount() const
+{
+    return m_partitions.size();
+}
+
+} // namespace db
+
+#endif // DB_ASYNC_EXECUTOR_H
\ No newline at end of file
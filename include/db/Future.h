@@ -0,0 +1,84 @@
+#ifndef DB_FUTURE_H
+#define DB_FUTURE_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "../common/Types.h"
+
+namespace db
+{
+using common::Result;
+
+template<class T>
+class Promise;
+
+// Result of an asynchronous storage operation. The continuation is called once with the result
+// and the value: inline if the future is completed, otherwise by the thread that completes it,
+// so the caller is not blocked. Completed futures keep their value without the shared state,
+// so operations that are completed inline do not allocate. The future is consumed by then or get
+template<class T>
+class Future
+{
+public:
+    typedef std::function<void(const Result, T&&)> Continuation;
+
+private:
+    struct State
+    {
+        std::mutex m_guard;
+        bool m_isReady = false;
+        Result m_result = Result::FAILED;
+        T m_value;
+        Continuation m_continuation;
+    };
+    typedef std::shared_ptr<State> StatePtr;
+
+private:
+    // nullptr if the future is completed on creation
+    StatePtr m_state;
+    Result m_result = Result::FAILED;
+    T m_value;
+
+private:
+    friend class Promise<T>;
+    explicit Future(const StatePtr& state);
+
+public:
+    // completed future
+    Future(const Result result, T&& value);
+    Future(Future&&) = default;
+    Future& operator=(Future&&) = default;
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    bool isReady() const;
+    void then(Continuation&& continuation);
+    // blocks until the future is completed, it is used by synchronous callers
+    Result get(T& value);
+};
+
+// Completing side of the future, it is completed once. Copies share the state: the future is completed
+// with FAILED when the last copy is destroyed without set (e.g. the task is dropped), so it is not left pending
+template<class T>
+class Promise
+{
+private:
+    std::shared_ptr<typename Future<T>::StatePtr> m_state;
+
+private:
+    static void complete(const typename Future<T>::StatePtr& state, const Result result, T&& value);
+
+public:
+    Promise();
+
+    Future<T> future() const;
+    // the continuation is called by the current thread if it is set already
+    void set(const Result result, T&& value);
+};
+} // namespace db
+
+#include "FutureImpl.hpp"
+
+#endif // DB_FUTURE_H
\ No newline at end of file
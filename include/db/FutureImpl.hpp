@@ -0,0 +1,111 @@
+#ifndef DB_FUTURE_IMPL_HPP
+#define DB_FUTURE_IMPL_HPP
+
+#include <future>
+
+namespace db
+{
+
+template<class T>
+inline Future<T>::Future(const StatePtr& state):
+    m_state(state)
+{}
+
+template<class T>
+inline Future<T>::Future(const Result result, T&& value):
+    m_result(result),
+    m_value(std::move(value))
+{}
+
+template<class T>
+inline bool Future<T>::isReady() const
+{
+    if (!m_state)
+    {
+        return true;
+    }
+    std::unique_lock<std::mutex> l(m_state->m_guard);
+    return m_state->m_isReady;
+}
+
+template<class T>
+inline void Future<T>::then(Continuation&& continuation)
+{
+    if (!m_state)
+    {
+        continuation(m_result, std::move(m_value));
+        return ;
+    }
+
+    StatePtr state = std::move(m_state);
+    {
+        std::unique_lock<std::mutex> l(state->m_guard);
+        if (!state->m_isReady)
+        {
+            state->m_continuation = std::move(continuation);
+            return ;
+        }
+    }
+    continuation(state->m_result, std::move(state->m_value));
+}
+
+template<class T>
+inline Result Future<T>::get(T& value)
+{
+    std::promise<Result> promise;
+    std::future<Result> future = promise.get_future();
+    then([&promise, &value] (const Result result, T&& v) -> void
+        {
+            value = std::move(v);
+            promise.set_value(result);
+        });
+    return future.get();
+}
+
+template<class T>
+inline Promise<T>::Promise():
+    m_state(new typename Future<T>::StatePtr(std::make_shared<typename Future<T>::State>()),
+        [] (typename Future<T>::StatePtr* state) -> void
+        {
+            complete(*state, Result::FAILED, T());
+            delete state;
+        })
+{}
+
+template<class T>
+inline Future<T> Promise<T>::future() const
+{
+    return Future<T>(*m_state);
+}
+
+template<class T>
+inline void Promise<T>::set(const Result result, T&& value)
+{
+    complete(*m_state, result, std::move(value));
+}
+
+template<class T>
+inline void Promise<T>::complete(const typename Future<T>::StatePtr& state, const Result result, T&& value)
+{
+    typename Future<T>::Continuation continuation;
+    {
+        std::unique_lock<std::mutex> l(state->m_guard);
+        if (state->m_isReady)
+        {
+            return ;
+        }
+        state->m_isReady = true;
+        if (!state->m_continuation)
+        {
+            state->m_result = result;
+            state->m_value = std::move(value);
+            return ;
+        }
+        std::swap(continuation, state->m_continuation);
+    }
+    continuation(result, std::move(value));
+}
+
+} // namespace db
+
+#endif // DB_FUTURE_IMPL_HPP
\ No newline at end of file
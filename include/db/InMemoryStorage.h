@@ -8,6 +8,8 @@
 #include <unordered_set>
 #include <string>
 #include <queue>
+#include <memory>
+#include <vector>
 
 #include "../logger/LoggerFwd.h"
 #include "../common/Types.h"
@@ -39,22 +41,34 @@ private:
     typedef std::unordered_map<int64_t, UserStorage> UsersStorage;
     typedef std::unordered_set<int64_t> ConnectedUsersStorage;
 
+    // users are partitioned like processors, so every processor locks its own shard only
+    // and the guard is contended by the leaderboards reader only
+    struct Shard
+    {
+        UsersStorage m_users;
+        std::mutex m_guard;
+    };
+    typedef std::unique_ptr<Shard> ShardPtr;
+
 private:
     State m_state = State::CREATED;
 
-    UsersStorage m_users;
-    mutable std::mutex m_usersMapGuard;
+    std::vector<ShardPtr> m_shards;
     ConnectedUsersStorage m_connectedUsers;
     mutable std::mutex m_connectedUsersGuard;
 
     logger::CategoryPtr m_logger;
 
+private:
+    Shard& shardOf(const int64_t id) const;
+
 public:
     InMemoryStorage();
     virtual ~InMemoryStorage() = default;
 
     virtual Result configure(const libconfig::Config& cfg) override;
     virtual Result start() override;
+    virtual void stop() override;
 
     virtual Result storeUser(const int64_t id, const std::string& name) override;
     virtual Result renameUser(const int64_t id, const std::string& name) override;
@@ -63,6 +77,9 @@ public:
     virtual Result storeConnectedUser(const int64_t id) override;
     virtual Result removeConnectedUser(const int64_t id) override;
 
+    // consecutive deals of the same shard are stored under one lock
+    virtual void storeUserDeals(const Deals& deals, std::vector<Result>& results) override;
+
     virtual Result getUser(User& user, const int64_t id) const override;
 
     virtual Result getLeaderboards(
@@ -3,17 +3,22 @@
 
 #include <ctime>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
 
-#include <mongocxx/pool.hpp>
+#include <mongocxx/client.hpp>
 
 #include "../logger/LoggerFwd.h"
 #include "../common/Types.h"
 #include "Storage.h"
+#include "AsyncExecutor.h"
 
 namespace db
 {
@@ -22,6 +27,129 @@ using common::Result;
 
 class MongodbStorage : public Storage
 {
+private:
+    // long-lived client with cached handles.
+    // It is checked out of the free list for one operation and returned by the guard
+    struct Client
+    {
+        std::unique_ptr<mongocxx::client> m_client;
+        mongocxx::database m_database;
+        mongocxx::collection m_users;
+        mongocxx::collection m_connectedUsers;
+        // operation failed, health check is needed before the next operation
+        bool m_isBroken = false;
+    };
+    typedef std::unique_ptr<Client> ClientPtr;
+
+    struct LoadStats
+    {
+        uint64_t m_users = 0;
+        uint64_t m_scores = 0;
+        uint64_t m_badDocuments = 0;
+    };
+
+    // document of the weekly scores aggregation
+    struct LeaderboardRow
+    {
+        int64_t m_score = 0;
+        // the name is decoded into the user, the ranking does not copy it again
+        User m_user;
+    };
+    typedef std::vector<LeaderboardRow> LeaderboardRows;
+
+    // rows decoded by the cursor reader and not ranked yet
+    struct LeaderboardRowsQueue
+    {
+        std::deque<LeaderboardRows> m_batches;
+        std::mutex m_guard;
+        std::condition_variable m_cv;
+        bool m_isFinished = false;
+        // ranking is finished or aborted, the reader stops and does not wait for the space in the queue
+        bool m_isCancelled = false;
+        Result m_result = Result::SUCCESS;
+        uint64_t m_badDocuments = 0;
+    };
+
+    // Joins the cursor reader when the ranking is finished or aborted by an exception.
+    // It must be destroyed before the cursor and the queue
+    class LeaderboardReaderGuard
+    {
+    private:
+        LeaderboardRowsQueue& m_queue;
+        std::thread m_thread;
+
+    public:
+        LeaderboardReaderGuard(LeaderboardRowsQueue& queue, std::thread&& thread):
+            m_queue(queue),
+            m_thread(std::move(thread))
+        {}
+
+        ~LeaderboardReaderGuard()
+        {
+            join();
+        }
+
+        LeaderboardReaderGuard(const LeaderboardReaderGuard&) = delete;
+        LeaderboardReaderGuard& operator=(const LeaderboardReaderGuard&) = delete;
+
+        void join()
+        {
+            if (!m_thread.joinable())
+            {
+                return ;
+            }
+            {
+                std::unique_lock<std::mutex> l(m_queue.m_guard);
+                m_queue.m_isCancelled = true;
+                m_queue.m_cv.notify_all();
+            }
+            m_thread.join();
+        }
+    };
+
+    // returns the checked out client to the free list
+    class ClientGuard
+    {
+    private:
+        const MongodbStorage* m_storage;
+        Client* m_client;
+
+    public:
+        ClientGuard(const MongodbStorage& storage, Client& client):
+            m_storage(&storage),
+            m_client(&client)
+        {}
+
+        ClientGuard(ClientGuard&& other):
+            m_storage(other.m_storage),
+            m_client(other.m_client)
+        {
+            other.m_client = nullptr;
+        }
+
+        ~ClientGuard()
+        {
+            if (m_client)
+            {
+                m_storage->releaseClient(*m_client);
+            }
+        }
+
+        ClientGuard(const ClientGuard&) = delete;
+        ClientGuard& operator=(const ClientGuard&) = delete;
+        ClientGuard& operator=(ClientGuard&&) = delete;
+
+        Client* operator->() const
+        {
+            return m_client;
+        }
+
+        void setBroken()
+        {
+            m_client->m_isBroken = true;
+        }
+    };
+
 private:
     State m_state = State::CREATED;
 
@@ -29,23 +157,54 @@ private:
     std::string m_dbName;
     std::string m_usersCollectionName;
     std::string m_connectedUsersCollectionName;
-
-    mutable std::unique_ptr<mongocxx::pool> m_pool;
-    mutable std::mutex m_poolGuard;
+    int32_t m_clientsCount = 2;
+    // 0 means asynchronous operations are executed synchronously
+    int32_t m_asyncPartitionsCount = 0;
+    int32_t m_asyncQueueSize = 64;
+    int32_t m_warmLoadThreads = 4;
+    int32_t m_warmLoadBatchSize = 1000;
+    int32_t m_leaderboardBatchSize = 10000;
+    bool m_leaderboardAllowDiskUse = true;
+
+    std::vector<ClientPtr> m_clients;
+    // clients which are not checked out by any operation
+    mutable std::vector<Client*> m_freeClients;
+    mutable std::mutex m_freeClientsGuard;
+    mutable std::condition_variable m_freeClientsCv;
+
+    AsyncExecutor m_executor;
+    // leaderboards aggregation, it is started with the I/O threads
+    AsyncExecutor m_readExecutor;
 
     logger::CategoryPtr m_logger;
 
 private:
+    Result connect(Client& client) const;
+    // waits for a free client
+    ClientGuard acquireClient() const;
+    void releaseClient(Client& client) const;
+
     std::unordered_set<int64_t> getConnectedUsers() const;
 
-    Result getUser(User& user, const int64_t id, mongocxx::collection& collection) const;
+    Result getUser(User& user, const int64_t id, ClientGuard& client) const;
+    // stores the deals by the indexes with unordered bulk writes, their results are set by the indexes
+    void storeUserDeals(const Deals& deals, const std::vector<size_t>& indexes, std::vector<Result>& results);
+
+    // returns maxId < minId if there are no users
+    Result getUsersIdRange(int64_t& minId, int64_t& maxId) const;
+    // loads users with ids in [fromId, toId]
+    Result loadUsersRange(Storage& target, const int64_t fromId, const int64_t toId, LoadStats& stats) const;
+
+    static bool decodeLeaderboardRow(const bsoncxx::document::view& view, LeaderboardRow& row);
+    void readLeaderboardRows(mongocxx::cursor& cursor, LeaderboardRowsQueue& queue) const;
 
 public:
     MongodbStorage();
-    virtual ~MongodbStorage() = default;
+    virtual ~MongodbStorage();
 
     virtual Result configure(const libconfig::Config& cfg) override;
     virtual Result start() override;
+    virtual void stop() override;
 
     virtual Result storeUser(const int64_t id, const std::string& name) override;
     virtual Result renameUser(const int64_t id, const std::string& name) override;
@@ -54,6 +213,16 @@ public:
     virtual Result storeConnectedUser(const int64_t id) override;
     virtual Result removeConnectedUser(const int64_t id) override;
 
+    virtual void storeUserDeals(const Deals& deals, std::vector<Result>& results) override;
+
+    virtual void storeUserAsync(const int64_t id, const std::string& name, const Callback& cb) override;
+    virtual void renameUserAsync(const int64_t id, const std::string& name, const Callback& cb) override;
+    virtual void storeUserDealAsync(const int64_t id, const std::time_t t, const int64_t amount, const Callback& cb) override;
+    virtual void storeUserDealsAsync(Deals&& deals, const BatchCallback& cb) override;
+
+    virtual void storeConnectedUserAsync(const int64_t id, const Callback& cb) override;
+    virtual void removeConnectedUserAsync(const int64_t id, const Callback& cb) override;
+
     virtual Result getUser(User& user, const int64_t id) const override;
 
     virtual Result getLeaderboards(
@@ -63,6 +232,16 @@ public:
         const uint64_t after = 10)
             const override;
 
+    // reads of a user are executed after the mutations of the user which are called before
+    virtual Future<User> getUserAsync(const int64_t id) override;
+    virtual Future<Leaderboards> getLeaderboardsAsync(
+        const int64_t count = -1,
+        const uint64_t before = 10,
+        const uint64_t after = 10) override;
+
+    // Reads all users, scores and connected users and stores them to the target storage.
+    // Id space is scanned by parallel cursors, so the target storage must be thread safe
+    virtual Result loadUsers(Storage& target) const override;
 };
 } // namespace db
 
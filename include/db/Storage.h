@@ -1,13 +1,18 @@
 #ifndef DB_STORAGE_H
 #define DB_STORAGE_H
 
+#include <algorithm>
+#include <ctime>
 #include <string>
+#include <functional>
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "../common/Types.h"
 #include "Fwd.h"
+#include "Future.h"
 
 namespace libconfig
 {
@@ -63,6 +68,19 @@ struct ScorePosition
     }
 };
 
+// deal of a batch, see Storage::storeUserDeals
+struct Deal
+{
+    int64_t m_id;
+    std::time_t m_time;
+    int64_t m_amount;
+
+    Deal(const int64_t id, const std::time_t t, const int64_t amount):
+        m_id(id), m_time(t), m_amount(amount)
+    {}
+};
+typedef std::vector<Deal> Deals;
+
 // <score, position> to <user>
 typedef std::multimap<ScorePosition, User, std::greater<ScorePosition> > Leaderboard;
 // user id to leaderboard
@@ -75,17 +93,24 @@ public:
     {
         IN_MEMORY,
         MONGODB,
+        TIERED,
         UNKNOWN,
     };
     static Type typeFromString(const std::string& typeStr);
     static const char* typeToString(const Type t);
 
+    // called with the result when an asynchronous operation is completed
+    typedef std::function<void(const Result)> Callback;
+    // called with the results of the batch in the order of its operations
+    typedef std::function<void(const std::vector<Result>&)> BatchCallback;
+
 public:
     Storage() = default;
     virtual ~Storage() = default;
 
     virtual Result configure(const libconfig::Config& cfg) = 0;
     virtual Result start() = 0;
+    virtual void stop() = 0;
 
     virtual Result storeUser(const int64_t id, const std::string& name) = 0;
     virtual Result renameUser(const int64_t id, const std::string& name) = 0;
@@ -94,6 +119,24 @@ public:
     virtual Result storeConnectedUser(const int64_t id) = 0;
     virtual Result removeConnectedUser(const int64_t id) = 0;
 
+    // Stores the deals by one operation, every deal has its own result, so failed deals do not fail the others.
+    // By default the deals are stored one by one
+    virtual void storeUserDeals(const Deals& deals, std::vector<Result>& results);
+
+    // Asynchronous mutations. Operations for the same user are completed in the order they were called.
+    // By default they are executed synchronously and the callback is called before return
+    virtual void storeUserAsync(const int64_t id, const std::string& name, const Callback& cb);
+    virtual void renameUserAsync(const int64_t id, const std::string& name, const Callback& cb);
+    virtual void storeUserDealAsync(const int64_t id, const std::time_t t, const int64_t amount, const Callback& cb);
+    virtual void storeUserDealsAsync(Deals&& deals, const BatchCallback& cb);
+
+    virtual void storeConnectedUserAsync(const int64_t id, const Callback& cb);
+    virtual void removeConnectedUserAsync(const int64_t id, const Callback& cb);
+
+    // Copies all persisted users, scores and connected users to the target storage, it is used for the warm load.
+    // Storages which do not persist data have nothing to copy
+    virtual Result loadUsers(Storage& target) const;
+
     virtual Result getUser(User& user, const int64_t id) const = 0;
 
     virtual Result getLeaderboards(
@@ -101,6 +144,14 @@ public:
         const int64_t count = -1,
         const uint64_t before = 10,
         const uint64_t after = 10) const = 0;
+
+    // Asynchronous reads, the caller continues when the future is completed instead of waiting.
+    // By default they are executed synchronously and the completed future is returned
+    virtual Future<User> getUserAsync(const int64_t id);
+    virtual Future<Leaderboards> getLeaderboardsAsync(
+        const int64_t count = -1,
+        const uint64_t before = 10,
+        const uint64_t after = 10);
 };
 
 inline Storage::Type Storage::typeFromString(const std::string& tmpTypeStr)
@@ -114,6 +165,9 @@ inline Storage::Type Storage::typeFromString(const std::string& tmpTypeStr)
         {"mongodb",     Type::MONGODB},
         {"mongo_db",    Type::MONGODB},
         {"mongo-db",    Type::MONGODB},
+        {"tiered",      Type::TIERED},
+        {"write-behind",Type::TIERED},
+        {"write_behind",Type::TIERED},
     };
     std::string typeStr;
     std::transform(tmpTypeStr.begin(), tmpTypeStr.end(), std::back_inserter(typeStr), ::tolower);
@@ -134,11 +188,74 @@ inline const char* Storage::typeToString(const Type t)
             return "IN MEMORY";
         case Type::MONGODB:
             return "MONGODB";
+        case Type::TIERED:
+            return "TIERED";
         case Type::UNKNOWN:
             return "UNKNOWN";
     }
     return "UNKNOWN";
 }
+
+inline void Storage::storeUserDeals(const Deals& deals, std::vector<Result>& results)
+{
+    results.clear();
+    results.reserve(deals.size());
+    for (auto&& deal : deals)
+    {
+        results.push_back(storeUserDeal(deal.m_id, deal.m_time, deal.m_amount));
+    }
+}
+
+inline void Storage::storeUserAsync(const int64_t id, const std::string& name, const Callback& cb)
+{
+    cb(storeUser(id, name));
+}
+
+inline void Storage::renameUserAsync(const int64_t id, const std::string& name, const Callback& cb)
+{
+    cb(renameUser(id, name));
+}
+
+inline void Storage::storeUserDealAsync(const int64_t id, const std::time_t t, const int64_t amount, const Callback& cb)
+{
+    cb(storeUserDeal(id, t, amount));
+}
+
+inline void Storage::storeUserDealsAsync(Deals&& deals, const BatchCallback& cb)
+{
+    std::vector<Result> results;
+    storeUserDeals(deals, results);
+    cb(results);
+}
+
+inline void Storage::storeConnectedUserAsync(const int64_t id, const Callback& cb)
+{
+    cb(storeConnectedUser(id));
+}
+
+inline void Storage::removeConnectedUserAsync(const int64_t id, const Callback& cb)
+{
+    cb(removeConnectedUser(id));
+}
+
+inline Result Storage::loadUsers(Storage&) const
+{
+    return Result::SUCCESS;
+}
+
+inline Future<User> Storage::getUserAsync(const int64_t id)
+{
+    User user;
+    const Result res = getUser(user, id);
+    return Future<User>(res, std::move(user));
+}
+
+inline Future<Leaderboards> Storage::getLeaderboardsAsync(const int64_t count, const uint64_t before, const uint64_t after)
+{
+    Leaderboards leaderboards;
+    const Result res = getLeaderboards(leaderboards, count, before, after);
+    return Future<Leaderboards>(res, std::move(leaderboards));
+}
 } // namespace db
 
 #endif // DB_STORAGE_H
\ No newline at end of file
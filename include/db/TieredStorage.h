@@ -0,0 +1,135 @@
+#ifndef DB_TIERED_STORAGE_H
+#define DB_TIERED_STORAGE_H
+
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "../logger/LoggerFwd.h"
+#include "../common/Types.h"
+#include "Storage.h"
+#include "InMemoryStorage.h"
+
+namespace db
+{
+using common::State;
+using common::Result;
+
+// Write-behind storage: all reads and leaderboards are served by the in-memory storage,
+// mutations are applied to the in-memory storage synchronously and persisted to MongoDB
+// asynchronously in coalesced batches. Users which cannot be persisted because of transient errors are put
+// back to the queue and retried with an exponential backoff of their own, permanent errors are dropped
+class TieredStorage : public Storage
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct DirtyUser
+    {
+        enum class Connection
+        {
+            NONE,
+            CONNECTED,
+            DISCONNECTED,
+        };
+
+        bool m_isRegistered = false;
+        bool m_isRenamed = false;
+        std::string m_name;
+        // time to accumulated amount
+        std::map<std::time_t, int64_t> m_deals;
+        Connection m_connection = Connection::NONE;
+        // count of failed flushes
+        int32_t m_attempts = 0;
+        // the user is not flushed before the time while the storage runs
+        Clock::time_point m_retryTime;
+    };
+    typedef std::unordered_map<int64_t, DirtyUser> DirtyUsers;
+
+private:
+    State m_state = State::CREATED;
+
+    std::unique_ptr<InMemoryStorage> m_memory;
+    std::unique_ptr<Storage> m_persistent;
+
+    int32_t m_queueSize = 100000;
+    int32_t m_flushIntervalMs = 100;
+    int32_t m_batchSize = 1000;
+    // user is dropped after the count of failed flushes
+    int32_t m_maxRetries = 10;
+    // delay after the first failed batch, it is doubled by every next one
+    int32_t m_retryIntervalMs = 100;
+
+    DirtyUsers m_dirtyUsers;
+    // order in which users became dirty
+    std::deque<int64_t> m_dirtyOrder;
+    // failed users that wait for their retry time, they are not in the dirty order
+    std::multimap<Clock::time_point, int64_t> m_retryOrder;
+    std::mutex m_dirtyGuard;
+    std::condition_variable m_dirtyCv;
+    std::condition_variable m_dirtyNotFullCv;
+
+    volatile bool m_isFlushThreadRunning = false;
+    std::thread m_flushThread;
+
+    // mutations are accepted while they can be persisted, stop waits for the ones in progress
+    std::shared_timed_mutex m_mutationsGuard;
+    bool m_isMutable = false;
+
+    logger::CategoryPtr m_logger;
+
+private:
+    // applies the write to the in-memory storage and marks the user dirty,
+    // mutations are refused before the in-memory storage is changed when the storage is stopped
+    template<class Write, class Mark>
+    Result mutate(const int64_t id, Write&& write, Mark&& mark);
+    template<class Func>
+    Result markDirty(const int64_t id, Func&& func);
+    void flushThreadFunc();
+    // persisted and permanently failed mutations are removed from the user,
+    // returns false if some of them are failed transiently
+    bool flush(const int64_t id, DirtyUser& user);
+    // the registration written by the previous attempt whose reply is lost is completed by the rename
+    Result persistRegistration(const int64_t id, const std::string& name);
+    // merges the failed mutations with the ones received during the flush
+    void requeue(const int64_t id, DirtyUser&& failed);
+
+public:
+    // MongoDB is the persistent storage
+    TieredStorage();
+    TieredStorage(std::unique_ptr<InMemoryStorage>&& memory, std::unique_ptr<Storage>&& persistent);
+    virtual ~TieredStorage();
+
+    virtual Result configure(const libconfig::Config& cfg) override;
+    virtual Result start() override;
+    virtual void stop() override;
+
+    virtual Result storeUser(const int64_t id, const std::string& name) override;
+    virtual Result renameUser(const int64_t id, const std::string& name) override;
+    virtual Result storeUserDeal(const int64_t id, const std::time_t t, const int64_t amount) override;
+
+    virtual Result storeConnectedUser(const int64_t id) override;
+    virtual Result removeConnectedUser(const int64_t id) override;
+
+    virtual void storeUserDeals(const Deals& deals, std::vector<Result>& results) override;
+
+    virtual Result getUser(User& user, const int64_t id) const override;
+
+    virtual Result getLeaderboards(
+        Leaderboards& leaderboards,
+        const int64_t count = -1,
+        const uint64_t before = 10,
+        const uint64_t after = 10)
+            const override;
+};
+} // namespace db
+
+#endif // DB_TIERED_STORAGE_H
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef MY_RABBIT_MQ_ACKNOWLEDGER_H
+#define MY_RABBIT_MQ_ACKNOWLEDGER_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <amqpcpp.h>
+
+#include "../logger/LoggerFwd.h"
+
+#include "Fwd.h"
+#include "PrefetchController.h"
+#include "SettlementOrder.h"
+
+namespace rabbitmq
+{
+// Settles deliveries of the consumer channel. Processors ack and reject deliveries from their threads,
+// the operations are posted to the event loop which owns the channel. Deliveries are settled out of order,
+// so acks are ordered by the settlement order, rejects are sent at once.
+// Prefetch of the channel is tuned by the latency from delivery to settlement if the controller is set
+class Acknowledger : public std::enable_shared_from_this<Acknowledger>
+{
+public:
+    // delivery tag and success
+    typedef std::pair<uint64_t, bool> Settlement;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    EventLoop& m_eventLoop;
+
+    // the following members are used by the event loop thread only
+    std::shared_ptr<AMQP::TcpChannel> m_channel;
+    SettlementOrder m_order;
+    bool m_isFlushPosted = false;
+
+    std::unique_ptr<PrefetchController> m_prefetchController;
+    std::unordered_map<uint64_t, Clock::time_point> m_receivedTimes;
+
+    logger::CategoryPtr m_logger;
+
+private:
+    void settle(const uint64_t deliveryTag, const bool isSucceeded, const int rejectFlags);
+    void flush();
+    void updatePrefetch(const uint64_t deliveryTag);
+
+public:
+    Acknowledger(
+        EventLoop& eventLoop,
+        const std::shared_ptr<AMQP::TcpChannel>& channel,
+        const uint16_t maxPrefetch,
+        std::unique_ptr<PrefetchController>&& prefetchController);
+    Acknowledger(const Acknowledger&) = delete;
+    Acknowledger& operator=(const Acknowledger&) = delete;
+
+    // called by the event loop thread when the delivery is received
+    void received(const uint64_t deliveryTag);
+
+    void ack(const uint64_t deliveryTag);
+    void reject(const uint64_t deliveryTag);
+    // the broker delivers the message again
+    void requeue(const uint64_t deliveryTag);
+    // Acks and rejects the deliveries by one event loop task, so consecutive acks are sent as one
+    void settle(std::vector<Settlement>&& settlements);
+
+    // Sends the pending ack and detaches the channel, deliveries settled after that are ignored.
+    // It waits for the event loop
+    void close();
+};
+} // namespace rabbitmq
+
+#endif // MY_RABBIT_MQ_ACKNOWLEDGER_H
\ No newline at end of file
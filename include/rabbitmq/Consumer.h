@@ -10,6 +10,7 @@
 
 #include "Fwd.h"
 #include "Handler.h"
+#include "Acknowledger.h"
 
 namespace rabbitmq
 {
@@ -17,10 +18,26 @@ namespace rabbitmq
 class Consumer : public Handler
 {
 protected:
-    typedef std::function<Result(rabbitmq::ProcessingItem&&)> MessageProcessingCallback;
+    typedef std::function<Result(rabbitmq::ProcessingItemPtr&&)> MessageProcessingCallback;
     MessageProcessingCallback m_messageProcessingCallback;
+    AcknowledgerPtr m_acknowledger;
+
+    // initial capacity of the body buffers of the pooled items
+    static constexpr size_t pooledMessageSize = 1024;
+    // there are as many items as unacked deliveries, so the pool has prefetch items
+    std::unique_ptr<ProcessingItemPool> m_itemPool;
+
+    // max count of unacked deliveries, the broker holds the rest
+    int32_t m_prefetchMax = 1024;
+    int32_t m_prefetchMin = 16;
+    bool m_isPrefetchAdaptive = true;
+    int32_t m_targetLatencyMs = 200;
 
 protected:
+    virtual Result doConfigure(const libconfig::Config& cfg) override;
+    virtual Result doStart() override;
+    virtual void doStop() override;
+
     void onMessageCallback(const AMQP::Message &message, uint64_t deliveryTag, bool redelivered);
 
 public:
@@ -6,6 +6,7 @@
 #include <unordered_set>
 #include <thread>
 #include <mutex>
+#include <functional>
 
 #include <poll.h>
 
@@ -19,6 +20,11 @@ namespace rabbitmq
 {
 class EventLoop
 {
+public:
+    typedef std::function<void()> Task;
+    // called by the loop thread before the loop is started, e.g. to name it and set its affinity
+    typedef std::function<void()> ThreadInit;
+
 private:
     struct ConnectionItem
     {
@@ -36,13 +42,22 @@ private:
     logger::CategoryPtr m_logger;
 
     std::thread m_mainThread;
+    ThreadInit m_threadInit;
     std::queue<ConnectionItem> m_connectionItemsQueue;
     std::mutex m_connectionItemsQueueGuard;
 
+    // the first item is the mailbox eventfd
     std::vector<ConnectionItem> m_connectionItems;
     std::vector<pollfd> m_pollFds;
 
+    // tasks posted by other threads, the loop is woken up when the mailbox becomes not empty
+    std::vector<Task> m_tasks;
+    std::mutex m_tasksGuard;
+    int m_wakeFd = -1;
+
     volatile bool m_isRunning = false;
+    // sockets and the mailbox are polled without blocking, posted tasks do not wake the loop up
+    bool m_isBusyPoll = false;
 
     std::unordered_set<Handler*> m_handlers;
     std::mutex m_handlersGuard;
@@ -53,11 +68,16 @@ private:
     void add(ConnectionItem& item);
     void update(const ConnectionItem& item, std::vector<pollfd>::iterator it);
     void remove(const ConnectionItem& item);
+    void runTasks();
 
 public:
     EventLoop();
     ~EventLoop();
 
+    // it must be set before start
+    void setThreadInit(ThreadInit&& threadInit);
+    // Busy polling trades a CPU core for the latency of socket events and posted tasks, it must be set before start
+    void setBusyPoll(const bool isBusyPoll);
     void start();
     void stop();
 
@@ -66,6 +86,10 @@ public:
 
     template<class... Args>
     void addConnectionItem(Args... args);
+
+    // Runs the task on the event loop thread, tasks are run in the order they were posted.
+    // Channels are not thread safe, so all their operations must be posted
+    void post(Task&& task);
 };
 
 ////////////////////////////////////////////////////////////////////////////
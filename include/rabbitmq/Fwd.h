@@ -9,6 +9,8 @@ class EventLoop;
 class TcpHandler;
 class Handler;
 typedef std::shared_ptr<Handler> HandlerPtr;
+class Acknowledger;
+typedef std::shared_ptr<Acknowledger> AcknowledgerPtr;
 class Consumer;
 typedef std::shared_ptr<Consumer> ConsumerPtr;
 class Publisher;
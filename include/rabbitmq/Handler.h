@@ -70,6 +70,9 @@ public:
 
     template<class... Args>
     Result bindQueueSync(Args... args);
+
+    template<class... Args>
+    Result setQosSync(Args... args);
 };
 } // namespace rabbitmq
 
@@ -86,6 +86,26 @@ inline Result Handler::bindQueueSync(Args... args)
     return result.get();
 }
 
+template<class... Args>
+inline Result Handler::setQosSync(Args... args)
+{
+    SyncObj<Result> result(Result::FAILED, 1, 5);
+    channel().setQos(std::forward<Args>(args)...)
+        .onSuccess([&] () -> void
+            {
+                LOG_INFO(m_logger, "QoS was set");
+                result.set(Result::SUCCESS);
+            })
+        .onError([&] (const char* message) -> void
+            {
+                LOG_ERROR(m_logger, "Cannot set QoS. Error message: %s",
+                    message);
+                result.set(Result::FAILED);
+            });
+    result.wait();
+    return result.get();
+}
+
 } // namespace rabbitmq
 
 #endif // MY_RABBIT_MQ_HANDLER_IMPL_HPP
\ No newline at end of file
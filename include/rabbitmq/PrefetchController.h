@@ -0,0 +1,81 @@
+#ifndef MY_RABBIT_MQ_PREFETCH_CONTROLLER_H
+#define MY_RABBIT_MQ_PREFETCH_CONTROLLER_H
+
+#include <algorithm>
+#include <cstdint>
+
+namespace rabbitmq
+{
+// Tunes the consumer prefetch by the average latency from delivery to settlement.
+// More unacked deliveries wait longer in the processor queues, so prefetch is decreased by a quarter
+// when the average latency exceeds the target and increased by an eighth otherwise.
+// It is adjusted once per prefetch samples, so the effect of the previous change is measured
+class PrefetchController
+{
+private:
+    // weight of the new sample in the moving average
+    static constexpr double smoothing = 0.2;
+
+    uint16_t m_min;
+    uint16_t m_max;
+    uint16_t m_prefetch;
+    double m_targetLatency;
+    double m_averageLatency = 0;
+    bool m_hasAverage = false;
+    uint32_t m_samplesCount = 0;
+
+public:
+    // starts with max prefetch
+    PrefetchController(const uint16_t min, const uint16_t max, const int64_t targetLatencyUs);
+
+    uint16_t prefetch() const;
+    double averageLatency() const;
+
+    // returns true if prefetch is changed
+    bool addSample(const int64_t latencyUs);
+};
+
+inline PrefetchController::PrefetchController(const uint16_t min, const uint16_t max, const int64_t targetLatencyUs):
+    m_min(std::max<uint16_t>(min, 1)),
+    m_max(std::max(max, m_min)),
+    m_prefetch(m_max),
+    m_targetLatency(static_cast<double>(targetLatencyUs))
+{
+}
+
+inline uint16_t PrefetchController::prefetch() const
+{
+    return m_prefetch;
+}
+
+inline double PrefetchController::averageLatency() const
+{
+    return m_averageLatency;
+}
+
+inline bool PrefetchController::addSample(const int64_t latencyUs)
+{
+    m_averageLatency = m_hasAverage ?
+        m_averageLatency + smoothing * (static_cast<double>(latencyUs) - m_averageLatency) :
+        static_cast<double>(latencyUs);
+    m_hasAverage = true;
+    if (++ m_samplesCount < m_prefetch)
+    {
+        return false;
+    }
+    m_samplesCount = 0;
+
+    const uint16_t prefetch = m_prefetch;
+    if (m_averageLatency > m_targetLatency)
+    {
+        m_prefetch = std::max<uint16_t>(m_min, m_prefetch - m_prefetch / 4);
+    }
+    else
+    {
+        m_prefetch = static_cast<uint16_t>(std::min<uint32_t>(m_max, m_prefetch + std::max(m_prefetch / 8, 1)));
+    }
+    return prefetch != m_prefetch;
+}
+} // namespace rabbitmq
+
+#endif // MY_RABBIT_MQ_PREFETCH_CONTROLLER_H
\ No newline at end of file
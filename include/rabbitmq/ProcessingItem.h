@@ -1,35 +1,54 @@
 #ifndef MY_RABBIT_MQ_PROCESSING_ITEM_H
 #define MY_RABBIT_MQ_PROCESSING_ITEM_H
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <amqpcpp.h>
 
+#include "../common/ObjectPool.h"
+
 #include "Fwd.h"
 
 namespace rabbitmq
 {
 struct ProcessingItem
 {
-    std::shared_ptr<AMQP::TcpChannel> m_channel;
+    // encoding of the body selected by the AMQP content-type header
+    enum class ContentType
+    {
+        // user_deal(id,time,amount)
+        TEXT,
+        // app/BinaryProtocol.h
+        BINARY,
+        // app/JsonProtocol.h
+        JSON,
+    };
+    static ContentType contentTypeFromString(const std::string& contentType);
+
+    // body buffer is kept by the pool up to this capacity
+    static constexpr size_t maxPooledMessageSize = 64 * 1024;
+
+    // settles the delivery on the consumer channel
+    AcknowledgerPtr m_acknowledger;
+    // exchange and routing key are not copied, nothing reads them
     std::string m_message;
-    std::string m_exchange;
-    std::string m_routingkey;
-    uint64_t m_deliveryTag;
-    bool m_redelivered;
-    std::string m_args;
+    uint64_t m_deliveryTag = 0;
+    bool m_redelivered = false;
+    ContentType m_contentType = ContentType::TEXT;
+    // AMQP message-id set by the producer, duplicates are dropped by it. Empty if it is not set
+    std::string m_messageId;
+    // time the item is queued to a processor, the enqueue-to-process latency is measured from it
+    std::chrono::steady_clock::time_point m_enqueueTime;
 
+    ProcessingItem() = default;
     ProcessingItem(
-        std::shared_ptr<AMQP::TcpChannel> channel,
+        AcknowledgerPtr acknowledger,
         std::string&& message,
-        std::string&& exchange,
-        std::string&& routingkey,
         const uint64_t deliveryTag,
         const bool redelivered):
-        m_channel(channel),
+        m_acknowledger(acknowledger),
         m_message(std::move(message)),
-        m_exchange(std::move(exchange)),
-        m_routingkey(std::move(routingkey)),
         m_deliveryTag(deliveryTag),
         m_redelivered(redelivered)
     {}
@@ -37,7 +56,47 @@ struct ProcessingItem
     ProcessingItem(ProcessingItem&&) = default;
     ProcessingItem& operator=(const ProcessingItem&) = delete;
     ProcessingItem& operator=(ProcessingItem&&) = default;
+
+    // prepares the item for the next delivery, the buffer is kept
+    void reset();
 };
+
+// Items are acquired by the consumer and released when their deliveries are settled,
+// so there are no allocations per message once the buffers are grown
+typedef common::ObjectPool<ProcessingItem> ProcessingItemPool;
+typedef ProcessingItemPool::Ptr ProcessingItemPtr;
+
+static constexpr const char* binaryContentType = "application/x-leaderboard-binary";
+static constexpr const char* jsonContentType = "application/json";
+
+inline void ProcessingItem::reset()
+{
+    m_acknowledger.reset();
+    if (m_message.capacity() > maxPooledMessageSize)
+    {
+        std::string().swap(m_message);
+    }
+    m_message.clear();
+    m_deliveryTag = 0;
+    m_redelivered = false;
+    m_contentType = ContentType::TEXT;
+    m_messageId.clear();
+    m_enqueueTime = std::chrono::steady_clock::time_point();
+}
+
+inline ProcessingItem::ContentType ProcessingItem::contentTypeFromString(const std::string& contentType)
+{
+    if (contentType == binaryContentType)
+    {
+        return ContentType::BINARY;
+    }
+    if (contentType == jsonContentType)
+    {
+        return ContentType::JSON;
+    }
+    // commands without the header are text
+    return ContentType::TEXT;
+}
 } // namespace rabbitmq
 
 #endif // MY_RABBIT_MQ_PROCESSING_ITEM_H
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef MY_RABBIT_MQ_SETTLEMENT_ORDER_H
+#define MY_RABBIT_MQ_SETTLEMENT_ORDER_H
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace rabbitmq
+{
+// Orders the settlements of the channel deliveries. Deliveries are settled out of order, so a succeeded
+// delivery is acked when all previous deliveries are settled: consecutive acks are coalesced into one tag
+// which is acked with the multiple flag. Rejects are not ordered, they are sent at once.
+// The broker does not deliver more than prefetch unacked messages, so the gap between the first unsettled
+// delivery and the settled one greater than max prefetch means that the first one is stuck
+class SettlementOrder
+{
+private:
+    uint64_t m_maxGap;
+    // all deliveries up to the tag are settled
+    uint64_t m_settledTag = 0;
+    // the greatest succeeded delivery which is settled in order and not acked yet, 0 if there is no such
+    uint64_t m_ackTag = 0;
+    // deliveries that are settled before some of the previous ones: tag to success
+    std::unordered_map<uint64_t, bool> m_outOfOrder;
+    // the stuck delivery is reported once
+    bool m_isGapReported = false;
+
+public:
+    explicit SettlementOrder(const uint64_t maxGap);
+
+    // returns true if the gap exceeds max gap for the first time since the first unsettled delivery was received.
+    // Deliveries that are settled already are ignored
+    bool settle(const uint64_t deliveryTag, const bool isSucceeded);
+
+    // returns the tag to ack with the multiple flag and resets it, 0 if there is nothing to ack
+    uint64_t takeAckTag();
+
+    uint64_t ackTag() const;
+    uint64_t settledTag() const;
+    size_t outOfOrderCount() const;
+};
+
+inline SettlementOrder::SettlementOrder(const uint64_t maxGap):
+    m_maxGap(maxGap)
+{
+}
+
+inline bool SettlementOrder::settle(const uint64_t deliveryTag, const bool isSucceeded)
+{
+    if (deliveryTag <= m_settledTag)
+    {
+        return false;
+    }
+    if (deliveryTag != m_settledTag + 1)
+    {
+        m_outOfOrder.emplace(deliveryTag, isSucceeded);
+        if (m_isGapReported || deliveryTag - m_settledTag <= m_maxGap)
+        {
+            return false;
+        }
+        m_isGapReported = true;
+        return true;
+    }
+
+    m_settledTag = deliveryTag;
+    m_ackTag = isSucceeded ? deliveryTag : m_ackTag;
+    m_isGapReported = false;
+    for (auto it = m_outOfOrder.find(m_settledTag + 1); m_outOfOrder.end() != it; it = m_outOfOrder.find(m_settledTag + 1))
+    {
+        m_settledTag = it->first;
+        m_ackTag = it->second ? it->first : m_ackTag;
+        m_outOfOrder.erase(it);
+    }
+    return false;
+}
+
+inline uint64_t SettlementOrder::takeAckTag()
+{
+    const uint64_t ackTag = m_ackTag;
+    m_ackTag = 0;
+    return ackTag;
+}
+
+inline uint64_t SettlementOrder::ackTag() const
+{
+    return m_ackTag;
+}
+
+inline uint64_t SettlementOrder::settledTag() const
+{
+    return m_settledTag;
+}
+
+inline size_t SettlementOrder::outOfOrderCount() const
+{
+    return m_outOfOrder.size();
+}
+} // namespace rabbitmq
+
+#endif // MY_RABBIT_MQ_SETTLEMENT_ORDER_H
\ No newline at end of file
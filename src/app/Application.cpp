@@ -160,6 +160,8 @@ Result Application::doStart()
 
 void Application::doStop()
 {
+    // logic settles the deliveries of the flushed deals and of the completed storage writes before it is stopped,
+    // so the acknowledger of the consumer is closed after them. Messages received meanwhile are requeued
     m_logic.stop();
     m_publisher->stop();
     m_consumer->stop();
@@ -67,7 +67,32 @@ Result ApplicationBase::configure(const std::string& filename)
             "Default values will be used", e.what());
     }
 
-    Result res = doConfigure(cfg);
+    Result res = m_eventLoopPlacement.read(cfg, "threads.event-loop", m_logger);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+    bool isBusyPoll = false;
+    try
+    {
+        const Setting& setting = cfg.lookup("rabbitmq");
+        if (!setting.lookupValue("busy-poll", isBusyPoll))
+        {
+            LOG_WARN(m_logger, "Canont find 'busy-poll' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'rabbitmq' section in configuration. Default values will be used");
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <rabbitmq.busy-poll: %s>", (isBusyPoll ? "true" : "false"));
+    m_eventLoop.setBusyPoll(isBusyPoll);
+    m_eventLoop.setThreadInit([this] () -> void
+        {
+            m_eventLoopPlacement.apply("rmq-event-loop", 0, m_logger);
+        });
+
+    res = doConfigure(cfg);
     if (Result::SUCCESS != res)
     {
         return res;
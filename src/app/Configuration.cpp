@@ -72,4 +72,52 @@ Result RmqConsumerCfg::read(const libconfig::Config& cfg, const std::string& sec
     return Result::SUCCESS;
 }
 
-} // namespace app
+Result ThreadPlacementCfg::read(const libconfig::Config& cfg, const std::string& section, logger::CategoryPtr& log)
+{
+    using namespace libconfig;
+
+    std::string cpus;
+    try
+    {
+        const Setting& setting = cfg.lookup(section);
+        if (!setting.lookupValue("cpus", cpus))
+        {
+            LOG_WARN(log, "Canont find 'cpus' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("spread", m_isSpread))
+        {
+            LOG_WARN(log, "Canont find 'spread' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("numa-local", m_isNumaLocal))
+        {
+            LOG_WARN(log, "Canont find 'numa-local' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(log, "Canont find section '%s' in configuration. Default values will be used", section.c_str());
+    }
+    if (!common::parseCpuList(cpus, m_cpus))
+    {
+        LOG_ERROR(log, "Configuration is invalid: cpus '%s' of '%s' is not a list of CPUs (e.g. 0,2-5)",
+            cpus.c_str(), section.c_str());
+        return Result::CFG_INVALID;
+    }
+    LOG_INFO(log, "Configuration parameters: <section: %s, cpus: %s, spread: %s, numa-local: %s>",
+        section.c_str(), common::cpuListToString(m_cpus).c_str(),
+        (m_isSpread ? "true" : "false"), (m_isNumaLocal ? "true" : "false"));
+    return Result::SUCCESS;
+}
+
+void ThreadPlacementCfg::apply(const std::string& name, const size_t index, logger::CategoryPtr& log) const
+{
+    if (!common::applyThreadPlacement(name, *this, index))
+    {
+        LOG_WARN(log, "Cannot apply placement to thread '%s' completely, CPUs may be out of the allowed ones", name.c_str());
+    }
+    LOG_INFO(log, "Thread '%s' is bound to CPUs %s (requested: %s), NUMA node: %d, numa-local: %s",
+        name.c_str(), common::cpuListToString(common::currentThreadCpus()).c_str(),
+        common::cpuListToString(m_cpus).c_str(), common::currentNumaNode(), (m_isNumaLocal ? "true" : "false"));
+}
+
+} // namespace app
\ No newline at end of file
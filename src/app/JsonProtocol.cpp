@@ -0,0 +1,644 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <common/Utils.h>
+#include <common/TimeParser.h>
+#include <app/JsonProtocol.h>
+
+namespace app
+{
+namespace json
+{
+
+namespace
+{
+// max nesting of the skipped values
+static constexpr int32_t maxDepth = 32;
+
+class Tokenizer
+{
+private:
+    char* m_it;
+    char* const m_end;
+
+private:
+    bool parseHex4(uint32_t& value);
+    bool parseCodePoint(char*& out);
+
+public:
+    Tokenizer(char* const begin, char* const end):
+        m_it(begin), m_end(end)
+    {}
+
+    void skipSpaces()
+    {
+        while (m_it != m_end && (' ' == *m_it || '\t' == *m_it || '\n' == *m_it || '\r' == *m_it))
+        {
+            ++ m_it;
+        }
+    }
+
+    bool isNext(const char c)
+    {
+        skipSpaces();
+        return m_it != m_end && *m_it == c;
+    }
+
+    bool consume(const char c)
+    {
+        if (!isNext(c))
+        {
+            return false;
+        }
+        ++ m_it;
+        return true;
+    }
+
+    bool isEnd()
+    {
+        skipSpaces();
+        return m_it == m_end;
+    }
+
+    bool parseString(StringView& str);
+    // the string is validated but not unescaped, so the body is not modified
+    bool skipString(StringView& raw);
+    bool parseInt64(int64_t& value);
+    bool skipValue(const int32_t depth);
+};
+
+bool Tokenizer::parseHex4(uint32_t& value)
+{
+    if (m_end - m_it < 4)
+    {
+        return false;
+    }
+    value = 0;
+    for (const char* const last = m_it + 4; m_it != last; ++ m_it)
+    {
+        const char c = *m_it;
+        uint32_t digit;
+        if (c >= '0' && c <= '9')
+        {
+            digit = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            digit = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            digit = c - 'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    return true;
+}
+
+// \uXXXX or surrogate pair \uXXXX\uXXXX, encoded as UTF-8 which is never longer than the escape
+bool Tokenizer::parseCodePoint(char*& out)
+{
+    uint32_t cp;
+    if (!parseHex4(cp) || (cp >= 0xDC00 && cp <= 0xDFFF))
+    {
+        return false;
+    }
+    if (cp >= 0xD800 && cp <= 0xDBFF)
+    {
+        uint32_t low;
+        if (m_end - m_it < 2 || '\\' != m_it[0] || 'u' != m_it[1])
+        {
+            return false;
+        }
+        m_it += 2;
+        if (!parseHex4(low) || low < 0xDC00 || low > 0xDFFF)
+        {
+            return false;
+        }
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    if (cp < 0x80)
+    {
+        *out++ = static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        *out++ = static_cast<char>(0xC0 | (cp >> 6));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        *out++ = static_cast<char>(0xE0 | (cp >> 12));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        *out++ = static_cast<char>(0xF0 | (cp >> 18));
+        *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return true;
+}
+
+// unescaped chars are written behind the read position, so the string is never overwritten before it is read
+bool Tokenizer::parseString(StringView& str)
+{
+    if (!consume('"'))
+    {
+        return false;
+    }
+
+    char* const begin = m_it;
+    char* out = m_it;
+    while (m_it != m_end)
+    {
+        const char c = *m_it++;
+        if ('"' == c)
+        {
+            str = StringView(begin, out - begin);
+            return true;
+        }
+        if (static_cast<uint8_t>(c) < 0x20)
+        {
+            return false;
+        }
+        if ('\\' != c)
+        {
+            *out++ = c;
+            continue;
+        }
+
+        if (m_it == m_end)
+        {
+            return false;
+        }
+        switch (*m_it++)
+        {
+            case '"':
+                *out++ = '"';
+                break;
+            case '\\':
+                *out++ = '\\';
+                break;
+            case '/':
+                *out++ = '/';
+                break;
+            case 'b':
+                *out++ = '\b';
+                break;
+            case 'f':
+                *out++ = '\f';
+                break;
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            case 't':
+                *out++ = '\t';
+                break;
+            case 'u':
+                if (!parseCodePoint(out))
+                {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+bool Tokenizer::skipString(StringView& raw)
+{
+    if (!consume('"'))
+    {
+        return false;
+    }
+
+    const char* const begin = m_it;
+    while (m_it != m_end)
+    {
+        const char c = *m_it++;
+        if ('"' == c)
+        {
+            raw = StringView(begin, m_it - 1 - begin);
+            return true;
+        }
+        if (static_cast<uint8_t>(c) < 0x20)
+        {
+            return false;
+        }
+        if ('\\' != c)
+        {
+            continue;
+        }
+
+        if (m_it == m_end)
+        {
+            return false;
+        }
+        uint32_t cp;
+        switch (*m_it++)
+        {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                break;
+            case 'u':
+                if (!parseHex4(cp))
+                {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+bool Tokenizer::parseInt64(int64_t& value)
+{
+    skipSpaces();
+    const char* it = m_it;
+    if (!common::parseInt64(it, m_end, value))
+    {
+        return false;
+    }
+    // fractions and exponents are not integers
+    if (it != m_end && ('.' == *it || 'e' == *it || 'E' == *it))
+    {
+        return false;
+    }
+    m_it += it - m_it;
+    return true;
+}
+
+bool Tokenizer::skipValue(const int32_t depth)
+{
+    if (depth > maxDepth || isEnd())
+    {
+        return false;
+    }
+
+    StringView str;
+    switch (*m_it)
+    {
+        case '"':
+            return skipString(str);
+        case '{':
+            ++ m_it;
+            if (consume('}'))
+            {
+                return true;
+            }
+            do
+            {
+                if (!skipString(str) || !consume(':') || !skipValue(depth + 1))
+                {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        case '[':
+            ++ m_it;
+            if (consume(']'))
+            {
+                return true;
+            }
+            do
+            {
+                if (!skipValue(depth + 1))
+                {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        default:
+            break;
+    }
+
+    // number, true, false or null
+    const char* const begin = m_it;
+    while (m_it != m_end && (std::isalnum(static_cast<uint8_t>(*m_it)) || '-' == *m_it || '+' == *m_it || '.' == *m_it))
+    {
+        ++ m_it;
+    }
+    return begin != m_it;
+}
+
+template<size_t N>
+inline bool isKey(const StringView& key, const char (&name)[N])
+{
+    return key.size() == N - 1 && 0 == std::memcmp(key.data(), name, N - 1);
+}
+
+const char* typeToString(const CommandType type)
+{
+    // short names, command names without user_ prefix
+    return commandTypeToStr(type) + sizeof("user_") - 1;
+}
+
+// Unescapes the raw string into the storage if it has escapes
+StringView unescape(const StringView& raw, std::string& storage)
+{
+    if (raw.end() == std::find(raw.begin(), raw.end(), '\\'))
+    {
+        return raw;
+    }
+    storage.assign(1, '"');
+    storage.append(raw.data(), raw.size());
+    storage += '"';
+    Tokenizer tokenizer(&storage[0], &storage[0] + storage.size());
+    StringView str;
+    return tokenizer.parseString(str) ? str : StringView();
+}
+
+void appendString(std::string& buf, const StringView& str)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    buf += '"';
+    for (const char c : str)
+    {
+        switch (c)
+        {
+            case '"':
+                buf += "\\\"";
+                break;
+            case '\\':
+                buf += "\\\\";
+                break;
+            default:
+                if (static_cast<uint8_t>(c) < 0x20)
+                {
+                    buf += "\\u00";
+                    buf += hexDigits[static_cast<uint8_t>(c) >> 4];
+                    buf += hexDigits[static_cast<uint8_t>(c) & 0xF];
+                    break;
+                }
+                buf += c;
+                break;
+        }
+    }
+    buf += '"';
+}
+} // namespace
+
+CommandType typeFromString(const StringView& type)
+{
+    static constexpr size_t prefixSize = sizeof("user_") - 1;
+    const StringView name = (type.size() > prefixSize && 0 == std::memcmp(type.data(), "user_", prefixSize)) ?
+        type.substr(prefixSize, type.size() - prefixSize) : type;
+
+    if (isKey(name, "deal"))
+    {
+        return CommandType::USER_DEAL;
+    }
+    if (isKey(name, "deal_won"))
+    {
+        return CommandType::USER_DEAL_WON;
+    }
+    if (isKey(name, "registered"))
+    {
+        return CommandType::USER_REGISTERED;
+    }
+    if (isKey(name, "renamed"))
+    {
+        return CommandType::USER_RENAMED;
+    }
+    if (isKey(name, "connected"))
+    {
+        return CommandType::USER_CONNECTED;
+    }
+    if (isKey(name, "disconnected"))
+    {
+        return CommandType::USER_DISCONNECTED;
+    }
+    return CommandType::UNKNOWN;
+}
+
+Result decode(char* const body, const size_t size, Command& cmd)
+{
+    enum : uint32_t
+    {
+        HAS_TYPE = 1 << 0,
+        HAS_ID = 1 << 1,
+        HAS_NAME = 1 << 2,
+        HAS_TIME = 1 << 3,
+        HAS_AMOUNT = 1 << 4,
+    };
+
+    Tokenizer tokenizer(body, body + size);
+    if (!tokenizer.consume('{'))
+    {
+        return Result::INVALID_FORMAT;
+    }
+
+    uint32_t fields = 0;
+    if (!tokenizer.consume('}'))
+    {
+        do
+        {
+            StringView key;
+            if (!tokenizer.parseString(key) || !tokenizer.consume(':'))
+            {
+                return Result::INVALID_FORMAT;
+            }
+
+            bool isParsed;
+            if (isKey(key, "type"))
+            {
+                StringView type;
+                isParsed = tokenizer.parseString(type);
+                cmd.m_type = typeFromString(type);
+                fields |= HAS_TYPE;
+            }
+            else if (isKey(key, "id"))
+            {
+                isParsed = tokenizer.parseInt64(cmd.m_id);
+                fields |= HAS_ID;
+            }
+            else if (isKey(key, "name"))
+            {
+                isParsed = tokenizer.parseString(cmd.m_name);
+                fields |= HAS_NAME;
+            }
+            else if (isKey(key, "time"))
+            {
+                if (tokenizer.isNext('"'))
+                {
+                    StringView time;
+                    isParsed = tokenizer.parseString(time) &&
+                        Result::SUCCESS == common::isoTimeFromString(cmd.m_time, time.data(), time.size());
+                }
+                else
+                {
+                    int64_t seconds = 0;
+                    isParsed = tokenizer.parseInt64(seconds);
+                    cmd.m_time = static_cast<std::time_t>(seconds);
+                }
+                fields |= HAS_TIME;
+            }
+            else if (isKey(key, "amount"))
+            {
+                isParsed = tokenizer.parseInt64(cmd.m_amount);
+                fields |= HAS_AMOUNT;
+            }
+            else
+            {
+                isParsed = tokenizer.skipValue(0);
+            }
+
+            if (!isParsed)
+            {
+                return Result::INVALID_FORMAT;
+            }
+        } while (tokenizer.consume(','));
+
+        if (!tokenizer.consume('}'))
+        {
+            return Result::INVALID_FORMAT;
+        }
+    }
+    if (!tokenizer.isEnd() || !(fields & HAS_TYPE) || !(fields & HAS_ID))
+    {
+        return Result::INVALID_FORMAT;
+    }
+
+    switch (cmd.m_type)
+    {
+        case CommandType::USER_REGISTERED:
+        case CommandType::USER_RENAMED:
+            return ((fields & HAS_NAME) && !cmd.m_name.empty()) ? Result::SUCCESS : Result::INVALID_FORMAT;
+        case CommandType::USER_DEAL:
+        case CommandType::USER_DEAL_WON:
+            return ((fields & HAS_TIME) && (fields & HAS_AMOUNT)) ? Result::SUCCESS : Result::INVALID_FORMAT;
+        case CommandType::USER_CONNECTED:
+        case CommandType::USER_DISCONNECTED:
+            return Result::SUCCESS;
+        case CommandType::UNKNOWN:
+        default:
+            break;
+    }
+    return Result::CMD_NOT_SUPPORTED;
+}
+
+bool peek(const char* const body, const size_t size, Command& cmd)
+{
+    // only the methods which do not write are called, so the body is not modified
+    Tokenizer tokenizer(const_cast<char*>(body), const_cast<char*>(body) + size);
+    if (!tokenizer.consume('{'))
+    {
+        return false;
+    }
+
+    bool hasId = false;
+    std::string storage;
+    if (!tokenizer.consume('}'))
+    {
+        do
+        {
+            StringView key;
+            if (!tokenizer.skipString(key) || !tokenizer.consume(':'))
+            {
+                return false;
+            }
+
+            // the last value of the key is taken as by decode
+            bool isParsed;
+            key = unescape(key, storage);
+            if (isKey(key, "type"))
+            {
+                StringView type;
+                isParsed = tokenizer.isNext('"') ? tokenizer.skipString(type) : tokenizer.skipValue(0);
+                cmd.m_type = typeFromString(unescape(type, storage));
+            }
+            else if (isKey(key, "id"))
+            {
+                isParsed = tokenizer.parseInt64(cmd.m_id);
+                hasId = true;
+            }
+            else
+            {
+                isParsed = tokenizer.skipValue(0);
+            }
+
+            if (!isParsed)
+            {
+                return false;
+            }
+        } while (tokenizer.consume(','));
+
+        if (!tokenizer.consume('}'))
+        {
+            return false;
+        }
+    }
+    return hasId && tokenizer.isEnd();
+}
+
+Result encode(std::string& buf, const Command& cmd)
+{
+    // the command is validated before anything is appended, so the buffer is not changed on failure
+    switch (cmd.m_type)
+    {
+        case CommandType::USER_REGISTERED:
+        case CommandType::USER_RENAMED:
+            if (cmd.m_name.empty())
+            {
+                return Result::INVALID_FORMAT;
+            }
+            break;
+        case CommandType::USER_CONNECTED:
+        case CommandType::USER_DISCONNECTED:
+        case CommandType::USER_DEAL:
+        case CommandType::USER_DEAL_WON:
+            break;
+        case CommandType::UNKNOWN:
+        default:
+            return Result::CMD_NOT_SUPPORTED;
+    }
+
+    buf += "{\"type\":\"";
+    buf += typeToString(cmd.m_type);
+    buf += "\",\"id\":";
+    buf += std::to_string(cmd.m_id);
+    switch (cmd.m_type)
+    {
+        case CommandType::USER_REGISTERED:
+        case CommandType::USER_RENAMED:
+            buf += ",\"name\":";
+            appendString(buf, cmd.m_name);
+            break;
+        case CommandType::USER_DEAL:
+        case CommandType::USER_DEAL_WON:
+            buf += ",\"time\":";
+            buf += std::to_string(static_cast<int64_t>(cmd.m_time));
+            buf += ",\"amount\":";
+            buf += std::to_string(cmd.m_amount);
+            break;
+        default:
+            break;
+    }
+    buf += '}';
+    return Result::SUCCESS;
+}
+} // namespace json
+} // namespace app
\ No newline at end of file
@@ -1,16 +1,34 @@
+#include <future>
+
 #include <libconfig.h++>
 
 #include <common/Utils.h>
+#include <common/Partition.h>
 #include <logger/LoggerDefines.h>
 #include <app/Logic.h>
 #include <db/InMemoryStorage.h>
 #include <db/MongodbStorage.h>
+#include <db/TieredStorage.h>
 #include <rabbitmq/Publisher.h>
+#include <rabbitmq/Acknowledger.h>
 
 namespace app
 {
 
-Logic::Logic()
+thread_local Logic::Delivery* Logic::m_currentDelivery = nullptr;
+thread_local Logic::Settlements* Logic::m_currentSettlements = nullptr;
+
+void Logic::Delivery::reset()
+{
+    m_item.reset();
+    m_processor = nullptr;
+    m_pendingCount = 1;
+    m_isFailed = false;
+    m_isDedupStarted = false;
+}
+
+Logic::Logic():
+    m_parser(*this)
 {
     m_logger = logger::Logger::getLogCategory("APP_LOGIC");
 }
@@ -28,108 +46,144 @@ void Logic::registerPublisher(rabbitmq::PublisherPtr publisher, const RmqHandler
 
 void Logic::loop()
 {
-    using std::chrono::system_clock;
-
-    static constexpr uint32_t maxSleepSeconds = 60;
-    while (m_loopIsRunning)
+    if (!m_loopIsRunning)
     {
-        time_t startTime = time(nullptr);
-        LOG_INFO(m_logger, "Logic loop was started at %s", common::timeToString(startTime).c_str());
-
-        loopFunc(startTime);
+        return ;
+    }
 
-        time_t endTime = time(nullptr);
+    time_t startTime = time(nullptr);
+    LOG_INFO(m_logger, "Logic loop was started at %s", common::timeToString(startTime).c_str());
 
-        uint32_t diffSeconds = static_cast<uint32_t>(difftime(endTime, startTime));
-        LOG_INFO(m_logger, "Logic loop was ended at %s. Duration: %u seconds",
-            common::timeToString(endTime).c_str(), diffSeconds);
+    if (!m_publisher || !m_publisher->channelPtr())
+    {
+        LOG_WARN(m_logger, "Do not calculate leaderboard since publisher is missing or not ready");
+        finishLoop(startTime);
+        return ;
+    }
 
-        while (m_loopIsRunning && diffSeconds < static_cast<uint32_t>(m_loopIntervalSeconds))
+    // the worker is not held while the storage calculates leaderboards,
+    // the messages are serialized by the pool when they are ready
+    ++ m_loopFetchesCount;
+    m_storage->getLeaderboardsAsync(10, 10, 10).then([this, startTime] (const Result res, db::Leaderboards&& leaderboards) -> void
         {
-            uint32_t sleepSeconds = std::min(maxSleepSeconds, m_loopIntervalSeconds - diffSeconds);
-            LOG_DEBUG(m_logger, "Logic loop will sleep for %u seconds", sleepSeconds);
-            std::this_thread::sleep_for(std::chrono::seconds(sleepSeconds));
-            endTime = time(nullptr);
-            diffSeconds = static_cast<uint32_t>(difftime(endTime, startTime));
-        }
-    }
+            std::shared_ptr<db::Leaderboards> leaderboardsPtr = std::make_shared<db::Leaderboards>(std::move(leaderboards));
+            m_pool.post([this, startTime, res, leaderboardsPtr] () -> void
+                {
+                    if (Result::SUCCESS != res)
+                    {
+                        LOG_WARN(m_logger, "Cannot get leaderboard");
+                    }
+                    else
+                    {
+                        loopFunc(startTime, *leaderboardsPtr);
+                    }
+                    finishLoop(startTime);
+                },
+                common::ThreadPool::Priority::LOW);
+            -- m_loopFetchesCount;
+        });
 }
 
-void Logic::loopFunc(const time_t startTime)
+void Logic::finishLoop(const time_t startTime)
 {
-    if (!m_publisher || !m_publisher->channelPtr())
+    time_t endTime = time(nullptr);
+
+    uint32_t diffSeconds = static_cast<uint32_t>(difftime(endTime, startTime));
+    LOG_INFO(m_logger, "Logic loop was ended at %s. Duration: %u seconds",
+        common::timeToString(endTime).c_str(), diffSeconds);
+
+    // the worker is not held between iterations
+    uint32_t sleepSeconds = 0;
+    if (diffSeconds < static_cast<uint32_t>(m_loopIntervalSeconds))
     {
-        LOG_WARN(m_logger, "Do not calculate leaderboard since publisher is missing or not ready");
-        return ;
+        sleepSeconds = m_loopIntervalSeconds - diffSeconds;
     }
+    LOG_DEBUG(m_logger, "Logic loop will sleep for %u seconds", sleepSeconds);
+    m_pool.postAfter(std::chrono::seconds(sleepSeconds), [this] () -> void
+        {
+            loop();
+        },
+        common::ThreadPool::Priority::LOW);
+}
 
-    db::Leaderboards leaderboards;
-    Result res = m_storage->getLeaderboards(leaderboards, 10, 10, 10);
-    if (Result::SUCCESS != res)
+void Logic::loopFunc(const time_t startTime, const db::Leaderboards& leaderboards)
+{
+    // messages are serialized by chunks in parallel with low priority and published in order
+    static constexpr size_t usersPerTask = 64;
+    std::vector<const db::Leaderboards::value_type*> users;
+    users.reserve(leaderboards.size());
+    for (auto&& userLb : leaderboards)
     {
-        LOG_WARN(m_logger, "Cannot get leaderboard");
-        return;
+        users.push_back(&userLb);
     }
+    std::vector<std::string> messages(users.size());
+    m_pool.parallelFor((users.size() + usersPerTask - 1) / usersPerTask,
+        [this, &users, &messages, startTime] (const size_t task) -> void
+        {
+            for (size_t i = task * usersPerTask; i < std::min(users.size(), (task + 1) * usersPerTask); ++ i)
+            {
+                const db::Leaderboards::value_type& userLb = *users[i];
+                std::string& message = messages[i];
+                message += "{\"id\":";
+                message += std::to_string(userLb.first.m_id);
+                message += ",";
+                message += "\"name\":";
+                message += "\"";
+                message += userLb.first.m_name;
+                message += "\"";
+                message += ",";
+
+                message += "\"leaderboard\":";
+                message += "{";
+                message += "\"time\":";
+                message += "\"";
+                message += common::timeToString(startTime);
+                message += "\"";
 
-    res = m_publisher->startTransactionSync();
+                message += ",";
+                message += "\"scores\":";
+                message += "[";
+                LOG_DEBUG(m_logger, "User %ld:%s leaderboard:", userLb.first.m_id, userLb.first.m_name.c_str());
+                for (auto&& scoreUser : userLb.second)
+                {
+                    LOG_DEBUG(m_logger, "\t#%15ld %15ld -> <%ld, %s>",
+                        scoreUser.first.m_position, scoreUser.first.m_score, scoreUser.second.m_id, scoreUser.second.m_name.c_str());
+                    message += "{";
+                    message += "\"position\":";
+                    message += std::to_string(scoreUser.first.m_position);
+                    message += ",";
+                    message += "\"id\":";
+                    message += std::to_string(scoreUser.second.m_id);
+                    message += ",";
+                    message += "\"name\":";
+                    message += "\"";
+                    message += scoreUser.second.m_name;
+                    message += "\"";
+                    message += ",";
+                    message += "\"score\":";
+                    message += std::to_string(scoreUser.first.m_score);
+                    message += "},";
+                }
+                if (!userLb.second.empty())
+                {
+                    // remove comma
+                    message.pop_back();
+                }
+                message += "]";
+                message += "}";
+                message += "}";
+            }
+        });
+
+    Result res = m_publisher->startTransactionSync();
     if (Result::SUCCESS != res)
     {
         LOG_ERROR(m_logger, "Cannot start transaction");
         return ;
     }
 
-    for (auto&& userLb : leaderboards)
+    for (auto&& message : messages)
     {
-        std::string message;
-        message += "{\"id\":";
-        message += std::to_string(userLb.first.m_id);
-        message += ",";
-        message += "\"name\":";
-        message += "\"";
-        message += userLb.first.m_name;
-        message += "\"";
-        message += ",";
-
-        message += "\"leaderboard\":";
-        message += "{";
-        message += "\"time\":";
-        message += "\"";
-        message += common::timeToString(startTime);
-        message += "\"";
-
-        message += ",";
-        message += "\"scores\":";
-        message += "[";
-        LOG_DEBUG(m_logger, "User %ld:%s leaderboard:", userLb.first.m_id, userLb.first.m_name.c_str());
-        for (auto&& scoreUser : userLb.second)
-        {
-            LOG_DEBUG(m_logger, "\t#%15ld %15ld -> <%ld, %s>",
-                scoreUser.first.m_position, scoreUser.first.m_score, scoreUser.second.m_id, scoreUser.second.m_name.c_str());
-            message += "{";
-            message += "\"position\":";
-            message += std::to_string(scoreUser.first.m_position);
-            message += ",";
-            message += "\"id\":";
-            message += std::to_string(scoreUser.second.m_id);
-            message += ",";
-            message += "\"name\":";
-            message += "\"";
-            message += scoreUser.second.m_name;
-            message += "\"";
-            message += ",";
-            message += "\"score\":";
-            message += std::to_string(scoreUser.first.m_score);
-            message += "},";
-        }
-        if (!userLb.second.empty())
-        {
-            // remove comma
-            message.pop_back();
-        }
-        message += "]";
-        message += "}";
-        message += "}";
-
         // send message
         if (!m_publisher->publish(m_publisherCfg.m_exchangeName, m_publisherCfg.m_routingKey, message))
         {
@@ -148,38 +202,306 @@ void Logic::loopFunc(const time_t startTime)
     }
 }
 
-void Logic::processingThreadFunc()
+void Logic::schedule(Processor& processor)
 {
-    while (m_isProcessingThreadsRunning)
+    if (processor.m_isScheduled.exchange(true))
     {
-        std::unique_lock<std::mutex> l(m_processingQueueGuard);
+        return ;
+    }
+    m_pool.post([this, &processor] () -> void
+        {
+            drain(processor);
+        },
+        common::ThreadPool::Priority::HIGH);
+}
+
+void Logic::drain(Processor& processor)
+{
+    // deliveries settled by the drain are acked together
+    Settlements settlements;
+    m_currentSettlements = &settlements;
 
-        while (m_isProcessingThreadsRunning && m_processingQueue.empty())
+    rabbitmq::ProcessingItemPtr item;
+    for (int32_t i = 0; i < m_drainBatchSize && m_isProcessing && processor.tryPop(item); ++ i)
+    {
+        processItem(processor, std::move(item));
+    }
+    if (processor.empty())
+    {
+        // merged deals are not held while the processor is idle
+        flushDeals(processor);
+    }
+    else
+    {
+        storeDealBatch(processor);
+    }
+
+    m_currentSettlements = nullptr;
+    settlements.flush();
+
+    // the item pushed after the last pop is seen here or its producer posts the task
+    processor.m_isScheduled = false;
+    if (m_isProcessing && !processor.empty())
+    {
+        schedule(processor);
+    }
+}
+
+void Logic::processItem(Processor& processor, rabbitmq::ProcessingItemPtr&& item)
+{
+    if (!item->m_acknowledger)
+    {
+        LOG_ERROR(m_logger, "Cannot process item without acknowledger");
+        return ;
+    }
+
+    // the delivery holds the item until it is settled
+    Delivery* delivery = processor.m_deliveries.acquire().release();
+    delivery->m_item = std::move(item);
+    delivery->m_processor = &processor;
+    delivery->m_dequeueTime = std::chrono::steady_clock::now();
+    processor.m_enqueueLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        delivery->m_dequeueTime - delivery->m_item->m_enqueueTime).count());
+
+    // the id is remembered when the delivery is succeeded, so a redelivery is processed again if the writes fail
+    if (processor.m_dedup && !delivery->m_item->m_messageId.empty())
+    {
+        // the item is taken by the filter if it is held
+        const uint64_t deliveryTag = delivery->m_item->m_deliveryTag;
+        switch (processor.m_dedup->start(delivery->m_item))
         {
-            m_processingQueueCv.wait(l);
+            case MessageDedup::Verdict::PROCESS:
+                delivery->m_isDedupStarted = true;
+                break;
+            case MessageDedup::Verdict::DUPLICATE:
+                LOG_DEBUG(m_logger, "Duplicate message is dropped <message id: %s; redelivered: %s>",
+                    delivery->m_item->m_messageId.c_str(), (delivery->m_item->m_redelivered ? "true" : "false"));
+                completeDelivery(*delivery, Result::SUCCESS);
+                return ;
+            case MessageDedup::Verdict::IN_FLIGHT:
+                // writes of the original delivery are pending (e.g. the channel is reconnected meanwhile),
+                // the duplicate is held by the filter and settled with the original delivery
+                LOG_DEBUG(m_logger, "Message is in flight, its duplicate is held <delivery tag: %lu>", deliveryTag);
+                processor.m_deliveries.release(delivery);
+                return ;
         }
+    }
 
-        // get item and unlock queue
-        rabbitmq::ProcessingItem item = std::move(m_processingQueue.front());
-        m_processingQueue.pop();
-        l.unlock();
+    m_currentDelivery = delivery;
+    Result res = m_parser.parseMessage(std::move(*delivery->m_item));
+    m_currentDelivery = nullptr;
 
-        if (!item.m_channel)
+    completeDelivery(*delivery, res);
+
+    if (processor.m_deals.isReady(DealCoalescer<Delivery*>::Clock::now()))
+    {
+        flushDeals(processor);
+    }
+}
+
+void Logic::autoscale()
+{
+    if (!m_isProcessing)
+    {
+        return ;
+    }
+
+    size_t backlog = 0;
+    uint64_t latencySumUs = 0;
+    uint64_t settledCount = 0;
+    for (auto&& processor : m_processors)
+    {
+        backlog += processor->size();
+        latencySumUs += processor->m_latencySumUs.exchange(0, std::memory_order_relaxed);
+        settledCount += processor->m_settledCount.exchange(0, std::memory_order_relaxed);
+    }
+    const double averageLatencyUs = (0 == settledCount) ? 0 : static_cast<double>(latencySumUs) / settledCount;
+
+    const uint32_t workersCount = static_cast<uint32_t>(m_pool.activeWorkersCount());
+    const uint32_t newWorkersCount = m_autoscaler->update(workersCount, backlog, averageLatencyUs);
+    if (newWorkersCount != workersCount)
+    {
+        m_pool.setActiveWorkersCount(newWorkersCount);
+        LOG_INFO(m_logger, "Active workers count is changed from %u to %u <backlog: %zu; average latency: %.0f us>",
+            workersCount, newWorkersCount, backlog, averageLatencyUs);
+    }
+
+    // ticks have the high priority, so scaling up is not delayed by the backlog
+    m_pool.postAfter(std::chrono::milliseconds(m_autoscalingIntervalMs), [this] () -> void
         {
-            LOG_ERROR(m_logger, "Cannot process item without channel");
-            continue;
-        }
+            autoscale();
+        },
+        common::ThreadPool::Priority::HIGH);
+}
+
+void Logic::scheduleLatencyReport()
+{
+    m_pool.postAfter(std::chrono::seconds(m_latencyReportIntervalSeconds), [this] () -> void
+        {
+            if (!m_isProcessing)
+            {
+                return ;
+            }
+            reportLatency();
+            scheduleLatencyReport();
+        },
+        common::ThreadPool::Priority::HIGH);
+}
+
+void Logic::reportLatency()
+{
+    common::LatencyHistogram latency;
+    for (auto&& processor : m_processors)
+    {
+        processor->m_enqueueLatency.moveTo(latency);
+    }
+    if (0 == latency.count())
+    {
+        return ;
+    }
+
+    static constexpr double nsPerUs = 1000.0;
+    LOG_INFO(m_logger, "Enqueue-to-process latency <workers: %s; messages: %lu; p50: %.1f us; p99: %.1f us; max: %.1f us>",
+        (m_workerSpinUs > 0 ? "spin-then-park" : "park"), latency.count(),
+        latency.percentile(0.5) / nsPerUs, latency.percentile(0.99) / nsPerUs, latency.max() / nsPerUs);
+}
+
+void Logic::completeDelivery(Delivery& delivery, const Result res)
+{
+    if (Result::SUCCESS != res)
+    {
+        LOG_ERROR(m_logger, "Cannot process message. Result: %d(%s)",
+            static_cast<int32_t>(res), common::resultToStr(res));
+        delivery.m_isFailed = true;
+    }
+    if (1 != delivery.m_pendingCount.fetch_sub(1))
+    {
+        return ;
+    }
 
-        Result res = m_parser.parseMessage(std::move(item));
-        if (Result::SUCCESS != res)
+    const rabbitmq::ProcessingItem& item = *delivery.m_item;
+    Processor& processor = *delivery.m_processor;
+    if (delivery.m_isDedupStarted)
+    {
+        std::vector<rabbitmq::ProcessingItemPtr> duplicates;
+        processor.m_dedup->finish(item.m_messageId, !delivery.m_isFailed, duplicates);
+        // duplicates may be received by another channel, so they are settled by their own acknowledgers.
+        // The failed original is rejected, so its duplicate is delivered again and processed
+        for (auto&& duplicate : duplicates)
         {
-            LOG_ERROR(m_logger, "Cannot process message. Result: %d(%s)",
-                static_cast<int32_t>(res), common::resultToStr(res));
-            item.m_channel->reject(item.m_deliveryTag);
-            continue;
+            if (delivery.m_isFailed)
+            {
+                duplicate->m_acknowledger->requeue(duplicate->m_deliveryTag);
+                continue;
+            }
+            duplicate->m_acknowledger->ack(duplicate->m_deliveryTag);
         }
-        item.m_channel->ack(item.m_deliveryTag);
     }
+    if (m_currentSettlements)
+    {
+        m_currentSettlements->add(item.m_acknowledger, item.m_deliveryTag, !delivery.m_isFailed);
+    }
+    else if (delivery.m_isFailed)
+    {
+        item.m_acknowledger->reject(item.m_deliveryTag);
+    }
+    else
+    {
+        item.m_acknowledger->ack(item.m_deliveryTag);
+    }
+    processor.m_latencySumUs.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - delivery.m_dequeueTime).count()), std::memory_order_relaxed);
+    processor.m_settledCount.fetch_add(1, std::memory_order_relaxed);
+    processor.m_deliveries.release(&delivery);
+}
+
+template<class Func>
+Result Logic::deferDelivery(Func&& func)
+{
+    if (!m_currentDelivery)
+    {
+        std::promise<Result> promise;
+        std::future<Result> future = promise.get_future();
+        func([&promise] (const Result res) -> void
+            {
+                promise.set_value(res);
+            });
+        return (Result::SUCCESS == future.get()) ? Result::SUCCESS : Result::FAILED;
+    }
+
+    // the delivery is not released until the operation is completed
+    Delivery* delivery = m_currentDelivery;
+    ++ delivery->m_pendingCount;
+    func([this, delivery] (const Result res) -> void
+        {
+            completeDelivery(*delivery, res);
+        });
+    return Result::SUCCESS;
+}
+
+Result Logic::coalesceDeal(const int64_t id, const std::time_t t, const int64_t amount)
+{
+    Delivery* delivery = m_currentDelivery;
+    ++ delivery->m_pendingCount;
+    Processor& processor = *delivery->m_processor;
+    processor.m_deals.add(id, t, amount, std::move(delivery));
+    return Result::SUCCESS;
+}
+
+void Logic::flushDeals(Processor& processor)
+{
+    processor.m_deals.flush([&processor] (const int64_t id, const std::time_t t, const int64_t amount,
+        std::vector<Delivery*>&& deliveries) -> void
+        {
+            // deliveries of the merged deal are settled together, the failure fails all of them
+            processor.m_dealBatch.add(id, t, amount, deliveries.data(), deliveries.data() + deliveries.size());
+        });
+    storeDealBatch(processor);
+}
+
+Result Logic::batchDeal(const int64_t id, const std::time_t t, const int64_t amount)
+{
+    Delivery* delivery = m_currentDelivery;
+    ++ delivery->m_pendingCount;
+    Processor& processor = *delivery->m_processor;
+    processor.m_dealBatch.add(id, t, amount, &delivery, &delivery + 1);
+    if (processor.m_dealBatch.m_deals.size() >= static_cast<size_t>(m_maxBatchedDeals))
+    {
+        storeDealBatch(processor);
+    }
+    return Result::SUCCESS;
+}
+
+void Logic::storeDealBatch(Processor& processor)
+{
+    if (processor.m_dealBatch.empty())
+    {
+        return ;
+    }
+
+    std::shared_ptr<DealBatch> batch = std::make_shared<DealBatch>();
+    std::swap(*batch, processor.m_dealBatch);
+    m_storage->storeUserDealsAsync(std::move(batch->m_deals), [this, batch] (const std::vector<Result>& results) -> void
+        {
+            // the batch is completed inline by the drain or by an I/O thread, the latter settles its own range
+            Settlements settlements;
+            Settlements* const drainSettlements = m_currentSettlements;
+            if (!drainSettlements)
+            {
+                m_currentSettlements = &settlements;
+            }
+            size_t delivery = 0;
+            for (size_t i = 0; i < batch->m_ends.size(); ++ i)
+            {
+                const Result res = (i < results.size()) ? results[i] : Result::FAILED;
+                for (; delivery < batch->m_ends[i]; ++ delivery)
+                {
+                    completeDelivery(*batch->m_deliveries[delivery], res);
+                }
+            }
+            m_currentSettlements = drainSettlements;
+            settlements.flush();
+        });
 }
 
 Result Logic::initialize()
@@ -191,7 +513,6 @@ Result Logic::initialize()
 
     LOG_INFO(m_logger, "Logic initialization started");
 
-    m_parser.registerCallbackObject(*this);
     m_state = State::INITIALIZED;
 
     LOG_INFO(m_logger, "Logic initialization finished");
@@ -211,6 +532,10 @@ Result Logic::configure(const libconfig::Config& cfg)
 
     m_loopIntervalSeconds = 60;
     m_processorsCount = 1;
+    m_processorQueueSize = 1024;
+    m_workersCount = 2;
+    m_workerSpinUs = 0;
+    m_latencyReportIntervalSeconds = 10;
     try
     {
         Setting& setting = cfg.lookup("application");
@@ -222,6 +547,24 @@ Result Logic::configure(const libconfig::Config& cfg)
         {
             LOG_WARN(m_logger, "Canont find 'processors-count' parameter in configuration. Default value will be used");
         }
+        if (!setting.lookupValue("processor-queue-size", m_processorQueueSize))
+        {
+            LOG_WARN(m_logger, "Canont find 'processor-queue-size' parameter in configuration. Default value will be used");
+        }
+        // processors and the logic loop had their own threads before
+        m_workersCount = m_processorsCount + 1;
+        if (!setting.lookupValue("workers-count", m_workersCount))
+        {
+            LOG_WARN(m_logger, "Canont find 'workers-count' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("worker-spin", m_workerSpinUs))
+        {
+            LOG_WARN(m_logger, "Canont find 'worker-spin' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("latency-report-interval", m_latencyReportIntervalSeconds))
+        {
+            LOG_WARN(m_logger, "Canont find 'latency-report-interval' parameter in configuration. Default value will be used");
+        }
     }
     catch (const SettingNotFoundException& e)
     {
@@ -232,8 +575,231 @@ Result Logic::configure(const libconfig::Config& cfg)
         LOG_ERROR(m_logger, "'processors-count'[%d] parameter is less than 1", m_processorsCount);
         return Result::CFG_INVALID;
     }
-    LOG_INFO(m_logger, "Configuration parameters: <loop-interval: %d seconds; processors-count: %d>",
-        m_loopIntervalSeconds, m_processorsCount);
+    if (m_processorQueueSize < 1)
+    {
+        LOG_ERROR(m_logger, "'processor-queue-size'[%d] parameter is less than 1", m_processorQueueSize);
+        return Result::CFG_INVALID;
+    }
+    if (m_workersCount < 1)
+    {
+        LOG_ERROR(m_logger, "'workers-count'[%d] parameter is less than 1", m_workersCount);
+        return Result::CFG_INVALID;
+    }
+    if (m_workerSpinUs < 0)
+    {
+        LOG_ERROR(m_logger, "'worker-spin'[%d] parameter is less than 0", m_workerSpinUs);
+        return Result::CFG_INVALID;
+    }
+    if (m_latencyReportIntervalSeconds < 0)
+    {
+        LOG_ERROR(m_logger, "'latency-report-interval'[%d] parameter is less than 0", m_latencyReportIntervalSeconds);
+        return Result::CFG_INVALID;
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <loop-interval: %d seconds; processors-count: %d; processor-queue-size: %d; workers-count: %d; "
+        "worker-spin: %d us; latency-report-interval: %d seconds>",
+        m_loopIntervalSeconds, m_processorsCount, m_processorQueueSize, m_workersCount,
+        m_workerSpinUs, m_latencyReportIntervalSeconds);
+
+    m_isAutoscaling = false;
+    m_minWorkersCount = 1;
+    m_maxWorkersCount = m_workersCount;
+    m_autoscalingIntervalMs = 1000;
+    m_autoscalingTargetLatencyMs = 100;
+    m_autoscalingQueueDepth = 64;
+    m_scaleDownTicks = 30;
+    try
+    {
+        Setting& setting = cfg.lookup("application.autoscaling");
+        if (!setting.lookupValue("enabled", m_isAutoscaling))
+        {
+            LOG_WARN(m_logger, "Canont find 'enabled' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("min-workers", m_minWorkersCount))
+        {
+            LOG_WARN(m_logger, "Canont find 'min-workers' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("max-workers", m_maxWorkersCount))
+        {
+            LOG_WARN(m_logger, "Canont find 'max-workers' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("interval", m_autoscalingIntervalMs))
+        {
+            LOG_WARN(m_logger, "Canont find 'interval' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("target-latency", m_autoscalingTargetLatencyMs))
+        {
+            LOG_WARN(m_logger, "Canont find 'target-latency' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("queue-depth", m_autoscalingQueueDepth))
+        {
+            LOG_WARN(m_logger, "Canont find 'queue-depth' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("scale-down-ticks", m_scaleDownTicks))
+        {
+            LOG_WARN(m_logger, "Canont find 'scale-down-ticks' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'application.autoscaling' section in configuration. Default values will be used");
+    }
+    if (m_minWorkersCount < 1 || m_minWorkersCount > m_maxWorkersCount)
+    {
+        LOG_ERROR(m_logger, "'autoscaling.min-workers'[%d] parameter must be in [1, %d]", m_minWorkersCount, m_maxWorkersCount);
+        return Result::CFG_INVALID;
+    }
+    if (m_autoscalingIntervalMs < 1 || m_autoscalingTargetLatencyMs < 1 || m_autoscalingQueueDepth < 1 || m_scaleDownTicks < 1)
+    {
+        LOG_ERROR(m_logger, "'autoscaling' parameters <interval: %d; target-latency: %d; queue-depth: %d; scale-down-ticks: %d> must be greater than 0",
+            m_autoscalingIntervalMs, m_autoscalingTargetLatencyMs, m_autoscalingQueueDepth, m_scaleDownTicks);
+        return Result::CFG_INVALID;
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <autoscaling: <enabled: %s; min-workers: %d; max-workers: %d; interval: %d ms; "
+        "target-latency: %d ms; queue-depth: %d; scale-down-ticks: %d>>",
+        (m_isAutoscaling ? "true" : "false"), m_minWorkersCount, m_maxWorkersCount, m_autoscalingIntervalMs,
+        m_autoscalingTargetLatencyMs, m_autoscalingQueueDepth, m_scaleDownTicks);
+
+    m_isDealCoalescing = false;
+    m_dealWindowMs = 10;
+    m_dealBucketSeconds = 1;
+    m_maxCoalescedDeals = 1024;
+    try
+    {
+        Setting& setting = cfg.lookup("application.deal-coalescing");
+        if (!setting.lookupValue("enabled", m_isDealCoalescing))
+        {
+            LOG_WARN(m_logger, "Canont find 'enabled' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("window", m_dealWindowMs))
+        {
+            LOG_WARN(m_logger, "Canont find 'window' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("bucket", m_dealBucketSeconds))
+        {
+            LOG_WARN(m_logger, "Canont find 'bucket' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("max-deals", m_maxCoalescedDeals))
+        {
+            LOG_WARN(m_logger, "Canont find 'max-deals' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'application.deal-coalescing' section in configuration. Default values will be used");
+    }
+    if (m_dealWindowMs < 0)
+    {
+        LOG_ERROR(m_logger, "'deal-coalescing.window'[%d] parameter is less than 0", m_dealWindowMs);
+        return Result::CFG_INVALID;
+    }
+    if (m_dealBucketSeconds < 1)
+    {
+        LOG_ERROR(m_logger, "'deal-coalescing.bucket'[%d] parameter is less than 1", m_dealBucketSeconds);
+        return Result::CFG_INVALID;
+    }
+    if (m_maxCoalescedDeals < 1)
+    {
+        LOG_ERROR(m_logger, "'deal-coalescing.max-deals'[%d] parameter is less than 1", m_maxCoalescedDeals);
+        return Result::CFG_INVALID;
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <deal-coalescing: <enabled: %s; window: %d ms; bucket: %d seconds; max-deals: %d>>",
+        (m_isDealCoalescing ? "true" : "false"), m_dealWindowMs, m_dealBucketSeconds, m_maxCoalescedDeals);
+
+    m_drainBatchSize = 64;
+    m_isDealBatching = false;
+    m_maxBatchedDeals = 1024;
+    try
+    {
+        Setting& setting = cfg.lookup("application.batching");
+        if (!setting.lookupValue("drain-size", m_drainBatchSize))
+        {
+            LOG_WARN(m_logger, "Canont find 'drain-size' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("store-deals", m_isDealBatching))
+        {
+            LOG_WARN(m_logger, "Canont find 'store-deals' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("max-deals", m_maxBatchedDeals))
+        {
+            LOG_WARN(m_logger, "Canont find 'max-deals' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'application.batching' section in configuration. Default values will be used");
+    }
+    if (m_drainBatchSize < 1)
+    {
+        LOG_ERROR(m_logger, "'batching.drain-size'[%d] parameter is less than 1", m_drainBatchSize);
+        return Result::CFG_INVALID;
+    }
+    if (m_maxBatchedDeals < 1)
+    {
+        LOG_ERROR(m_logger, "'batching.max-deals'[%d] parameter is less than 1", m_maxBatchedDeals);
+        return Result::CFG_INVALID;
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <batching: <drain-size: %d; store-deals: %s; max-deals: %d>>",
+        m_drainBatchSize, (m_isDealBatching ? "true" : "false"), m_maxBatchedDeals);
+
+    m_isDedup = false;
+    m_dedupCapacity = 100000;
+    m_dedupTtlSeconds = 600;
+    try
+    {
+        Setting& setting = cfg.lookup("application.dedup");
+        if (!setting.lookupValue("enabled", m_isDedup))
+        {
+            LOG_WARN(m_logger, "Canont find 'enabled' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("capacity", m_dedupCapacity))
+        {
+            LOG_WARN(m_logger, "Canont find 'capacity' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("ttl", m_dedupTtlSeconds))
+        {
+            LOG_WARN(m_logger, "Canont find 'ttl' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'application.dedup' section in configuration. Default values will be used");
+    }
+    if (m_dedupCapacity < 1)
+    {
+        LOG_ERROR(m_logger, "'dedup.capacity'[%d] parameter is less than 1", m_dedupCapacity);
+        return Result::CFG_INVALID;
+    }
+    if (m_dedupTtlSeconds < 1)
+    {
+        LOG_ERROR(m_logger, "'dedup.ttl'[%d] parameter is less than 1", m_dedupTtlSeconds);
+        return Result::CFG_INVALID;
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <dedup: <enabled: %s; capacity: %d; ttl: %d seconds>>",
+        (m_isDedup ? "true" : "false"), m_dedupCapacity, m_dedupTtlSeconds);
+
+    m_workersPlacement = ThreadPlacementCfg();
+    Result res = m_workersPlacement.read(cfg, "threads.workers", m_logger);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+
+    m_processors.clear();
+    for (int32_t i = 0; i < m_processorsCount; ++ i)
+    {
+        m_processors.emplace_back(new Processor(
+            static_cast<size_t>(m_processorQueueSize),
+            static_cast<std::time_t>(m_dealBucketSeconds),
+            std::chrono::milliseconds(m_dealWindowMs),
+            static_cast<size_t>(m_maxCoalescedDeals)));
+        if (m_isDedup)
+        {
+            // duplicates of a message carry the same user, so they are routed to the same processor
+            m_processors.back()->m_dedup.reset(new MessageDedup(
+                static_cast<size_t>((m_dedupCapacity + m_processorsCount - 1) / m_processorsCount),
+                std::chrono::seconds(m_dedupTtlSeconds)));
+        }
+    }
 
     std::string storageTypeStr = "mongo";
     try
@@ -260,6 +826,9 @@ Result Logic::configure(const libconfig::Config& cfg)
         case db::Storage::Type::MONGODB:
             m_storage.reset(new db::MongodbStorage());
             break;
+        case db::Storage::Type::TIERED:
+            m_storage.reset(new db::TieredStorage());
+            break;
         case db::Storage::Type::UNKNOWN:
         default:
             break;
@@ -269,7 +838,7 @@ Result Logic::configure(const libconfig::Config& cfg)
         LOG_ERROR(m_logger, "Cannot create storage");
         return Result::STORAGE_ERROR;
     }
-    Result res = m_storage->configure(cfg);
+    res = m_storage->configure(cfg);
     if (Result::SUCCESS != res)
     {
         return res;
@@ -283,8 +852,6 @@ Result Logic::configure(const libconfig::Config& cfg)
 
 Result Logic::start()
 {
-    using std::swap;
-
     if (State::CONFIGURED != m_state)
     {
         return Result::INVALID_STATE;
@@ -298,16 +865,49 @@ Result Logic::start()
         return res;
     }
 
-    m_loopIsRunning = true;
-    std::thread loopThread(&Logic::loop, this);
-    swap(loopThread, m_loopThread);
+    m_pool.setSpinDuration(std::chrono::microseconds(m_workerSpinUs));
+    m_pool.setThreadInit([this] (const size_t index) -> void
+        {
+            m_workersPlacement.apply("lb-worker-" + std::to_string(index), index, m_logger);
+        });
+    if (m_isAutoscaling)
+    {
+        // threads are created for the max count, the rest of them are parked
+        const int32_t workersCount = std::min(std::max(m_workersCount, m_minWorkersCount), m_maxWorkersCount);
+        m_pool.start(static_cast<size_t>(workersCount), static_cast<size_t>(m_maxWorkersCount));
+        m_autoscaler.reset(new Autoscaler(
+            static_cast<uint32_t>(m_minWorkersCount),
+            static_cast<uint32_t>(m_maxWorkersCount),
+            static_cast<size_t>(m_autoscalingQueueDepth),
+            static_cast<int64_t>(m_autoscalingTargetLatencyMs) * 1000,
+            static_cast<uint32_t>(m_scaleDownTicks)));
+    }
+    else
+    {
+        m_pool.start(static_cast<size_t>(m_workersCount));
+    }
 
-    m_isProcessingThreadsRunning = true;
-    m_processingThreads.resize(m_processorsCount);
-    for (auto&& processingThread : m_processingThreads)
+    // messages left in the queues by the previous stop are processed now
+    m_isProcessing = true;
+    for (auto&& processor : m_processors)
+    {
+        processor->m_isScheduled = false;
+        schedule(*processor);
+    }
+
+    m_loopIsRunning = true;
+    m_pool.post([this] () -> void
+        {
+            loop();
+        },
+        common::ThreadPool::Priority::LOW);
+    if (m_isAutoscaling)
+    {
+        autoscale();
+    }
+    if (m_latencyReportIntervalSeconds > 0)
     {
-        std::thread tmpThread(&Logic::processingThreadFunc, this);
-        std::swap(tmpThread, processingThread);
+        scheduleLatencyReport();
     }
 
     m_state = State::STARTED;
@@ -325,15 +925,22 @@ void Logic::stop()
 
     LOG_INFO(m_logger, "Logic stop started");
 
-    m_isProcessingThreadsRunning = false;
-    m_processingQueueCv.notify_all();
-    for (auto&& processingThread : m_processingThreads)
+    m_isProcessing = false;
+    m_loopIsRunning = false;
+    // leaderboards calculated by the storage are posted to the pool, so it is stopped after them
+    while (0 != m_loopFetchesCount)
     {
-        processingThread.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    m_pool.stop();
 
-    m_loopIsRunning = false;
-    m_loopThread.join();
+    // deliveries that wait for merged deals are settled by the storage before it is stopped
+    for (auto&& processor : m_processors)
+    {
+        flushDeals(*processor);
+    }
+
+    m_storage->stop();
     m_state = State::STOPPED;
 
     LOG_INFO(m_logger, "Logic stop finished");
@@ -353,69 +960,118 @@ void Logic::deinitialize()
 // user_registered(id,name)
 Result Logic::onUserRegistered(const int64_t id, const std::string& name)
 {
-    Result res = m_storage->storeUser(id, name);
-    if (Result::SUCCESS != res)
+    // deals that are received before the registration fail as without coalescing and batching.
+    // Users are partitioned, so only the current processor has deals of the user
+    if (m_currentDelivery)
     {
-        return Result::FAILED;
+        flushDeals(*m_currentDelivery->m_processor);
     }
-    return Result::SUCCESS;
+    return deferDelivery([this, id, &name] (const db::Storage::Callback& cb) -> void
+        {
+            m_storage->storeUserAsync(id, name, cb);
+        });
 }
 // user_renamed(id,name)
 Result Logic::onUserRenamed(const int64_t id, const std::string& name)
 {
-    Result res = m_storage->renameUser(id, name);
-    if (Result::SUCCESS != res)
-    {
-        return Result::FAILED;
-    }
-    return Result::SUCCESS;
+    return deferDelivery([this, id, &name] (const db::Storage::Callback& cb) -> void
+        {
+            m_storage->renameUserAsync(id, name, cb);
+        });
 }
 // user_deal(id,time,amount)
 Result Logic::onUserDeal(const int64_t id, const std::time_t t, const int64_t amount)
 {
-    Result res = m_storage->storeUserDeal(id, t, amount);
-    if (Result::SUCCESS != res)
+    if (m_isDealCoalescing && m_currentDelivery)
     {
-        return Result::FAILED;
+        return coalesceDeal(id, t, amount);
     }
-    return Result::SUCCESS;
+    if (m_isDealBatching && m_currentDelivery)
+    {
+        return batchDeal(id, t, amount);
+    }
+    return deferDelivery([this, id, t, amount] (const db::Storage::Callback& cb) -> void
+        {
+            m_storage->storeUserDealAsync(id, t, amount, cb);
+        });
 }
 // user_deal_won(id,time,amount)
 Result Logic::onUserDealWon(const int64_t id, const std::time_t t, const int64_t amount)
 {
-    Result res = m_storage->storeUserDeal(id, t, amount);
-    if (Result::SUCCESS != res)
+    if (m_isDealCoalescing && m_currentDelivery)
     {
-        return Result::FAILED;
+        return coalesceDeal(id, t, amount);
     }
-    return Result::SUCCESS;
+    if (m_isDealBatching && m_currentDelivery)
+    {
+        return batchDeal(id, t, amount);
+    }
+    return deferDelivery([this, id, t, amount] (const db::Storage::Callback& cb) -> void
+        {
+            m_storage->storeUserDealAsync(id, t, amount, cb);
+        });
 }
 // user_connected(id)
 Result Logic::onUserConnected(const int64_t id)
 {
-    Result res = m_storage->storeConnectedUser(id);
-    if (Result::SUCCESS != res)
-    {
-        return Result::FAILED;
-    }
-    return Result::SUCCESS;
+    return deferDelivery([this, id] (const db::Storage::Callback& cb) -> void
+        {
+            m_storage->storeConnectedUserAsync(id, cb);
+        });
 }
 // user_disconnected(id)
 Result Logic::onUserDisconnected(const int64_t id)
 {
-    Result res = m_storage->removeConnectedUser(id);
-    if (Result::SUCCESS != res)
-    {
-        return Result::FAILED;
-    }
-    return Result::SUCCESS;
+    return deferDelivery([this, id] (const db::Storage::Callback& cb) -> void
+        {
+            m_storage->removeConnectedUserAsync(id, cb);
+        });
 }
 
-Result Logic::processMessage(rabbitmq::ProcessingItem&& item)
+Result Logic::processMessage(rabbitmq::ProcessingItemPtr&& item)
 {
-    std::unique_lock<std::mutex> l(m_processingQueueGuard);
-    m_processingQueue.push(std::move(item));
-    m_processingQueueCv.notify_all();
+    // messages queued after stop would never be settled, the consumer requeues them
+    if (m_processors.empty() || !m_isProcessing)
+    {
+        return Result::INVALID_STATE;
+    }
+
+    // events of a user are processed by the same processor in order.
+    // Messages without id fail on parsing, so any processor is fine for them
+    int64_t id = 0;
+    const Result peekResult = m_parser.peekUserId(*item, id);
+    if (Result::CMD_NOT_SUPPORTED == peekResult)
+    {
+        // commands of other users would be processed out of their order
+        LOG_ERROR(m_logger, "Batch has commands of different users, message is rejected");
+        return peekResult;
+    }
+
+    // it does not wait: the item is pushed to the processor, the drain task is posted only if it is not posted yet.
+    // Queue is full only if the prefetch exceeds it, the consumer requeues the message then
+    Processor& processor = *m_processors[common::partitionOf(id, m_processors.size())];
+    bool isControl = false;
+    switch (m_parser.peekCommandType(*item))
+    {
+        case CommandType::USER_REGISTERED:
+        case CommandType::USER_RENAMED:
+        case CommandType::USER_CONNECTED:
+        case CommandType::USER_DISCONNECTED:
+            isControl = true;
+            break;
+        case CommandType::USER_DEAL:
+        case CommandType::USER_DEAL_WON:
+        case CommandType::UNKNOWN:
+            break;
+    }
+    common::BoundedQueue<rabbitmq::ProcessingItemPtr>& queue = isControl ? processor.m_controlQueue : processor.m_dealsQueue;
+    item->m_enqueueTime = std::chrono::steady_clock::now();
+    if (!queue.tryPush(std::move(item)))
+    {
+        LOG_WARN(m_logger, "Processor %s queue is full, message is requeued", (isControl ? "control" : "deals"));
+        return Result::QUEUE_OVERFLOW;
+    }
+    schedule(processor);
     return Result::SUCCESS;
 }
 
@@ -0,0 +1,45 @@
+#include <app/MessageDedup.h>
+
+namespace app
+{
+
+MessageDedup::MessageDedup(const size_t capacity, const common::DedupFilter::Clock::duration& ttl):
+    m_committed(capacity, ttl)
+{
+}
+
+MessageDedup::Verdict MessageDedup::start(rabbitmq::ProcessingItemPtr& item)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (m_committed.contains(item->m_messageId))
+    {
+        return Verdict::DUPLICATE;
+    }
+    auto it = m_inFlight.find(item->m_messageId);
+    if (m_inFlight.end() == it)
+    {
+        m_inFlight.emplace(item->m_messageId, std::vector<rabbitmq::ProcessingItemPtr>());
+        return Verdict::PROCESS;
+    }
+    // the duplicate is not requeued at once, the broker would deliver it again while the writes are pending
+    it->second.push_back(std::move(item));
+    return Verdict::IN_FLIGHT;
+}
+
+void MessageDedup::finish(const std::string& id, const bool isSucceeded, std::vector<rabbitmq::ProcessingItemPtr>& duplicates)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto it = m_inFlight.find(id);
+    if (m_inFlight.end() != it)
+    {
+        duplicates = std::move(it->second);
+        m_inFlight.erase(it);
+    }
+    // failed messages are not remembered, so their redeliveries are processed
+    if (isSucceeded)
+    {
+        m_committed.insert(id);
+    }
+}
+
+} // namespace app
\ No newline at end of file
@@ -1,276 +1,404 @@
-#include <memory>
-
 #include <common/Utils.h>
+#include <common/ByteScanner.h>
 #include <app/MessageParser.h>
+#include <app/BinaryProtocol.h>
+#include <app/JsonProtocol.h>
 
 namespace app
 {
-
-const MessageParser::MessageProcFuncsMap MessageParser::m_messageProcFuncsMap = 
-{
-    { "user_registered"     , &MessageParser::processUserRegistered     },
-    { "user_renamed"        , &MessageParser::processUserRenamed        },
-    { "user_deal"           , &MessageParser::processUserDeal           },
-    { "user_deal_won"       , &MessageParser::processUserDealWon        },
-    { "user_connected"      , &MessageParser::processUserConnected      },
-    { "user_disconnected"   , &MessageParser::processUserDisconnected   },
-};
-
-MessageParser::MessageParser()
+MessageParserBase::MessageParserBase()
 {
     m_logger = logger::Logger::getLogCategory("APP_MSG_PARSER");
 }
 
-MessageParser::~MessageParser()
-{
-}
-
-// user_registered(id,name)
-Result MessageParser::processUserRegistered(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item)
+bool MessageParserBase::parseTime(const char*& it, const char* const end, const char delimiter, std::time_t& t)
 {
-    return parser.onUserRegistered(command, std::move(item));
-}
-// user_registered(id,name)
-Result MessageParser::onUserRegistered(const std::string& command, rabbitmq::ProcessingItem&& item)
-{
-    if (!m_onUserRegisteredCallback)
+    const char* const begin = it;
+    while (it != end && *it != delimiter)
     {
-        return Result::CB_NOT_FOUND;
+        ++ it;
     }
-    int64_t id;
-    std::unique_ptr<char[]> buf(new char[item.m_args.size()]);
-    Result r = getArguments(command, item.m_args, "(%ld,%[^)]", std::ref(id), buf.get());
-    if (Result::SUCCESS != r)
-    {
-        return r;
-    }
-
-    LOG_DEBUG(m_logger, "'%s' command arguments: <id: %ld, name: %s>",
-        command.c_str(), id, buf.get());
+    return Result::SUCCESS == common::isoTimeFromString(t, begin, it - begin);
+}
 
-    r = m_onUserRegisteredCallback(id, buf.get());
-    if (Result::SUCCESS != r)
+// (id,name)
+Result MessageParserBase::parseIdName(const StringView& command, const StringView& args, Command& cmd)
+{
+    const char* it = args.begin();
+    const char* const end = args.end();
+    if (!common::parseInt64(it, end, cmd.m_id) || !parseChar(it, end, ',') || it == end)
     {
-        return r;
+        LOG_ERROR(m_logger, "Cannot process command '%.*s': invalid arguments format: '%.*s'",
+            command.length(), command.data(), args.length(), args.data());
+        return Result::INVALID_FORMAT;
     }
-
+    cmd.m_name = StringView(it, end - it);
+    LOG_DEBUG(m_logger, "'%.*s' command arguments: <id: %ld, name: %.*s>",
+        command.length(), command.data(), cmd.m_id, cmd.m_name.length(), cmd.m_name.data());
     return Result::SUCCESS;
 }
 
-// user_renamed(id,name)
-Result MessageParser::processUserRenamed(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item)
+// (id,time,amount)
+Result MessageParserBase::parseIdTimeAmount(const StringView& command, const StringView& args, Command& cmd)
 {
-    return parser.onUserRenamed(command, std::move(item));
+    const char* it = args.begin();
+    const char* const end = args.end();
+    if (!common::parseInt64(it, end, cmd.m_id) ||
+        !parseChar(it, end, ',') ||
+        !parseTime(it, end, ',', cmd.m_time) ||
+        !parseChar(it, end, ',') ||
+        !common::parseInt64(it, end, cmd.m_amount) ||
+        it != end)
+    {
+        LOG_ERROR(m_logger, "Cannot process command '%.*s': invalid arguments format: '%.*s'",
+            command.length(), command.data(), args.length(), args.data());
+        return Result::INVALID_FORMAT;
+    }
+    return Result::SUCCESS;
 }
 
-// user_renamed(id,name)
-Result MessageParser::onUserRenamed(const std::string& command, rabbitmq::ProcessingItem&& item)
+// (id)
+Result MessageParserBase::parseId(const StringView& command, const StringView& args, Command& cmd)
 {
-    if (!m_onUserRenamedCallback)
+    const char* it = args.begin();
+    const char* const end = args.end();
+    if (!common::parseInt64(it, end, cmd.m_id) || it != end)
     {
-        return Result::CB_NOT_FOUND;
+        LOG_ERROR(m_logger, "Cannot process command '%.*s': invalid arguments format: '%.*s'",
+            command.length(), command.data(), args.length(), args.data());
+        return Result::INVALID_FORMAT;
     }
+    LOG_DEBUG(m_logger, "'%.*s' command arguments: <id: %ld>", command.length(), command.data(), cmd.m_id);
+    return Result::SUCCESS;
+}
 
-    int64_t id;
-    std::unique_ptr<char[]> buf(new char[item.m_args.size()]);
-    Result r = getArguments(command, item.m_args, "(%ld,%[^)]", std::ref(id), buf.get());
-    if (Result::SUCCESS != r)
+// command(args)
+Result MessageParserBase::splitMessage(const StringView& message, StringView& command, StringView& args)
+{
+    if (message.empty() || message.back() != ')')
     {
-        return r;
+        LOG_ERROR(m_logger, "Cannot process command: invalid format");
+        return Result::INVALID_FORMAT;
     }
 
-    LOG_DEBUG(m_logger, "'%s' command arguments: <id: %ld, name: %s>",
-        command.c_str(), id, buf.get());
-
-    r = m_onUserRenamedCallback(id, buf.get());
-    if (Result::SUCCESS != r)
+    const char* const bracket = common::findByte(message.begin(), message.end(), '(');
+    if (message.end() == bracket)
     {
-        return r;
+        LOG_ERROR(m_logger, "Cannot process command: invalid format");
+        return Result::INVALID_FORMAT;
     }
 
+    const size_t pos = bracket - message.begin();
+    command = message.substr(0, pos);
+    args = message.substr(pos + 1, message.size() - pos - 2);
+    LOG_DEBUG(m_logger, "Start processing '%.*s' command. Arguments: (%.*s)",
+        command.length(), command.data(), args.length(), args.data());
     return Result::SUCCESS;
 }
 
-// user_deal(id,time,amount)
-Result MessageParser::processUserDeal(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item)
-{
-    return parser.onUserDeal(command, std::move(item));
-}
-
-// user_deal(id,time,amount)
-Result MessageParser::onUserDeal(const std::string& command, rabbitmq::ProcessingItem&& item)
+CommandType MessageParserBase::textCommandType(const StringView& command)
 {
-    if (!m_onUserDealCallback)
+    // commands are selected by their lengths
+    switch (command.size())
     {
-        return Result::CB_NOT_FOUND;
+        case sizeof("user_deal") - 1:
+            return isCommand(command, "user_deal") ? CommandType::USER_DEAL : CommandType::UNKNOWN;
+        case sizeof("user_renamed") - 1:
+            return isCommand(command, "user_renamed") ? CommandType::USER_RENAMED : CommandType::UNKNOWN;
+        case sizeof("user_deal_won") - 1:
+            return isCommand(command, "user_deal_won") ? CommandType::USER_DEAL_WON : CommandType::UNKNOWN;
+        case sizeof("user_connected") - 1:
+            return isCommand(command, "user_connected") ? CommandType::USER_CONNECTED : CommandType::UNKNOWN;
+        case sizeof("user_registered") - 1:
+            return isCommand(command, "user_registered") ? CommandType::USER_REGISTERED : CommandType::UNKNOWN;
+        case sizeof("user_disconnected") - 1:
+            return isCommand(command, "user_disconnected") ? CommandType::USER_DISCONNECTED : CommandType::UNKNOWN;
+        default:
+            break;
     }
+    return CommandType::UNKNOWN;
+}
 
-    int64_t id;
-    std::unique_ptr<char[]> timeBuf(new char[item.m_args.size()]);
-    int64_t amount;
-    Result r = getArguments(command, item.m_args, "(%ld,%[^','],%ld)", std::ref(id), timeBuf.get(), std::ref(amount));
+Result MessageParserBase::parseText(const StringView& message, Command& cmd)
+{
+    StringView command, args;
+    Result r = splitMessage(message, command, args);
     if (Result::SUCCESS != r)
     {
         return r;
     }
 
-    time_t t;
-    r = common::timeFromString(t, timeBuf.get());
-    if (Result::SUCCESS != r)
+    cmd.m_type = textCommandType(command);
+    switch (cmd.m_type)
     {
-        return r;
+        case CommandType::USER_REGISTERED:
+        case CommandType::USER_RENAMED:
+            return parseIdName(command, args, cmd);
+        case CommandType::USER_DEAL:
+        case CommandType::USER_DEAL_WON:
+            return parseIdTimeAmount(command, args, cmd);
+        case CommandType::USER_CONNECTED:
+        case CommandType::USER_DISCONNECTED:
+            return parseId(command, args, cmd);
+        case CommandType::UNKNOWN:
+            break;
     }
 
-    r = m_onUserDealCallback(id, t, amount);
+    LOG_ERROR(m_logger, "Cannot process command '%.*s': parser is not found",
+        command.length(), command.data());
+    return Result::CMD_NOT_SUPPORTED;
+}
+
+Result MessageParserBase::parseBinary(const StringView& message, Command& cmd)
+{
+    Result r = binary::decode(message, cmd);
     if (Result::SUCCESS != r)
     {
+        LOG_ERROR(m_logger, "Cannot decode binary command <type: %u, size: %zu>. Result: %u(%s)",
+            static_cast<uint32_t>(cmd.m_type), message.size(), static_cast<uint16_t>(r), resultToStr(r));
         return r;
     }
-
+    LOG_DEBUG(m_logger, "Binary command '%s' <id: %ld>", commandTypeToStr(cmd.m_type), cmd.m_id);
     return Result::SUCCESS;
 }
 
-// user_deal_won(id,time,amount)
-Result MessageParser::processUserDealWon(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item)
-{
-    return parser.onUserDealWon(command, std::move(item));
-}
-
-// user_deal_won(id,time,amount)
-Result MessageParser::onUserDealWon(const std::string& command, rabbitmq::ProcessingItem&& item)
+Result MessageParserBase::parseJson(char* const message, const size_t size, Command& cmd)
 {
-    if (!m_onUserDealWonCallback)
-    {
-        return Result::CB_NOT_FOUND;
-    }
-
-    int64_t id;
-    std::unique_ptr<char[]> timeBuf(new char[item.m_args.size()]);
-    int64_t amount;
-    Result r = getArguments(command, item.m_args, "(%ld,%[^','],%ld)", std::ref(id), timeBuf.get(), std::ref(amount));
+    Result r = json::decode(message, size, cmd);
     if (Result::SUCCESS != r)
     {
+        LOG_ERROR(m_logger, "Cannot decode JSON command <type: %s, size: %zu>. Result: %u(%s)",
+            commandTypeToStr(cmd.m_type), size, static_cast<uint16_t>(r), resultToStr(r));
         return r;
     }
+    LOG_DEBUG(m_logger, "JSON command '%s' <id: %ld>", commandTypeToStr(cmd.m_type), cmd.m_id);
+    return Result::SUCCESS;
+}
 
-    time_t t;
-    r = common::timeFromString(t, timeBuf.get());
-    if (Result::SUCCESS != r)
+void MessageParserBase::addCommandResult(BatchStats& stats, const Command& cmd, const Result r)
+{
+    ++ stats.m_commandsCount;
+    if (Result::SUCCESS == r)
     {
-        return r;
+        return ;
     }
 
-    r = m_onUserDealWonCallback(id, t, amount);
-    if (Result::SUCCESS != r)
+    ++ stats.m_failedCounts[static_cast<size_t>(cmd.m_type)];
+    if (Result::SUCCESS == stats.m_result)
     {
-        return r;
+        stats.m_result = r;
     }
-
-    return Result::SUCCESS;
 }
 
-
-// user_connected(id)
-Result MessageParser::processUserConnected(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item)
+void MessageParserBase::logBatchStats(const BatchStats& stats)
 {
-    return parser.onUserConnected(command, std::move(item));
+    uint32_t failedCount = 0;
+    std::string details;
+    for (size_t i = 0; i < commandTypesCount; ++ i)
+    {
+        if (0 == stats.m_failedCounts[i])
+        {
+            continue;
+        }
+        failedCount += stats.m_failedCounts[i];
+        if (!details.empty())
+        {
+            details += ", ";
+        }
+        details += commandTypeToStr(static_cast<CommandType>(i));
+        details += ": ";
+        details += std::to_string(stats.m_failedCounts[i]);
+    }
+
+    LOG_ERROR(m_logger, "Cannot process %u of %u commands of the message (%s)",
+        failedCount, stats.m_commandsCount, details.c_str());
 }
 
-// user_connected(id)
-Result MessageParser::onUserConnected(const std::string& command, rabbitmq::ProcessingItem&& item)
+Result MessageParserBase::peekUserId(const rabbitmq::ProcessingItem& item, int64_t& id)
 {
-    if (!m_onUserConnectedCallback)
+    const char* it = item.m_message.data();
+    const char* const end = it + item.m_message.size();
+    switch (item.m_contentType)
     {
-        return Result::CB_NOT_FOUND;
+        case rabbitmq::ProcessingItem::ContentType::BINARY:
+            if (item.m_message.size() < binary::headerSize)
+            {
+                return Result::INVALID_FORMAT;
+            }
+            id = binary::load<int64_t>(it + sizeof(uint8_t));
+            return Result::SUCCESS;
+        case rabbitmq::ProcessingItem::ContentType::JSON:
+        {
+            Command cmd;
+            if (!json::peek(it, item.m_message.size(), cmd))
+            {
+                return Result::INVALID_FORMAT;
+            }
+            id = cmd.m_id;
+            return Result::SUCCESS;
+        }
+        case rabbitmq::ProcessingItem::ContentType::TEXT:
+            break;
     }
 
-    int64_t id;
-    Result r = getArguments(command, item.m_args, "(%ld)", std::ref(id));
-    if (Result::SUCCESS != r)
+    // command(id,... on every line, lines without id fail on parsing
+    bool hasId = false;
+    while (it != end)
     {
-        return r;
-    }
-
-    LOG_DEBUG(m_logger, "'%s' command arguments: <id: %ld>", command.c_str(), id);
-
-    r = m_onUserConnectedCallback(id);
-    if (Result::SUCCESS != r)
-    {
-        return r;
+        const char* const lineEnd = common::findByte(it, end, '\n');
+        const char* argsIt = common::findByte(it, lineEnd, '(');
+        it = lineEnd + (lineEnd != end);
+
+        int64_t lineId = 0;
+        if (argsIt == lineEnd || !common::parseInt64(++ argsIt, lineEnd, lineId))
+        {
+            continue;
+        }
+        if (hasId && lineId != id)
+        {
+            return Result::CMD_NOT_SUPPORTED;
+        }
+        id = lineId;
+        hasId = true;
     }
+    return hasId ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
 
-    return Result::SUCCESS;
+MessageParser::MessageParser():
+    BasicMessageParser<MessageParser>(*this)
+{
 }
 
-// user_disconnected(id)
-Result MessageParser::processUserDisconnected(MessageParser& parser, const std::string& command, rabbitmq::ProcessingItem&& item)
+MessageParser::~MessageParser()
 {
-    return parser.onUserDisconnected(command, std::move(item));
 }
 
-// user_disconnected(id)
-Result MessageParser::onUserDisconnected(const std::string& command, rabbitmq::ProcessingItem&& item)
+// user_registered(id,name)
+Result MessageParser::onUserRegistered(const int64_t id, const std::string& name)
 {
-    if (!m_onUserDisconnectedCallback)
+    if (!m_onUserRegisteredCallback)
     {
         return Result::CB_NOT_FOUND;
     }
+    return m_onUserRegisteredCallback(id, name);
+}
 
-    int64_t id;
-    Result r = getArguments(command, item.m_args, "(%ld)", std::ref(id));
-    if (Result::SUCCESS != r)
+// user_renamed(id,name)
+Result MessageParser::onUserRenamed(const int64_t id, const std::string& name)
+{
+    if (!m_onUserRenamedCallback)
     {
-        return r;
+        return Result::CB_NOT_FOUND;
     }
+    return m_onUserRenamedCallback(id, name);
+}
 
-    LOG_DEBUG(m_logger, "'%s' command arguments: <id: %ld>", command.c_str(), id);
-
-    r = m_onUserDisconnectedCallback(id);
-    if (Result::SUCCESS != r)
+// user_deal(id,time,amount)
+Result MessageParser::onUserDeal(const int64_t id, const std::time_t t, const int64_t amount)
+{
+    if (!m_onUserDealCallback)
     {
-        return r;
+        return Result::CB_NOT_FOUND;
     }
-
-    return Result::SUCCESS;
+    return m_onUserDealCallback(id, t, amount);
 }
 
-Result MessageParser::parseMessage(rabbitmq::ProcessingItem&& item)
+// user_deal_won(id,time,amount)
+Result MessageParser::onUserDealWon(const int64_t id, const std::time_t t, const int64_t amount)
 {
-    if (*item.m_message.rbegin() != ')')
+    if (!m_onUserDealWonCallback)
     {
-        LOG_ERROR(m_logger, "Cannot process command: invalid format");
-        return Result::INVALID_FORMAT;
+        return Result::CB_NOT_FOUND;
     }
+    return m_onUserDealWonCallback(id, t, amount);
+}
 
-    size_t pos = item.m_message.find('(');
-    if (std::string::npos == pos)
+// user_connected(id)
+Result MessageParser::onUserConnected(const int64_t id)
+{
+    if (!m_onUserConnectedCallback)
     {
-        LOG_ERROR(m_logger, "Cannot process command: invalid format");
-        return Result::INVALID_FORMAT;
+        return Result::CB_NOT_FOUND;
     }
+    return m_onUserConnectedCallback(id);
+}
 
-    std::string command(item.m_message, 0, pos);
-    auto commandIt = m_messageProcFuncsMap.find(command);
-    if (m_messageProcFuncsMap.end() == commandIt)
+// user_disconnected(id)
+Result MessageParser::onUserDisconnected(const int64_t id)
+{
+    if (!m_onUserDisconnectedCallback)
     {
-        LOG_ERROR(m_logger, "Cannot process command '%s': parser is not found",
-            command.c_str());
-        return Result::CMD_NOT_SUPPORTED;
+        return Result::CB_NOT_FOUND;
     }
+    return m_onUserDisconnectedCallback(id);
+}
 
-    item.m_args = std::string(item.m_message, pos);
-    LOG_DEBUG(m_logger, "Start processing '%s' command. Arguments: %s",
-        command.c_str(), item.m_args.c_str());
-
-    Result r = commandIt->second(*this, command, std::move(item));
-    if (Result::SUCCESS != r)
+CommandType MessageParserBase::peekCommandType(const rabbitmq::ProcessingItem& item)
+{
+    const char* it = item.m_message.data();
+    const char* const end = it + item.m_message.size();
+    switch (item.m_contentType)
     {
-        LOG_ERROR(m_logger, "Cannot process command '%s'. Result: %u(%s)",
-            command.c_str(), static_cast<uint16_t>(r), resultToStr(r));
-        return r;
+        case rabbitmq::ProcessingItem::ContentType::BINARY:
+        {
+            if (item.m_message.empty())
+            {
+                return CommandType::UNKNOWN;
+            }
+            const uint8_t type = static_cast<uint8_t>(*it);
+            if (type >= commandTypesCount)
+            {
+                return CommandType::UNKNOWN;
+            }
+            return static_cast<CommandType>(type);
+        }
+        case rabbitmq::ProcessingItem::ContentType::JSON:
+        {
+            Command cmd;
+            json::peek(it, item.m_message.size(), cmd);
+            return cmd.m_type;
+        }
+        case rabbitmq::ProcessingItem::ContentType::TEXT:
+            break;
     }
 
-    return Result::SUCCESS;
+    // command(... on every line, the batch takes the control lane if any of its commands is a control one
+    CommandType firstType = CommandType::UNKNOWN;
+    bool isFirst = true;
+    while (it != end)
+    {
+        const char* const lineBegin = it;
+        const char* const lineEnd = common::findByte(it, end, '\n');
+        it = lineEnd + (lineEnd != end);
+        if (lineBegin == lineEnd || (1 == lineEnd - lineBegin && '\r' == *lineBegin))
+        {
+            continue;
+        }
+
+        const char* const commandEnd = common::findByte(lineBegin, lineEnd, '(');
+        const CommandType type = (commandEnd == lineEnd)
+            ? CommandType::UNKNOWN
+            : textCommandType(StringView(lineBegin, commandEnd - lineBegin));
+
+        switch (type)
+        {
+            case CommandType::USER_REGISTERED:
+            case CommandType::USER_RENAMED:
+            case CommandType::USER_CONNECTED:
+            case CommandType::USER_DISCONNECTED:
+                return type;
+            case CommandType::USER_DEAL:
+            case CommandType::USER_DEAL_WON:
+            case CommandType::UNKNOWN:
+                break;
+        }
+        if (isFirst)
+        {
+            firstType = type;
+            isFirst = false;
+        }
+    }
+    return firstType;
 }
 
 } // namespace app
\ No newline at end of file
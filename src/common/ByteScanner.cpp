@@ -0,0 +1,80 @@
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COMMON_BYTE_SCANNER_X86
+#endif
+
+#include <common/ByteScanner.h>
+
+namespace common
+{
+
+namespace
+{
+typedef const char* (*FindByteFunc)(const char*, const char* const, const char);
+
+const char* findByteScalar(const char* begin, const char* const end, const char c)
+{
+    while (begin != end && *begin != c)
+    {
+        ++ begin;
+    }
+    return begin;
+}
+
+#ifdef COMMON_BYTE_SCANNER_X86
+const char* findByteSse2(const char* begin, const char* const end, const char c)
+{
+    const __m128i pattern = _mm_set1_epi8(c);
+    for (; end - begin >= 16; begin += 16)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, pattern));
+        if (mask)
+        {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return findByteScalar(begin, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* findByteAvx2(const char* begin, const char* const end, const char c)
+{
+    const __m256i pattern = _mm256_set1_epi8(c);
+    for (; end - begin >= 32; begin += 32)
+    {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, pattern)));
+        if (mask)
+        {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return findByteSse2(begin, end, c);
+}
+#endif
+
+FindByteFunc selectFindByte()
+{
+#ifdef COMMON_BYTE_SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return &findByteAvx2;
+    }
+    return &findByteSse2;
+#else
+    return &findByteScalar;
+#endif
+}
+} // namespace
+
+const char* findByte(const char* begin, const char* const end, const char c)
+{
+    static const FindByteFunc findByteFunc = selectFindByte();
+    return findByteFunc(begin, end, c);
+}
+
+} // namespace common
\ No newline at end of file
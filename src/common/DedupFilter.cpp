@@ -0,0 +1,89 @@
+#include <functional>
+
+#include <common/DedupFilter.h>
+
+namespace common
+{
+
+DedupFilter::DedupFilter(const size_t capacity, const Clock::duration& ttl):
+    m_ttl(ttl.count())
+{
+    size_t bucketsCount = 1;
+    while (bucketsCount * slotsPerBucket < capacity)
+    {
+        bucketsCount <<= 1;
+    }
+    m_slots.resize(bucketsCount * slotsPerBucket);
+    m_bucketMask = bucketsCount - 1;
+}
+
+uint64_t DedupFilter::fingerprintOf(const std::string& id)
+{
+    // mixes the bits of the hash, so the bucket index and the fingerprint are independent
+    uint64_t h = static_cast<uint64_t>(std::hash<std::string>()(id));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (0 == h) ? 1 : h;
+}
+
+size_t DedupFilter::bucketOf(const uint64_t fingerprint) const
+{
+    // the high bits select the bucket, the whole fingerprint is compared
+    return ((fingerprint >> 32) & m_bucketMask) * slotsPerBucket;
+}
+
+bool DedupFilter::insert(const std::string& id, const Clock::time_point& now)
+{
+    const uint64_t fingerprint = fingerprintOf(id);
+    const Clock::rep time = now.time_since_epoch().count();
+    Slot* const bucket = &m_slots[bucketOf(fingerprint)];
+
+    // expired slots are reused, otherwise the oldest id of the bucket is evicted
+    Slot* victim = nullptr;
+    bool isVictimExpired = false;
+    for (Slot* slot = bucket; slot != bucket + slotsPerBucket; ++ slot)
+    {
+        const bool isExpired = (0 == slot->m_fingerprint) || (time - slot->m_time >= m_ttl);
+        if (!isExpired && fingerprint == slot->m_fingerprint)
+        {
+            return false;
+        }
+        if (isVictimExpired)
+        {
+            continue;
+        }
+        if (isExpired || !victim || slot->m_time < victim->m_time)
+        {
+            victim = slot;
+            isVictimExpired = isExpired;
+        }
+    }
+    victim->m_fingerprint = fingerprint;
+    victim->m_time = time;
+    return true;
+}
+
+bool DedupFilter::contains(const std::string& id, const Clock::time_point& now) const
+{
+    const uint64_t fingerprint = fingerprintOf(id);
+    const Clock::rep time = now.time_since_epoch().count();
+    const Slot* const bucket = &m_slots[bucketOf(fingerprint)];
+    for (const Slot* slot = bucket; slot != bucket + slotsPerBucket; ++ slot)
+    {
+        if (fingerprint == slot->m_fingerprint && time - slot->m_time < m_ttl)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t DedupFilter::capacity() const
+{
+    return m_slots.size();
+}
+
+} // namespace common
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <common/ThreadPool.h>
+
+namespace common
+{
+
+thread_local const ThreadPool* ThreadPool::m_currentPool = nullptr;
+thread_local size_t ThreadPool::m_currentWorker = 0;
+
+ThreadPool::ThreadPool():
+    m_nextTimerTime(Clock::time_point::max().time_since_epoch().count())
+{}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::setThreadInit(ThreadInit&& threadInit)
+{
+    m_threadInit = std::move(threadInit);
+}
+
+void ThreadPool::setSpinDuration(const Clock::duration& duration)
+{
+    m_spinDuration = duration;
+}
+
+void ThreadPool::start(const size_t workersCount, const size_t maxWorkersCount)
+{
+    if (m_isRunning)
+    {
+        return ;
+    }
+
+    // deques are created before threads, so workers can steal from each other at once.
+    // The pool is running after that, so post does not see the workers while they are replaced
+    const size_t threadsCount = std::max(workersCount, maxWorkersCount);
+    m_workers.clear();
+    for (size_t i = 0; i < threadsCount; ++ i)
+    {
+        m_workers.emplace_back(new Worker());
+    }
+    m_activeCount = std::min(std::max<size_t>(workersCount, 1), threadsCount);
+    m_queuedCount = 0;
+    m_isRunning = true;
+    for (size_t i = 0; i < threadsCount; ++ i)
+    {
+        std::thread tmpThread(&ThreadPool::workerFunc, this, i);
+        std::swap(tmpThread, m_workers[i]->m_thread);
+    }
+}
+
+void ThreadPool::stop()
+{
+    if (!m_isRunning.exchange(false))
+    {
+        return ;
+    }
+    {
+        std::unique_lock<std::mutex> l(m_sleepGuard);
+        m_sleepCv.notify_all();
+        m_parkCv.notify_all();
+    }
+    // workers are kept until the next start or destruction: post may have seen the pool running
+    // and pushes its task to the deque of a stopped worker, the task is dropped
+    for (auto&& worker : m_workers)
+    {
+        worker->m_thread.join();
+    }
+    for (auto&& worker : m_workers)
+    {
+        std::unique_lock<std::mutex> l(worker->m_guard);
+        for (auto&& tasks : worker->m_tasks)
+        {
+            tasks.clear();
+        }
+    }
+
+    std::unique_lock<std::mutex> l(m_timersGuard);
+    m_timers = decltype(m_timers)();
+    m_nextTimerTime = Clock::time_point::max().time_since_epoch().count();
+}
+
+size_t ThreadPool::workersCount() const
+{
+    return m_workers.size();
+}
+
+size_t ThreadPool::activeWorkersCount() const
+{
+    return m_activeCount;
+}
+
+void ThreadPool::setActiveWorkersCount(const size_t count)
+{
+    if (m_workers.empty())
+    {
+        return ;
+    }
+    // deactivated workers park when their current tasks are completed, sleeping ones are woken up,
+    // so notifications of new tasks are received by active workers only
+    std::unique_lock<std::mutex> l(m_sleepGuard);
+    m_activeCount = std::min(std::max<size_t>(count, 1), m_workers.size());
+    m_parkCv.notify_all();
+    m_sleepCv.notify_all();
+}
+
+void ThreadPool::post(Task&& task, const Priority priority)
+{
+    if (!m_isRunning || m_workers.empty())
+    {
+        return ;
+    }
+
+    // the worker keeps its tasks, so they are run while its cache is hot
+    const size_t index = (this == m_currentPool)
+        ? m_currentWorker
+        : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_activeCount.load(std::memory_order_relaxed);
+    Worker& worker = *m_workers[index];
+    {
+        std::unique_lock<std::mutex> l(worker.m_guard);
+        worker.m_tasks[static_cast<size_t>(priority)].emplace_back(std::move(task));
+    }
+    ++ m_queuedCount;
+    wakeOne();
+}
+
+void ThreadPool::postAfter(const Clock::duration& delay, Task&& task, const Priority priority)
+{
+    if (!m_isRunning)
+    {
+        return ;
+    }
+
+    const Clock::time_point time = Clock::now() + delay;
+    {
+        std::unique_lock<std::mutex> l(m_timersGuard);
+        m_timers.push(Timer{time, m_timersSequence ++, priority, std::move(task)});
+        m_nextTimerTime = m_timers.top().m_time.time_since_epoch().count();
+    }
+    // sleeping workers recalculate their deadlines
+    std::unique_lock<std::mutex> l(m_sleepGuard);
+    m_sleepCv.notify_all();
+}
+
+void ThreadPool::wakeOne()
+{
+    // pairs with the increment of the sleepers: either the task is seen by the worker or the worker is seen here
+    if (0 == m_sleepersCount.load())
+    {
+        return ;
+    }
+    std::unique_lock<std::mutex> l(m_sleepGuard);
+    m_sleepCv.notify_one();
+}
+
+bool ThreadPool::popTask(const size_t index, const bool isWorker, Task& task)
+{
+    const size_t count = m_workers.size();
+    for (size_t priority = 0; priority < prioritiesCount; ++ priority)
+    {
+        // own deque is processed in order, the others are stolen from the back
+        for (size_t i = 0; i < count; ++ i)
+        {
+            Worker& worker = *m_workers[(index + i) % count];
+            std::unique_lock<std::mutex> l(worker.m_guard);
+            std::deque<Task>& tasks = worker.m_tasks[priority];
+            if (tasks.empty())
+            {
+                continue;
+            }
+            if (isWorker && 0 == i)
+            {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            else
+            {
+                task = std::move(tasks.back());
+                tasks.pop_back();
+            }
+            -- m_queuedCount;
+            return true;
+        }
+    }
+    return false;
+}
+
+ThreadPool::Clock::time_point ThreadPool::postTimers()
+{
+    const Clock::time_point now = Clock::now();
+    if (now.time_since_epoch().count() < m_nextTimerTime.load(std::memory_order_relaxed))
+    {
+        return Clock::time_point(Clock::duration(m_nextTimerTime.load(std::memory_order_relaxed)));
+    }
+
+    std::vector<Timer> dueTimers;
+    Clock::time_point nextTime = Clock::time_point::max();
+    {
+        std::unique_lock<std::mutex> l(m_timersGuard);
+        while (!m_timers.empty() && m_timers.top().m_time <= now)
+        {
+            dueTimers.push_back(m_timers.top());
+            m_timers.pop();
+        }
+        if (!m_timers.empty())
+        {
+            nextTime = m_timers.top().m_time;
+        }
+        m_nextTimerTime = nextTime.time_since_epoch().count();
+    }
+    for (auto&& timer : dueTimers)
+    {
+        post(std::move(timer.m_task), timer.m_priority);
+    }
+    return nextTime;
+}
+
+void ThreadPool::workerFunc(const size_t index)
+{
+    m_currentPool = this;
+    m_currentWorker = index;
+    if (m_threadInit)
+    {
+        m_threadInit(index);
+    }
+
+    Task task;
+    while (m_isRunning)
+    {
+        if (index >= m_activeCount.load(std::memory_order_relaxed))
+        {
+            std::unique_lock<std::mutex> l(m_sleepGuard);
+            m_parkCv.wait(l, [this, index] () -> bool
+                {
+                    return !m_isRunning || index < m_activeCount;
+                });
+            continue;
+        }
+
+        const Clock::time_point nextTimerTime = postTimers();
+        if (popTask(index, true, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        if (m_spinDuration > Clock::duration::zero() && spin(index))
+        {
+            continue;
+        }
+
+        // new timers change the deadline, so they wake workers up as well
+        const Clock::rep nextTimerRep = nextTimerTime.time_since_epoch().count();
+        std::unique_lock<std::mutex> l(m_sleepGuard);
+        ++ m_sleepersCount;
+        if (m_isRunning && index < m_activeCount && 0 == m_queuedCount.load() && nextTimerRep == m_nextTimerTime.load())
+        {
+            if (Clock::time_point::max() == nextTimerTime)
+            {
+                m_sleepCv.wait(l);
+            }
+            else
+            {
+                m_sleepCv.wait_until(l, nextTimerTime);
+            }
+        }
+        -- m_sleepersCount;
+    }
+
+    m_currentPool = nullptr;
+}
+
+bool ThreadPool::spin(const size_t index) const
+{
+    // the worker is not counted as a sleeper, so producers do not notify it
+    const Clock::time_point deadline = Clock::now() + m_spinDuration;
+    for (Clock::time_point now = Clock::now(); now < deadline; now = Clock::now())
+    {
+        if (!m_isRunning.load(std::memory_order_relaxed) || index >= m_activeCount.load(std::memory_order_relaxed) ||
+            0 != m_queuedCount.load(std::memory_order_relaxed) ||
+            m_nextTimerTime.load(std::memory_order_relaxed) <= now.time_since_epoch().count())
+        {
+            return true;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+    return false;
+}
+
+bool ThreadPool::runOne()
+{
+    if (m_workers.empty())
+    {
+        return false;
+    }
+
+    const bool isWorker = (this == m_currentPool);
+    Task task;
+    if (!popTask(isWorker ? m_currentWorker : 0, isWorker, task))
+    {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::parallelFor(const size_t count, const std::function<void(const size_t)>& func, const Priority priority)
+{
+    if (0 == count)
+    {
+        return ;
+    }
+
+    // the state is shared, so tasks that are dropped by stop do not access the stack of the caller
+    struct State
+    {
+        std::function<void(const size_t)> m_func;
+        std::atomic<size_t> m_next{0};
+        std::atomic<size_t> m_completedCount{0};
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->m_func = func;
+    auto runNext = [state, count] () -> void
+        {
+            const size_t i = state->m_next.fetch_add(1);
+            if (i < count)
+            {
+                state->m_func(i);
+                ++ state->m_completedCount;
+            }
+        };
+
+    for (size_t i = 1; i < count; ++ i)
+    {
+        post(Task(runNext), priority);
+    }
+    // calls are claimed by index, so the caller completes all of them if the pool does not run the tasks
+    for (size_t i = state->m_next.load(); i < count; i = state->m_next.load())
+    {
+        runNext();
+    }
+    while (state->m_completedCount.load() < count)
+    {
+        if (!runOne())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+} // namespace common
\ No newline at end of file
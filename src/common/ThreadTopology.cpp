@@ -0,0 +1,158 @@
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+
+#include <common/ThreadTopology.h>
+
+namespace common
+{
+
+namespace
+{
+// linux/mempolicy.h, the syscall is used directly, so libnuma is not required
+static constexpr int mpolLocal = 4;
+// longest thread name without the terminating zero
+static constexpr size_t maxThreadNameSize = 15;
+
+bool parseCpu(const char*& it, const char* const end, int32_t& cpu)
+{
+    const char* const begin = it;
+    int64_t value = 0;
+    while (it != end && *it >= '0' && *it <= '9' && value < CPU_SETSIZE)
+    {
+        value = value * 10 + (*it - '0');
+        ++ it;
+    }
+    cpu = static_cast<int32_t>(value);
+    return it != begin && value < CPU_SETSIZE;
+}
+} // namespace
+
+bool parseCpuList(const std::string& str, CpuList& cpus)
+{
+    cpus.clear();
+    const char* it = str.data();
+    const char* const end = it + str.size();
+    while (it != end)
+    {
+        int32_t first = 0;
+        if (!parseCpu(it, end, first))
+        {
+            return false;
+        }
+        int32_t last = first;
+        if (it != end && '-' == *it && (!parseCpu(++ it, end, last) || last < first))
+        {
+            return false;
+        }
+        for (int32_t cpu = first; cpu <= last; ++ cpu)
+        {
+            cpus.push_back(cpu);
+        }
+        if (it != end && ',' != *it)
+        {
+            return false;
+        }
+        if (it != end && ++ it == end)
+        {
+            // trailing comma
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string cpuListToString(const CpuList& cpus)
+{
+    if (cpus.empty())
+    {
+        return "any";
+    }
+
+    // consecutive CPUs are written as ranges
+    std::string str;
+    for (size_t i = 0; i < cpus.size(); )
+    {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        {
+            ++ j;
+        }
+        if (!str.empty())
+        {
+            str += ',';
+        }
+        str += std::to_string(cpus[i]);
+        if (j != i)
+        {
+            str += '-';
+            str += std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return str;
+}
+
+bool applyThreadPlacement(const std::string& name, const ThreadPlacement& placement, const size_t index)
+{
+    bool isApplied = (0 == pthread_setname_np(pthread_self(), name.substr(0, maxThreadNameSize).c_str()));
+
+    if (!placement.m_cpus.empty())
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        if (placement.m_isSpread)
+        {
+            CPU_SET(placement.m_cpus[index % placement.m_cpus.size()], &cpuSet);
+        }
+        else
+        {
+            for (const int32_t cpu : placement.m_cpus)
+            {
+                CPU_SET(cpu, &cpuSet);
+            }
+        }
+        isApplied = (0 == pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet)) && isApplied;
+    }
+
+    if (placement.m_isNumaLocal)
+    {
+        isApplied = (0 == syscall(SYS_set_mempolicy, mpolLocal, nullptr, 0)) && isApplied;
+    }
+    return isApplied;
+}
+
+CpuList currentThreadCpus()
+{
+    CpuList cpus;
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (0 != pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet))
+    {
+        return cpus;
+    }
+    for (int32_t cpu = 0; cpu < CPU_SETSIZE; ++ cpu)
+    {
+        if (CPU_ISSET(cpu, &cpuSet))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+int32_t currentNumaNode()
+{
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (0 != syscall(SYS_getcpu, &cpu, &node, nullptr))
+    {
+        return -1;
+    }
+    return static_cast<int32_t>(node);
+}
+
+} // namespace common
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <cstring>
+#include <algorithm>
+
+#include <common/TimeParser.h>
+
+namespace common
+{
+
+namespace
+{
+// days since 1970-01-01 in the proleptic Gregorian calendar
+inline int64_t daysFromCivil(int64_t y, const uint32_t m, const uint32_t d)
+{
+    y -= (m <= 2);
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+    const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+inline uint32_t twoDigits(const char* const p)
+{
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+// fields are already checked to be digits
+inline Result toTime(
+    std::time_t& t,
+    const uint32_t year,
+    const uint32_t month,
+    const uint32_t day,
+    const uint32_t hour,
+    const uint32_t minute,
+    const uint32_t second)
+{
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+    {
+        return Result::INVALID_FORMAT;
+    }
+
+    const int64_t localSeconds =
+        daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    if (LocalTimeZone::instance().toUtc(localSeconds, t))
+    {
+        return Result::SUCCESS;
+    }
+
+    // out of the cached range
+    struct tm timeStruct = {0};
+    timeStruct.tm_year = year - 1900;
+    timeStruct.tm_mon = month - 1;
+    timeStruct.tm_mday = day;
+    timeStruct.tm_hour = hour;
+    timeStruct.tm_min = minute;
+    timeStruct.tm_sec = second;
+    timeStruct.tm_isdst = -1;
+    t = std::mktime(&timeStruct);
+    return Result::SUCCESS;
+}
+
+inline bool isDigit(const char c)
+{
+    return static_cast<uint32_t>(static_cast<uint8_t>(c)) - '0' <= 9;
+}
+} // namespace
+
+LocalTimeZone::LocalTimeZone()
+{
+    // transitions are searched by daily samples in [now - 2 years, now + 2 years]
+    static constexpr std::time_t step = 24 * 60 * 60;
+    static constexpr std::time_t range = 2 * 366 * step;
+
+    const std::time_t now = std::time(nullptr);
+    std::time_t t = now - range;
+    m_utcEnd = now + range;
+
+    int32_t offset = offsetAt(t);
+    m_transitions.push_back({t, t + offset, offset});
+    for (; t < m_utcEnd; t += step)
+    {
+        const std::time_t next = std::min(t + step, m_utcEnd);
+        const int32_t nextOffset = offsetAt(next);
+        if (nextOffset == offset)
+        {
+            continue;
+        }
+
+        // first second with the new offset
+        std::time_t lo = t, hi = next;
+        while (hi - lo > 1)
+        {
+            const std::time_t mid = lo + (hi - lo) / 2;
+            if (offsetAt(mid) == offset)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        m_transitions.push_back({hi, hi + nextOffset, nextOffset});
+        offset = nextOffset;
+    }
+}
+
+int32_t LocalTimeZone::offsetAt(const std::time_t t)
+{
+    struct tm local;
+    localtime_r(&t, &local);
+    return static_cast<int32_t>(local.tm_gmtoff);
+}
+
+const LocalTimeZone& LocalTimeZone::instance()
+{
+    static const LocalTimeZone timeZone;
+    return timeZone;
+}
+
+bool LocalTimeZone::toUtc(const int64_t localSeconds, std::time_t& t) const
+{
+    // the last transition which starts not later than the local time,
+    // ambiguous local times after a backward transition use the new offset
+    auto it = std::upper_bound(m_transitions.begin(), m_transitions.end(), localSeconds,
+        [] (const int64_t local, const Transition& transition) -> bool
+        {
+            return local < transition.m_localStart;
+        });
+    if (m_transitions.begin() == it)
+    {
+        return false;
+    }
+    -- it;
+
+    t = static_cast<std::time_t>(localSeconds - it->m_offset);
+    return t < m_utcEnd;
+}
+
+Result isoTimeFromString(std::time_t& t, const char* const buf, const size_t size)
+{
+    // YYYY-MM-DDTHH:MM:SS
+    if (size != isoTimeSize ||
+        !isDigit(buf[0]) || !isDigit(buf[1]) || !isDigit(buf[2]) || !isDigit(buf[3]) || buf[4] != '-' ||
+        !isDigit(buf[5]) || !isDigit(buf[6]) || buf[7] != '-' ||
+        !isDigit(buf[8]) || !isDigit(buf[9]) || buf[10] != 'T' ||
+        !isDigit(buf[11]) || !isDigit(buf[12]) || buf[13] != ':' ||
+        !isDigit(buf[14]) || !isDigit(buf[15]) || buf[16] != ':' ||
+        !isDigit(buf[17]) || !isDigit(buf[18]))
+    {
+        return Result::INVALID_FORMAT;
+    }
+
+    return toTime(t,
+        twoDigits(buf) * 100 + twoDigits(buf + 2),
+        twoDigits(buf + 5),
+        twoDigits(buf + 8),
+        twoDigits(buf + 11),
+        twoDigits(buf + 14),
+        twoDigits(buf + 17));
+}
+
+} // namespace common
\ No newline at end of file
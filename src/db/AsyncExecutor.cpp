@@ -0,0 +1,101 @@
+#include <common/Partition.h>
+#include <db/AsyncExecutor.h>
+
+namespace db
+{
+
+AsyncExecutor::~AsyncExecutor()
+{
+    stop();
+}
+
+void AsyncExecutor::start(const size_t partitionsCount, const size_t queueSize)
+{
+    if (m_isRunning)
+    {
+        return ;
+    }
+
+    m_queueSize = std::max<size_t>(queueSize, 1);
+    m_partitions.clear();
+    for (size_t i = 0; i < partitionsCount; ++i)
+    {
+        m_partitions.emplace_back(new Partition());
+    }
+    for (auto&& partition : m_partitions)
+    {
+        std::thread tmpThread(&AsyncExecutor::partitionFunc, this, std::ref(*partition));
+        std::swap(tmpThread, partition->m_thread);
+    }
+    m_isRunning = true;
+}
+
+void AsyncExecutor::stop()
+{
+    if (!m_isRunning)
+    {
+        return ;
+    }
+
+    m_isRunning = false;
+    for (auto&& partition : m_partitions)
+    {
+        std::unique_lock<std::mutex> l(partition->m_guard);
+        partition->m_isStopped = true;
+        partition->m_notEmptyCv.notify_all();
+        partition->m_notFullCv.notify_all();
+    }
+    for (auto&& partition : m_partitions)
+    {
+        partition->m_thread.join();
+    }
+}
+
+void AsyncExecutor::partitionFunc(Partition& partition)
+{
+    std::unique_lock<std::mutex> l(partition.m_guard);
+    while (!partition.m_isStopped || !partition.m_tasks.empty())
+    {
+        if (partition.m_tasks.empty())
+        {
+            partition.m_notEmptyCv.wait(l);
+            continue;
+        }
+
+        Task task = std::move(partition.m_tasks.front());
+        partition.m_tasks.pop_front();
+        l.unlock();
+
+        task();
+
+        l.lock();
+        -- partition.m_pendingCount;
+        partition.m_notFullCv.notify_one();
+    }
+}
+
+bool AsyncExecutor::execute(const int64_t key, Task&& task)
+{
+    if (m_partitions.empty())
+    {
+        return false;
+    }
+    Partition& partition = *m_partitions[common::partitionOf(key, m_partitions.size())];
+
+    // the stop flag is checked under the lock, so the thread of the partition executes every accepted task
+    std::unique_lock<std::mutex> l(partition.m_guard);
+    while (!partition.m_isStopped && partition.m_pendingCount >= m_queueSize)
+    {
+        partition.m_notFullCv.wait(l);
+    }
+    if (partition.m_isStopped)
+    {
+        return false;
+    }
+    ++ partition.m_pendingCount;
+    partition.m_tasks.emplace_back(std::move(task));
+    partition.m_notEmptyCv.notify_one();
+    return true;
+}
+
+} // namespace db
\ No newline at end of file
@@ -1,3 +1,6 @@
+#include <libconfig.h++>
+
+#include <common/Partition.h>
 #include <logger/LoggerDefines.h>
 #include <db/InMemoryStorage.h>
 
@@ -23,6 +26,12 @@ int64_t InMemoryStorage::UserStorage::getWeekScores(const Time currentTime) cons
 InMemoryStorage::InMemoryStorage()
 {
     m_logger = logger::Logger::getLogCategory("DB_IN_MEM");
+    m_shards.emplace_back(new Shard());
+}
+
+InMemoryStorage::Shard& InMemoryStorage::shardOf(const int64_t id) const
+{
+    return *m_shards[common::partitionOf(id, m_shards.size())];
 }
 
 Result InMemoryStorage::configure(const libconfig::Config& cfg)
@@ -34,6 +43,29 @@ Result InMemoryStorage::configure(const libconfig::Config& cfg)
         return Result::INVALID_STATE;
     }
 
+    using namespace libconfig;
+
+    // one shard per processor
+    int32_t shardsCount = 1;
+    try
+    {
+        const Setting& setting = cfg.lookup("application");
+        setting.lookupValue("processors-count", shardsCount);
+    }
+    catch (const SettingNotFoundException& e)
+    {
+    }
+    if (shardsCount < 1)
+    {
+        shardsCount = 1;
+    }
+    m_shards.clear();
+    for (int32_t i = 0; i < shardsCount; ++ i)
+    {
+        m_shards.emplace_back(new Shard());
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <shards: %d>", shardsCount);
+
     m_state = State::CONFIGURED;
     return Result::SUCCESS;
 }
@@ -51,11 +83,22 @@ Result InMemoryStorage::start()
     return Result::SUCCESS;
 }
 
+void InMemoryStorage::stop()
+{
+    if (State::STARTED != m_state)
+    {
+        return ;
+    }
+
+    m_state = State::STOPPED;
+}
+
 Result InMemoryStorage::storeUser(const int64_t id, const std::string& name)
 {
-    std::unique_lock<std::mutex> l(m_usersMapGuard);
-    auto it = m_users.find(id);
-    if (m_users.end() != it)
+    Shard& shard = shardOf(id);
+    std::unique_lock<std::mutex> l(shard.m_guard);
+    auto it = shard.m_users.find(id);
+    if (shard.m_users.end() != it)
     {
         if (it->second.m_name == name)
         {
@@ -72,7 +115,7 @@ Result InMemoryStorage::storeUser(const int64_t id, const std::string& name)
             return Result::USER_ALREADY_REG;
         }
     }
-    m_users.insert(std::make_pair(id, name));
+    shard.m_users.insert(std::make_pair(id, name));
     l.unlock();
     LOG_DEBUG(m_logger, "User was registered <id: %ld, name: %s>",
         id, name.c_str());
@@ -81,9 +124,10 @@ Result InMemoryStorage::storeUser(const int64_t id, const std::string& name)
 
 Result InMemoryStorage::renameUser(const int64_t id, const std::string& name)
 {
-    std::unique_lock<std::mutex> l(m_usersMapGuard);
-    auto it = m_users.find(id);
-    if (m_users.end() == it)
+    Shard& shard = shardOf(id);
+    std::unique_lock<std::mutex> l(shard.m_guard);
+    auto it = shard.m_users.find(id);
+    if (shard.m_users.end() == it)
     {
         l.unlock();
         LOG_ERROR(m_logger, "Cannot rename user <id: %ld, name: %s>. User is not found",
@@ -100,9 +144,10 @@ Result InMemoryStorage::renameUser(const int64_t id, const std::string& name)
 
 Result InMemoryStorage::storeUserDeal(const int64_t id, const std::time_t t, const int64_t amount)
 {
-    std::unique_lock<std::mutex> l(m_usersMapGuard);
-    auto it = m_users.find(id);
-    if (m_users.end() == it)
+    Shard& shard = shardOf(id);
+    std::unique_lock<std::mutex> l(shard.m_guard);
+    auto it = shard.m_users.find(id);
+    if (shard.m_users.end() == it)
     {
         l.unlock();
         LOG_ERROR(m_logger, "Cannot store user deal <id: %ld, time: %s, amount: %ld>. User is not found",
@@ -127,6 +172,43 @@ Result InMemoryStorage::storeUserDeal(const int64_t id, const std::time_t t, con
     return Result::SUCCESS;
 }
 
+void InMemoryStorage::storeUserDeals(const Deals& deals, std::vector<Result>& results)
+{
+    results.assign(deals.size(), Result::SUCCESS);
+    {
+        // deals of a processor belong to its shard, so the batch is usually stored under one lock
+        Shard* lockedShard = nullptr;
+        std::unique_lock<std::mutex> l;
+        for (size_t i = 0; i < deals.size(); ++ i)
+        {
+            const Deal& deal = deals[i];
+            Shard& shard = shardOf(deal.m_id);
+            if (&shard != lockedShard)
+            {
+                l = std::unique_lock<std::mutex>(shard.m_guard);
+                lockedShard = &shard;
+            }
+            auto it = shard.m_users.find(deal.m_id);
+            if (shard.m_users.end() == it)
+            {
+                results[i] = Result::USER_NOT_FOUND;
+                continue;
+            }
+            it->second.m_scores[deal.m_time] += deal.m_amount;
+        }
+    }
+
+    for (size_t i = 0; i < deals.size(); ++ i)
+    {
+        if (Result::SUCCESS != results[i])
+        {
+            LOG_ERROR(m_logger, "Cannot store user deal <id: %ld, time: %s, amount: %ld>. User is not found",
+                deals[i].m_id, common::timeToString(deals[i].m_time).c_str(), deals[i].m_amount);
+        }
+    }
+    LOG_DEBUG(m_logger, "%zu user deals were stored by batch", deals.size());
+}
+
 Result InMemoryStorage::storeConnectedUser(const int64_t id)
 {
     {
@@ -159,9 +241,10 @@ Result InMemoryStorage::removeConnectedUser(const int64_t id)
 
 Result InMemoryStorage::getUser(User& user, const int64_t id) const
 {
-    std::unique_lock<std::mutex> l(m_usersMapGuard);
-    auto it = m_users.find(id);
-    if (m_users.end() == it)
+    Shard& shard = shardOf(id);
+    std::unique_lock<std::mutex> l(shard.m_guard);
+    auto it = shard.m_users.find(id);
+    if (shard.m_users.end() == it)
     {
         l.unlock();
         LOG_ERROR(m_logger, "Cannot find user <id: %ld>", id);
@@ -189,10 +272,11 @@ Result InMemoryStorage::getLeaderboards(
     }
 
     Leaderboard tmpLeaderboard;
+    int64_t position = 1;
+    for (const auto& shard : m_shards)
     {
-        std::unique_lock<std::mutex> l(m_usersMapGuard);
-        int64_t position = 1;
-        for (const auto& user : m_users)
+        std::unique_lock<std::mutex> l(shard->m_guard);
+        for (const auto& user : shard->m_users)
         {
             tmpLeaderboard.emplace(
                 std::piecewise_construct,
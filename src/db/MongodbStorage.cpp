@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <queue>
+#include <thread>
 
 #include <libconfig.h++>
 
@@ -10,9 +12,13 @@
 #include <mongocxx/uri.hpp>
 #include <mongocxx/instance.hpp>
 #include <mongocxx/pipeline.hpp>
+#include <mongocxx/model/update_one.hpp>
+#include <mongocxx/model/write.hpp>
+#include <mongocxx/options/bulk_write.hpp>
 #include <mongocxx/exception/query_exception.hpp>
 #include <mongocxx/exception/bulk_write_exception.hpp>
 
+#include <common/Partition.h>
 #include <logger/LoggerDefines.h>
 #include <db/MongodbStorage.h>
 
@@ -20,13 +26,8 @@ namespace db
 {
 
 #define GET_COLLECTION(collectionName) \
-    mongocxx::pool::entry client; \
-    { \
-        std::unique_lock<std::mutex> l(m_poolGuard); \
-        client = m_pool->acquire(); \
-    } \
-    mongocxx::database database = (*client)[m_dbName]; \
-    mongocxx::collection collection = database[collectionName]
+    ClientGuard client = acquireClient(); \
+    mongocxx::collection& collection = client->collectionName
 
 using bsoncxx::builder::stream::close_array;
 using bsoncxx::builder::stream::close_document;
@@ -40,6 +41,11 @@ MongodbStorage::MongodbStorage()
     m_logger = logger::Logger::getLogCategory("DB_MONGO");
 }
 
+MongodbStorage::~MongodbStorage()
+{
+    stop();
+}
+
 Result MongodbStorage::configure(const libconfig::Config& cfg)
 {
     using namespace libconfig;
@@ -55,6 +61,109 @@ Result MongodbStorage::configure(const libconfig::Config& cfg)
     m_dbName = "leaderboard_db";
     m_usersCollectionName = "users";
     m_connectedUsersCollectionName = "connected_users";
+    m_asyncPartitionsCount = 0;
+    m_asyncQueueSize = 64;
+    try
+    {
+        const Setting& setting = cfg.lookup("db.async");
+        if (!setting.lookupValue("partitions", m_asyncPartitionsCount))
+        {
+            LOG_WARN(m_logger, "Canont find 'partitions' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("queue-size", m_asyncQueueSize))
+        {
+            LOG_WARN(m_logger, "Canont find 'queue-size' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'db.async' section in configuration. Default values will be used");
+    }
+    if (m_asyncPartitionsCount < 0 || m_asyncQueueSize < 1)
+    {
+        LOG_ERROR(m_logger, "Configuration is invalid: <async partitions: %d, async queue-size: %d>",
+            m_asyncPartitionsCount, m_asyncQueueSize);
+        return Result::CFG_INVALID;
+    }
+
+    m_warmLoadThreads = 4;
+    m_warmLoadBatchSize = 1000;
+    try
+    {
+        const Setting& setting = cfg.lookup("db.warm-load");
+        if (!setting.lookupValue("threads", m_warmLoadThreads))
+        {
+            LOG_WARN(m_logger, "Canont find 'threads' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("batch-size", m_warmLoadBatchSize))
+        {
+            LOG_WARN(m_logger, "Canont find 'batch-size' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'db.warm-load' section in configuration. Default values will be used");
+    }
+    if (m_warmLoadThreads < 1 || m_warmLoadBatchSize < 1)
+    {
+        LOG_ERROR(m_logger, "Configuration is invalid: <warm-load threads: %d, warm-load batch-size: %d>",
+            m_warmLoadThreads, m_warmLoadBatchSize);
+        return Result::CFG_INVALID;
+    }
+
+    m_leaderboardBatchSize = 10000;
+    m_leaderboardAllowDiskUse = true;
+    try
+    {
+        const Setting& setting = cfg.lookup("db.leaderboard");
+        if (!setting.lookupValue("batch-size", m_leaderboardBatchSize))
+        {
+            LOG_WARN(m_logger, "Canont find 'batch-size' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("allow-disk-use", m_leaderboardAllowDiskUse))
+        {
+            LOG_WARN(m_logger, "Canont find 'allow-disk-use' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'db.leaderboard' section in configuration. Default values will be used");
+    }
+    if (m_leaderboardBatchSize < 1)
+    {
+        LOG_ERROR(m_logger, "'leaderboard.batch-size'[%d] parameter is less than 1", m_leaderboardBatchSize);
+        return Result::CFG_INVALID;
+    }
+
+    // every worker, write-behind, async I/O and leaderboard thread can check out a client at once.
+    // The defaults of the workers are the same as in the logic
+    int32_t processorsCount = 1;
+    int32_t workersCount = 0;
+    try
+    {
+        const Setting& setting = cfg.lookup("application");
+        setting.lookupValue("processors-count", processorsCount);
+        workersCount = processorsCount + 1;
+        setting.lookupValue("workers-count", workersCount);
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        workersCount = processorsCount + 1;
+    }
+    try
+    {
+        const Setting& setting = cfg.lookup("application.autoscaling");
+        bool isAutoscaling = false;
+        setting.lookupValue("enabled", isAutoscaling);
+        if (isAutoscaling)
+        {
+            setting.lookupValue("max-workers", workersCount);
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+    }
+    m_clientsCount = workersCount + 1 + m_asyncPartitionsCount + (m_asyncPartitionsCount > 0 ? 1 : 0);
     try
     {
         const Setting& setting = cfg.lookup("db");
@@ -74,15 +183,29 @@ Result MongodbStorage::configure(const libconfig::Config& cfg)
         {
             LOG_WARN(m_logger, "Canont find 'connected_users_collection_name' parameter in configuration. Default value will be used");
         }
+        if (!setting.lookupValue("clients-count", m_clientsCount))
+        {
+            LOG_WARN(m_logger, "Canont find 'clients-count' parameter in configuration. Default value will be used");
+        }
     }
     catch (const SettingNotFoundException& e)
     {
         LOG_WARN(m_logger, "Canont find 'db' section in configuration. Default values will be used");
     }
 
+    if (m_clientsCount < 1)
+    {
+        LOG_ERROR(m_logger, "'clients-count'[%d] parameter is less than 1", m_clientsCount);
+        return Result::CFG_INVALID;
+    }
+
     LOG_INFO(m_logger, "Configuration parameters: <uri: %s, db_name: %s, "
-        "users_collection_name: %s, connected_users_collection_name: %s>",
-        m_uri.c_str(), m_dbName.c_str(), m_usersCollectionName.c_str(), m_connectedUsersCollectionName.c_str());
+        "users_collection_name: %s, connected_users_collection_name: %s, clients-count: %d, "
+        "async partitions: %d, async queue-size: %d, warm-load threads: %d, warm-load batch-size: %d, "
+        "leaderboard batch-size: %d, leaderboard allow-disk-use: %s>",
+        m_uri.c_str(), m_dbName.c_str(), m_usersCollectionName.c_str(), m_connectedUsersCollectionName.c_str(),
+        m_clientsCount, m_asyncPartitionsCount, m_asyncQueueSize, m_warmLoadThreads, m_warmLoadBatchSize,
+        m_leaderboardBatchSize, m_leaderboardAllowDiskUse ? "true" : "false");
 
     m_state = State::CONFIGURED;
     return Result::SUCCESS;
@@ -100,25 +223,103 @@ Result MongodbStorage::start()
     // this should be called only once
     static mongocxx::instance instance{};
 
-    // create collections
-    mongocxx::uri uri(m_uri);
+    m_clients.clear();
+    m_freeClients.clear();
+    for (int32_t i = 0; i < m_clientsCount; ++i)
+    {
+        ClientPtr client(new Client());
+        Result res = connect(*client);
+        if (Result::SUCCESS != res)
+        {
+            return res;
+        }
+        m_freeClients.push_back(client.get());
+        m_clients.emplace_back(std::move(client));
+    }
+
+    if (m_asyncPartitionsCount > 0)
+    {
+        m_executor.start(m_asyncPartitionsCount, m_asyncQueueSize);
+        m_readExecutor.start(1, m_asyncQueueSize);
+    }
+
+    m_state = State::STARTED;
+    return Result::SUCCESS;
+}
+
+void MongodbStorage::stop()
+{
+    if (State::STARTED != m_state)
+    {
+        return ;
+    }
+
+    // all submitted operations are completed before stop
+    m_executor.stop();
+    m_readExecutor.stop();
+
+    m_state = State::STOPPED;
+}
+
+Result MongodbStorage::connect(Client& client) const
+{
     try
     {
-        m_pool.reset(new mongocxx::pool(uri));
+        client.m_client.reset(new mongocxx::client(mongocxx::uri(m_uri)));
+        client.m_database = (*client.m_client)[m_dbName];
+        client.m_users = client.m_database[m_usersCollectionName];
+        client.m_connectedUsers = client.m_database[m_connectedUsersCollectionName];
     }
     catch (const mongocxx::exception& e)
     {
         LOG_ERROR(m_logger, "Cannot create MongoDB client, exception was thrown %s", e.what());
+        client.m_isBroken = true;
         return Result::DB_ERROR;
     }
-
-    m_state = State::STARTED;
+    client.m_isBroken = false;
     return Result::SUCCESS;
 }
 
+MongodbStorage::ClientGuard MongodbStorage::acquireClient() const
+{
+    Client* freeClient = nullptr;
+    {
+        std::unique_lock<std::mutex> l(m_freeClientsGuard);
+        m_freeClientsCv.wait(l, [this] () -> bool { return !m_freeClients.empty(); });
+        freeClient = m_freeClients.back();
+        m_freeClients.pop_back();
+    }
+
+    ClientGuard client(*this, *freeClient);
+    if (client->m_isBroken)
+    {
+        try
+        {
+            client->m_database.run_command(document{} << "ping" << 1 << finalize);
+            client->m_isBroken = false;
+        }
+        catch (const mongocxx::exception& e)
+        {
+            LOG_WARN(m_logger, "MongoDB client health check failed, exception was thrown %s. Reconnecting",
+                e.what());
+            connect(*freeClient);
+        }
+    }
+    return client;
+}
+
+void MongodbStorage::releaseClient(Client& client) const
+{
+    {
+        std::unique_lock<std::mutex> l(m_freeClientsGuard);
+        m_freeClients.push_back(&client);
+    }
+    m_freeClientsCv.notify_one();
+}
+
 Result MongodbStorage::storeUser(const int64_t id, const std::string& name)
 {
-    GET_COLLECTION(m_usersCollectionName);
+    GET_COLLECTION(m_users);
 
     mongocxx::stdx::optional<mongocxx::result::insert_one> result;
     try
@@ -133,6 +334,7 @@ Result MongodbStorage::storeUser(const int64_t id, const std::string& name)
     }
     catch (const mongocxx::bulk_write_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot register user <id: %ld, name: %s>. Exception was thrown %s",
             id, name.c_str(), e.what());
         return Result::DB_ERROR;
@@ -151,7 +353,7 @@ Result MongodbStorage::storeUser(const int64_t id, const std::string& name)
 
 Result MongodbStorage::renameUser(const int64_t id, const std::string& name)
 {
-    GET_COLLECTION(m_usersCollectionName);
+    GET_COLLECTION(m_users);
 
     mongocxx::stdx::optional<mongocxx::result::update> updateResult;
     try
@@ -167,6 +369,7 @@ Result MongodbStorage::renameUser(const int64_t id, const std::string& name)
     }
     catch (const mongocxx::bulk_write_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot rename user <id: %ld, name: %s>. Exception was thrown: %s",
             id, name.c_str(), e.what());
         return Result::DB_ERROR;
@@ -177,7 +380,8 @@ Result MongodbStorage::renameUser(const int64_t id, const std::string& name)
             id, name.c_str(), e.what());
         return Result::LOGIC_ERROR;
     }
-    if (!updateResult || ((*updateResult).modified_count() == 0))
+    // the user renamed to the same name is matched but not modified
+    if (!updateResult || ((*updateResult).matched_count() == 0))
     {
         LOG_ERROR(m_logger, "Cannot rename user <id: %ld, name: %s>. User is not found",
             id, name.c_str());
@@ -192,7 +396,7 @@ Result MongodbStorage::storeUserDeal(const int64_t id, const std::time_t t, cons
 {
     using std::chrono::system_clock;
 
-    GET_COLLECTION(m_usersCollectionName);
+    GET_COLLECTION(m_users);
 
     mongocxx::stdx::optional<bsoncxx::document::value> userRes;
     try
@@ -201,6 +405,7 @@ Result MongodbStorage::storeUserDeal(const int64_t id, const std::time_t t, cons
     }
     catch (const mongocxx::query_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot store user deal <id: %ld, time: %s, amount: %ld>. Exception was thrown: %s",
             id, common::timeToString(t).c_str(), amount, e.what());
         return Result::DB_ERROR;
@@ -235,6 +440,7 @@ Result MongodbStorage::storeUserDeal(const int64_t id, const std::time_t t, cons
     }
     catch (const mongocxx::bulk_write_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot store user deal <id: %ld, time: %s, amount: %ld>. Exception was thrown: %s",
             id, common::timeToString(t).c_str(), amount, e.what());
         return Result::DB_ERROR;
@@ -277,6 +483,7 @@ Result MongodbStorage::storeUserDeal(const int64_t id, const std::time_t t, cons
         }
         catch (const mongocxx::bulk_write_exception& e)
         {
+            client.setBroken();
             LOG_ERROR(m_logger, "Cannot store user deal <id: %ld, time: %s, amount: %ld>. Exception was thrown: %s",
                 id, common::timeToString(t).c_str(), amount, e.what());
             return Result::DB_ERROR;
@@ -296,22 +503,153 @@ Result MongodbStorage::storeUserDeal(const int64_t id, const std::time_t t, cons
     return Result::SUCCESS;
 }
 
+void MongodbStorage::storeUserDeals(const Deals& deals, std::vector<Result>& results)
+{
+    results.assign(deals.size(), Result::FAILED);
+    std::vector<size_t> indexes(deals.size());
+    for (size_t i = 0; i < indexes.size(); ++ i)
+    {
+        indexes[i] = i;
+    }
+    storeUserDeals(deals, indexes, results);
+}
+
+void MongodbStorage::storeUserDeals(const Deals& deals, const std::vector<size_t>& indexes, std::vector<Result>& results)
+{
+    using std::chrono::system_clock;
+
+    if (indexes.empty())
+    {
+        return ;
+    }
+
+    GET_COLLECTION(m_users);
+
+    // the score of the time is an element of the scores array, so it cannot be upserted: missing elements are added
+    // by the first bulk write and the amounts are added by the second one. Deals do not create users
+    std::vector<mongocxx::model::write> addScores;
+    std::vector<mongocxx::model::write> incScores;
+    addScores.reserve(indexes.size());
+    incScores.reserve(indexes.size());
+    for (const size_t i : indexes)
+    {
+        const Deal& deal = deals[i];
+        const bsoncxx::types::b_date time(system_clock::from_time_t(deal.m_time));
+        addScores.emplace_back(mongocxx::model::update_one(
+            document{} <<
+            "id" << deal.m_id <<
+            "scores.time" << open_document << "$ne" << time << close_document <<
+            finalize,
+            document{} <<
+            "$push" <<
+            open_document <<
+            "scores" <<
+            open_document <<
+            "time" << time <<
+            "score" << static_cast<int64_t>(0) <<
+            close_document <<
+            close_document <<
+            finalize));
+        incScores.emplace_back(mongocxx::model::update_one(
+            document{} <<
+            "id" << deal.m_id <<
+            "scores.time" << time <<
+            finalize,
+            document{} <<
+            "$inc" <<
+            open_document <<
+            "scores.$.score" << deal.m_amount <<
+            close_document <<
+            finalize));
+    }
+
+    mongocxx::options::bulk_write options;
+    options.ordered(false);
+    mongocxx::stdx::optional<mongocxx::result::bulk_write> result;
+    Result failure = Result::SUCCESS;
+    try
+    {
+        collection.bulk_write(addScores.begin(), addScores.end(), options);
+        result = collection.bulk_write(incScores.begin(), incScores.end(), options);
+    }
+    catch (const mongocxx::bulk_write_exception& e)
+    {
+        client.setBroken();
+        LOG_ERROR(m_logger, "Cannot store %zu user deals. Exception was thrown: %s", indexes.size(), e.what());
+        failure = Result::DB_ERROR;
+    }
+    catch (const std::logic_error& e)
+    {
+        LOG_ERROR(m_logger, "Cannot store %zu user deals. Exception was thrown: %s", indexes.size(), e.what());
+        failure = Result::LOGIC_ERROR;
+    }
+    if (Result::SUCCESS == failure && !result)
+    {
+        LOG_ERROR(m_logger, "Cannot store %zu user deals", indexes.size());
+        failure = Result::UPDATE_ERROR;
+    }
+    if (Result::SUCCESS != failure)
+    {
+        // the driver does not tell which operations are applied, so all deals are failed
+        for (const size_t i : indexes)
+        {
+            results[i] = failure;
+        }
+        return ;
+    }
+
+    // every deal of a registered user matches one document
+    if (static_cast<size_t>((*result).matched_count()) == indexes.size())
+    {
+        for (const size_t i : indexes)
+        {
+            results[i] = Result::SUCCESS;
+        }
+        LOG_DEBUG(m_logger, "%zu user deals were stored", indexes.size());
+        return ;
+    }
+
+    // deals of the users which are not registered are not matched, the other ones are stored
+    std::unordered_map<int64_t, Result> users;
+    for (const size_t i : indexes)
+    {
+        const int64_t id = deals[i].m_id;
+        auto it = users.find(id);
+        if (users.end() == it)
+        {
+            User user;
+            it = users.emplace(id, getUser(user, id, client)).first;
+        }
+        results[i] = it->second;
+    }
+}
+
 Result MongodbStorage::storeConnectedUser(const int64_t id)
 {
-    GET_COLLECTION(m_connectedUsersCollectionName);
+    GET_COLLECTION(m_connectedUsers);
 
-    mongocxx::stdx::optional<mongocxx::result::insert_one> result;
+    // the user connected again is stored once as in the in-memory storage
+    mongocxx::options::update options;
+    options.upsert(true);
+    mongocxx::stdx::optional<mongocxx::result::update> result;
     try
     {
         result =
-            collection.insert_one(
+            collection.update_one(
                 document{} <<
                 "_id" << id <<
+                finalize,
+                document{} <<
+                "$set" <<
+                open_document <<
                 "id" << id <<
-                finalize);
+                close_document <<
+                finalize,
+                options);
     }
     catch (const mongocxx::bulk_write_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot store connected user <id: %ld>. Exception was thrown: %s",
             id, e.what());
         return Result::DB_ERROR;
@@ -328,7 +666,7 @@ Result MongodbStorage::storeConnectedUser(const int64_t id)
 
 Result MongodbStorage::removeConnectedUser(const int64_t id)
 {
-    GET_COLLECTION(m_connectedUsersCollectionName);
+    GET_COLLECTION(m_connectedUsers);
 
     mongocxx::stdx::optional<mongocxx::result::delete_result> result;
     try
@@ -341,6 +679,7 @@ Result MongodbStorage::removeConnectedUser(const int64_t id)
     }
     catch (const mongocxx::bulk_write_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot remove connected user <id: %ld>. Exception was thrown: %s",
             id, e.what());
         return Result::DB_ERROR;
@@ -352,17 +691,203 @@ Result MongodbStorage::removeConnectedUser(const int64_t id)
     }
     if (0 == (*result).deleted_count())
     {
-        LOG_ERROR(m_logger, "Cannot remove connected user <id: %ld>", id);
-        return Result::USER_CONN_ERROR;
+        LOG_ERROR(m_logger, "Cannot remove connected user <id: %ld>. User is not found", id);
+        return Result::USER_NOT_FOUND;
     }
 
     LOG_DEBUG(m_logger, "Connected user was remove <id: %ld>", id);
     return Result::SUCCESS;
 }
 
+void MongodbStorage::storeUserAsync(const int64_t id, const std::string& name, const Callback& cb)
+{
+    if (!m_executor.isRunning())
+    {
+        return Storage::storeUserAsync(id, name, cb);
+    }
+    const bool isAccepted = m_executor.execute(id, [this, id, name, cb] () -> void
+        {
+            cb(storeUser(id, name));
+        });
+    if (!isAccepted)
+    {
+        // the storage is stopped meanwhile
+        cb(Result::INVALID_STATE);
+    }
+}
+
+void MongodbStorage::renameUserAsync(const int64_t id, const std::string& name, const Callback& cb)
+{
+    if (!m_executor.isRunning())
+    {
+        return Storage::renameUserAsync(id, name, cb);
+    }
+    const bool isAccepted = m_executor.execute(id, [this, id, name, cb] () -> void
+        {
+            cb(renameUser(id, name));
+        });
+    if (!isAccepted)
+    {
+        // the storage is stopped meanwhile
+        cb(Result::INVALID_STATE);
+    }
+}
+
+void MongodbStorage::storeUserDealAsync(const int64_t id, const std::time_t t, const int64_t amount, const Callback& cb)
+{
+    if (!m_executor.isRunning())
+    {
+        return Storage::storeUserDealAsync(id, t, amount, cb);
+    }
+    const bool isAccepted = m_executor.execute(id, [this, id, t, amount, cb] () -> void
+        {
+            cb(storeUserDeal(id, t, amount));
+        });
+    if (!isAccepted)
+    {
+        // the storage is stopped meanwhile
+        cb(Result::INVALID_STATE);
+    }
+}
+
+void MongodbStorage::storeUserDealsAsync(Deals&& deals, const BatchCallback& cb)
+{
+    if (!m_executor.isRunning() || deals.empty())
+    {
+        return Storage::storeUserDealsAsync(std::move(deals), cb);
+    }
+
+    // the batch is split by I/O threads, so every thread stores its deals by one task
+    // and they are ordered with the other operations of their users
+    struct Batch
+    {
+        Deals m_deals;
+        std::vector<Result> m_results;
+        std::atomic<size_t> m_pendingCount{0};
+        BatchCallback m_cb;
+    };
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    std::vector<std::vector<size_t> > partitions(m_executor.partitionsCount());
+    for (size_t i = 0; i < deals.size(); ++ i)
+    {
+        partitions[common::partitionOf(deals[i].m_id, partitions.size())].push_back(i);
+    }
+    batch->m_deals = std::move(deals);
+    batch->m_results.assign(batch->m_deals.size(), Result::FAILED);
+    batch->m_pendingCount = std::count_if(partitions.begin(), partitions.end(),
+        [] (const std::vector<size_t>& indexes) -> bool
+        {
+            return !indexes.empty();
+        });
+    batch->m_cb = cb;
+
+    for (auto&& indexes : partitions)
+    {
+        if (indexes.empty())
+        {
+            continue;
+        }
+        const int64_t key = batch->m_deals[indexes.front()].m_id;
+        const bool isAccepted = m_executor.execute(key, [this, batch, indexes] () -> void
+            {
+                storeUserDeals(batch->m_deals, indexes, batch->m_results);
+                if (1 == batch->m_pendingCount.fetch_sub(1))
+                {
+                    batch->m_cb(batch->m_results);
+                }
+            });
+        if (!isAccepted)
+        {
+            for (const size_t i : indexes)
+            {
+                batch->m_results[i] = Result::INVALID_STATE;
+            }
+            if (1 == batch->m_pendingCount.fetch_sub(1))
+            {
+                batch->m_cb(batch->m_results);
+            }
+        }
+    }
+}
+
+void MongodbStorage::storeConnectedUserAsync(const int64_t id, const Callback& cb)
+{
+    if (!m_executor.isRunning())
+    {
+        return Storage::storeConnectedUserAsync(id, cb);
+    }
+    const bool isAccepted = m_executor.execute(id, [this, id, cb] () -> void
+        {
+            cb(storeConnectedUser(id));
+        });
+    if (!isAccepted)
+    {
+        // the storage is stopped meanwhile
+        cb(Result::INVALID_STATE);
+    }
+}
+
+void MongodbStorage::removeConnectedUserAsync(const int64_t id, const Callback& cb)
+{
+    if (!m_executor.isRunning())
+    {
+        return Storage::removeConnectedUserAsync(id, cb);
+    }
+    const bool isAccepted = m_executor.execute(id, [this, id, cb] () -> void
+        {
+            cb(removeConnectedUser(id));
+        });
+    if (!isAccepted)
+    {
+        // the storage is stopped meanwhile
+        cb(Result::INVALID_STATE);
+    }
+}
+
+Future<User> MongodbStorage::getUserAsync(const int64_t id)
+{
+    if (!m_executor.isRunning())
+    {
+        return Storage::getUserAsync(id);
+    }
+    Promise<User> promise;
+    const bool isAccepted = m_executor.execute(id, [this, id, promise] () mutable -> void
+        {
+            User user;
+            const Result res = getUser(user, id);
+            promise.set(res, std::move(user));
+        });
+    if (!isAccepted)
+    {
+        promise.set(Result::INVALID_STATE, User());
+    }
+    return promise.future();
+}
+
+Future<Leaderboards> MongodbStorage::getLeaderboardsAsync(const int64_t count, const uint64_t before, const uint64_t after)
+{
+    if (!m_readExecutor.isRunning())
+    {
+        return Storage::getLeaderboardsAsync(count, before, after);
+    }
+    // the aggregation is not bound to a user, so it is executed by its own thread and does not delay mutations
+    Promise<Leaderboards> promise;
+    const bool isAccepted = m_readExecutor.execute(0, [this, count, before, after, promise] () mutable -> void
+        {
+            Leaderboards leaderboards;
+            const Result res = getLeaderboards(leaderboards, count, before, after);
+            promise.set(res, std::move(leaderboards));
+        });
+    if (!isAccepted)
+    {
+        promise.set(Result::INVALID_STATE, Leaderboards());
+    }
+    return promise.future();
+}
+
 std::unordered_set<int64_t> MongodbStorage::getConnectedUsers() const
 {
-    GET_COLLECTION(m_connectedUsersCollectionName);
+    GET_COLLECTION(m_connectedUsers);
 
     mongocxx::cursor cursor =
         collection.find(
@@ -401,6 +926,7 @@ std::unordered_set<int64_t> MongodbStorage::getConnectedUsers() const
     }
     catch (const mongocxx::query_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot retreive connected users, exception was thrown %s", e.what());
         return result;
     }
@@ -413,15 +939,228 @@ std::unordered_set<int64_t> MongodbStorage::getConnectedUsers() const
     return result;
 }
 
-Result MongodbStorage::getUser(User& user, const int64_t id, mongocxx::collection& collection) const
+Result MongodbStorage::getUsersIdRange(int64_t& minId, int64_t& maxId) const
+{
+    GET_COLLECTION(m_users);
+
+    mongocxx::options::find options;
+    options.projection(document{} << "_id" << 0 << "id" << 1 << finalize);
+
+    try
+    {
+        for (int32_t order : {1, -1})
+        {
+            options.sort(document{} << "id" << order << finalize);
+            bsoncxx::stdx::optional<bsoncxx::document::value> userRes =
+                collection.find_one(document{} << finalize, options);
+            if (!userRes)
+            {
+                // collection is empty
+                minId = 0;
+                maxId = -1;
+                return Result::SUCCESS;
+            }
+            bsoncxx::document::element id = (*userRes).view()["id"];
+            if (id.type() != bsoncxx::type::k_int64)
+            {
+                LOG_ERROR(m_logger, "Cannot get 'id' from the document");
+                return Result::DB_ERROR;
+            }
+            (1 == order ? minId : maxId) = id.get_int64();
+        }
+    }
+    catch (const mongocxx::query_exception& e)
+    {
+        client.setBroken();
+        LOG_ERROR(m_logger, "Cannot get users id range, exception was thrown %s", e.what());
+        return Result::DB_ERROR;
+    }
+    catch (const bsoncxx::exception& e)
+    {
+        LOG_ERROR(m_logger, "Exception '%s' was thrown while parsing document", e.what());
+        return Result::DB_ERROR;
+    }
+    return Result::SUCCESS;
+}
+
+Result MongodbStorage::loadUsersRange(Storage& target, const int64_t fromId, const int64_t toId, LoadStats& stats) const
+{
+    using std::chrono::system_clock;
+    using std::chrono::duration_cast;
+
+    GET_COLLECTION(m_users);
+
+    // only fields which are needed by the in-memory storage are transferred
+    mongocxx::options::find options;
+    options.projection(document{} << "_id" << 0 << "id" << 1 << "name" << 1 << "scores" << 1 << finalize);
+    options.batch_size(m_warmLoadBatchSize);
+
+    try
+    {
+        mongocxx::cursor cursor = collection.find(
+            document{} <<
+                "id" << open_document <<
+                    "$gte" << fromId <<
+                    "$lte" << toId <<
+                close_document <<
+            finalize,
+            options);
+        for (const bsoncxx::document::view& view : cursor)
+        {
+            try
+            {
+                bsoncxx::document::element id = view["id"];
+                bsoncxx::document::element name = view["name"];
+                if (id.type() != bsoncxx::type::k_int64 || name.type() != bsoncxx::type::k_utf8)
+                {
+                    LOG_DEBUG(m_logger, "Load users. Cannot get 'id' or 'name' from the document");
+                    ++ stats.m_badDocuments;
+                    continue;
+                }
+                const int64_t userId = id.get_int64();
+                Result res = target.storeUser(userId, name.get_utf8().value.to_string());
+                if (Result::SUCCESS != res)
+                {
+                    ++ stats.m_badDocuments;
+                    continue;
+                }
+                ++ stats.m_users;
+
+                bsoncxx::document::element userScores = view["scores"];
+                if (userScores.type() != bsoncxx::type::k_array)
+                {
+                    continue;
+                }
+                for (const auto& scoreElement : userScores.get_array().value)
+                {
+                    if (scoreElement.type() != bsoncxx::type::k_document)
+                    {
+                        continue;
+                    }
+                    bsoncxx::document::view scoreView = scoreElement.get_document().view();
+                    bsoncxx::document::element time = scoreView["time"];
+                    bsoncxx::document::element score = scoreView["score"];
+                    if (time.type() != bsoncxx::type::k_date || score.type() != bsoncxx::type::k_int64)
+                    {
+                        continue;
+                    }
+                    system_clock::time_point tp(duration_cast<system_clock::duration>(time.get_date().value));
+                    target.storeUserDeal(userId, system_clock::to_time_t(tp), score.get_int64());
+                    ++ stats.m_scores;
+                }
+            }
+            catch (const bsoncxx::exception& e)
+            {
+                LOG_DEBUG(m_logger, "Exception '%s' was thrown while parsing document",
+                    e.what());
+                ++ stats.m_badDocuments;
+                continue;
+            }
+        }
+    }
+    catch (const mongocxx::query_exception& e)
+    {
+        client.setBroken();
+        LOG_ERROR(m_logger, "Cannot load users <range: [%ld, %ld]>, exception was thrown %s",
+            fromId, toId, e.what());
+        return Result::DB_ERROR;
+    }
+
+    LOG_DEBUG(m_logger, "Load users. Range [%ld, %ld] was loaded: %lu users, %lu scores",
+        fromId, toId, stats.m_users, stats.m_scores);
+    return Result::SUCCESS;
+}
+
+Result MongodbStorage::loadUsers(Storage& target) const
+{
+    using std::chrono::steady_clock;
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+
+    const steady_clock::time_point startTime = steady_clock::now();
+
+    int64_t minId = 0, maxId = -1;
+    Result res = getUsersIdRange(minId, maxId);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+
+    // id space is split into contiguous ranges, every range is scanned by its own cursor and thread
+    std::vector<std::pair<int64_t, int64_t> > ranges;
+    if (minId <= maxId)
+    {
+        const uint64_t span = static_cast<uint64_t>(maxId) - static_cast<uint64_t>(minId);
+        const uint64_t rangesCount = std::min<uint64_t>(m_warmLoadThreads, span + 1);
+        const uint64_t step = span / rangesCount + 1;
+        for (uint64_t offset = 0; offset <= span; offset += step)
+        {
+            const uint64_t lastOffset = (span - offset < step) ? span : offset + step - 1;
+            ranges.emplace_back(
+                static_cast<int64_t>(static_cast<uint64_t>(minId) + offset),
+                static_cast<int64_t>(static_cast<uint64_t>(minId) + lastOffset));
+            if (span == lastOffset)
+            {
+                break;
+            }
+        }
+    }
+
+    std::vector<LoadStats> stats(ranges.size());
+    std::vector<Result> results(ranges.size(), Result::SUCCESS);
+    std::vector<std::thread> threads;
+    threads.reserve(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        threads.emplace_back([this, &target, &ranges, &stats, &results, i] () -> void
+            {
+                results[i] = loadUsersRange(target, ranges[i].first, ranges[i].second, stats[i]);
+            });
+    }
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+
+    LoadStats total;
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (Result::SUCCESS != results[i])
+        {
+            return results[i];
+        }
+        total.m_users += stats[i].m_users;
+        total.m_scores += stats[i].m_scores;
+        total.m_badDocuments += stats[i].m_badDocuments;
+    }
+
+    for (const int64_t id : getConnectedUsers())
+    {
+        target.storeConnectedUser(id);
+    }
+
+    if (total.m_badDocuments > 0)
+    {
+        LOG_WARN(m_logger, "Load users. Failed to process %lu documents", total.m_badDocuments);
+    }
+    const int64_t durationMs = std::max<int64_t>(
+        duration_cast<milliseconds>(steady_clock::now() - startTime).count(), 1);
+    LOG_INFO(m_logger, "Load users. Loaded %lu users with %lu scores using %zu cursors in %ld ms (%lu users/s)",
+        total.m_users, total.m_scores, ranges.size(), durationMs, total.m_users * 1000 / durationMs);
+
+    return Result::SUCCESS;
+}
+
+Result MongodbStorage::getUser(User& user, const int64_t id, ClientGuard& client) const
 {
     mongocxx::stdx::optional<bsoncxx::document::value> userRes;
     try
     {
-        userRes = collection.find_one(document{} << "id" << id << finalize);
+        userRes = client->m_users.find_one(document{} << "id" << id << finalize);
     }
     catch (const mongocxx::query_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot find user <id: %ld>. Exception was thrown: %s",
             id, e.what());
         return Result::DB_ERROR;
@@ -466,9 +1205,111 @@ Result MongodbStorage::getUser(User& user, const int64_t id, mongocxx::collectio
 
 Result MongodbStorage::getUser(User& user, const int64_t id) const
 {
-    GET_COLLECTION(m_usersCollectionName);
+    ClientGuard client = acquireClient();
 
-    return getUser(user, id, collection);
+    return getUser(user, id, client);
+}
+
+bool MongodbStorage::decodeLeaderboardRow(const bsoncxx::document::view& view, LeaderboardRow& row)
+{
+    // { _id: { id: <int64>, name: <utf8> }, weeklyScore: <int64> }
+    const bsoncxx::document::element score = view["weeklyScore"];
+    if (!score || score.type() != bsoncxx::type::k_int64)
+    {
+        return false;
+    }
+    const bsoncxx::document::element groupId = view["_id"];
+    if (!groupId || groupId.type() != bsoncxx::type::k_document)
+    {
+        return false;
+    }
+    const bsoncxx::document::element id = groupId["id"];
+    const bsoncxx::document::element name = groupId["name"];
+    if (!id || id.type() != bsoncxx::type::k_int64 || !name || name.type() != bsoncxx::type::k_utf8)
+    {
+        return false;
+    }
+    row.m_score = score.get_int64();
+    row.m_user.m_id = id.get_int64();
+    const bsoncxx::stdx::string_view nameView = name.get_utf8().value;
+    row.m_user.m_name.assign(nameView.data(), nameView.size());
+    return true;
+}
+
+void MongodbStorage::readLeaderboardRows(mongocxx::cursor& cursor, LeaderboardRowsQueue& queue) const
+{
+    static constexpr size_t maxQueuedBatches = 2;
+
+    const size_t batchSize = static_cast<size_t>(m_leaderboardBatchSize);
+    LeaderboardRows rows;
+    rows.reserve(batchSize);
+    uint64_t badDocuments = 0;
+
+    // returns false if the ranking is cancelled
+    auto pushRows = [&queue, &rows, batchSize] () -> bool
+        {
+            std::unique_lock<std::mutex> l(queue.m_guard);
+            while (!queue.m_isCancelled && queue.m_batches.size() >= maxQueuedBatches)
+            {
+                queue.m_cv.wait(l);
+            }
+            if (queue.m_isCancelled)
+            {
+                return false;
+            }
+            queue.m_batches.emplace_back(std::move(rows));
+            queue.m_cv.notify_all();
+            l.unlock();
+
+            rows = LeaderboardRows();
+            rows.reserve(batchSize);
+            return true;
+        };
+
+    Result res = Result::SUCCESS;
+    try
+    {
+        for (const bsoncxx::document::view& view : cursor)
+        {
+            rows.emplace_back();
+            bool isDecoded = false;
+            try
+            {
+                isDecoded = decodeLeaderboardRow(view, rows.back());
+            }
+            catch (const bsoncxx::exception& e)
+            {
+                LOG_DEBUG(m_logger, "Exception '%s' was thrown while parsing document",
+                    e.what());
+            }
+            if (!isDecoded)
+            {
+                rows.pop_back();
+                ++ badDocuments;
+                continue;
+            }
+
+            if (rows.size() >= batchSize && !pushRows())
+            {
+                break;
+            }
+        }
+    }
+    catch (const mongocxx::query_exception& e)
+    {
+        LOG_ERROR(m_logger, "Cannot get leaderboard from DB, exception was thrown %s", e.what());
+        res = Result::DB_ERROR;
+    }
+    if (!rows.empty())
+    {
+        pushRows();
+    }
+
+    std::unique_lock<std::mutex> l(queue.m_guard);
+    queue.m_result = res;
+    queue.m_badDocuments = badDocuments;
+    queue.m_isFinished = true;
+    queue.m_cv.notify_all();
 }
 
 Result MongodbStorage::getLeaderboards(
@@ -486,7 +1327,7 @@ Result MongodbStorage::getLeaderboards(
     // last week
     system_clock::time_point tp = system_clock::now() - duration_days(7);
 
-    GET_COLLECTION(m_usersCollectionName);
+    GET_COLLECTION(m_users);
     mongocxx::pipeline pipeline;
     pipeline
         .unwind("$scores")
@@ -513,72 +1354,59 @@ Result MongodbStorage::getLeaderboards(
             document{} <<
             "weeklyScore" << -1 <<
             finalize);
-    mongocxx::cursor cursor = collection.aggregate(pipeline);
 
-    Leaderboard tmpLeaderboard;
-    Leaderboard currentLeaderboard;
-    std::map<User, uint32_t> userToCount;
+    mongocxx::options::aggregate options;
+    options.batch_size(m_leaderboardBatchSize);
+    options.allow_disk_use(m_leaderboardAllowDiskUse);
 
-    uint64_t goodDocuments = 0;
-    uint64_t badDocuments = 0;
-    int64_t position = 1;
+    LeaderboardRowsQueue queue;
     try
     {
-        for (const bsoncxx::document::view& view : cursor)
+        mongocxx::cursor cursor = collection.aggregate(pipeline, options);
+
+        // cursor is drained by the reader thread, so the next batch is fetched and decoded
+        // while the rows of the previous one are ranked. The reader is joined by the guard
+        // on any exception, it is destroyed before the cursor
+        LeaderboardReaderGuard reader(queue,
+            std::thread(&MongodbStorage::readLeaderboardRows, this, std::ref(cursor), std::ref(queue)));
+
+        Leaderboard tmpLeaderboard;
+        Leaderboard currentLeaderboard;
+        std::map<User, uint32_t> userToCount;
+
+        uint64_t goodDocuments = 0;
+        int64_t position = 1;
+        std::unique_lock<std::mutex> l(queue.m_guard);
+        while (!queue.m_isFinished || !queue.m_batches.empty())
         {
-            LOG_DEBUG(m_logger, "Leaderboard. Got document : %s",
-                bsoncxx::to_json(view).c_str());
-
-            try
+            if (queue.m_batches.empty())
             {
-                bsoncxx::document::element _id = view["_id"];
-                if (_id.type() != bsoncxx::type::k_document)
-                {
-                    LOG_DEBUG(m_logger, "Cannot get '_id' from the document");
-                    ++ badDocuments;
-                    continue;
-                }
-
-                bsoncxx::document::view _idView = _id.get_document().view();
-                bsoncxx::document::element id = _idView["id"];
-                if (id.type() != bsoncxx::type::k_int64)
-                {
-                    LOG_DEBUG(m_logger, "Cannot get 'id' from the document");
-                    ++ badDocuments;
-                    continue;
-                }
-
-                bsoncxx::document::element name = _idView["name"];
-                if (name.type() != bsoncxx::type::k_utf8)
-                {
-                    LOG_DEBUG(m_logger, "Cannot get 'name' from the document");
-                    ++ badDocuments;
-                    continue;
-                }
-
-                bsoncxx::document::element score = view["weeklyScore"];
-                if (score.type() != bsoncxx::type::k_int64)
-                {
-                    LOG_DEBUG(m_logger, "Cannot get 'weeklyScore' from the document");
-                    ++ badDocuments;
-                    continue;
-                }
+                queue.m_cv.wait(l);
+                continue;
+            }
+            LeaderboardRows rows = std::move(queue.m_batches.front());
+            queue.m_batches.pop_front();
+            queue.m_cv.notify_all();
+            l.unlock();
 
+            for (const LeaderboardRow& row : rows)
+            {
                 ++ goodDocuments;
+                const User& rowUser = row.m_user;
 
                 if ((count <= 0) || 
                     (count > 0 && tmpLeaderboard.size() < static_cast<size_t>(count)))
                 {
                     tmpLeaderboard.emplace(
                         std::piecewise_construct,
-                        std::forward_as_tuple(score.get_int64(), position),
-                        std::forward_as_tuple(id.get_int64(), name.get_utf8().value.to_string()));
+                        std::forward_as_tuple(row.m_score, position),
+                        std::forward_as_tuple(rowUser));
                 }
 
                 currentLeaderboard.emplace(
                     std::piecewise_construct,
-                    std::forward_as_tuple(score.get_int64(), position),
-                    std::forward_as_tuple(id.get_int64(), name.get_utf8().value.to_string()));
+                    std::forward_as_tuple(row.m_score, position),
+                    std::forward_as_tuple(rowUser));
 
                 auto userToCountIt = userToCount.begin();
                 while (userToCountIt != userToCount.end())
@@ -593,8 +1421,8 @@ Result MongodbStorage::getLeaderboards(
                     }
                     lbIt->second.emplace(
                         std::piecewise_construct,
-                        std::forward_as_tuple(score.get_int64(), position),
-                        std::forward_as_tuple(id.get_int64(), name.get_utf8().value.to_string()));
+                        std::forward_as_tuple(row.m_score, position),
+                        std::forward_as_tuple(rowUser));
 
                     if (userToCountIt->second + 1 >= after)
                     {
@@ -608,22 +1436,12 @@ Result MongodbStorage::getLeaderboards(
                 }
                 ++ position;
 
-                auto idIt = connectedUsers.find(id.get_int64());
-                if (connectedUsers.end() != idIt)
+                // user name is taken from the aggregation, no lookup is needed
+                if (connectedUsers.end() != connectedUsers.find(rowUser.m_id))
                 {
-                    User user;
-                    Result res = getUser(user, *idIt, collection);
-                    if (Result::SUCCESS != res)
-                    {
-                        LOG_ERROR(m_logger, "Cannot find user with id %ld. Result: %d(%s)",
-                            *idIt, static_cast<int32_t>(res), common::resultToStr(res));
-                    }
-                    else
-                    {
-                        LOG_DEBUG(m_logger, "User %ld:%s found: adding leaderboard", user.m_id, user.m_name.c_str());
-                        userToCount.emplace(user, 0);
-                        leaderboards.emplace(user, currentLeaderboard);
-                    }
+                    LOG_DEBUG(m_logger, "User %ld:%s found: adding leaderboard", rowUser.m_id, rowUser.m_name.c_str());
+                    userToCount.emplace(rowUser, 0);
+                    leaderboards.emplace(rowUser, currentLeaderboard);
                 }
 
                 if (currentLeaderboard.size() > before)
@@ -631,30 +1449,34 @@ Result MongodbStorage::getLeaderboards(
                     currentLeaderboard.erase(currentLeaderboard.begin());
                 }
             }
-            catch (const bsoncxx::exception& e)
-            {
-                LOG_DEBUG(m_logger, "Exception '%s' was thrown while parsing document",
-                    e.what());
-                ++ badDocuments;
-                continue;
-            }
+
+            l.lock();
+        }
+        l.unlock();
+        reader.join();
+
+        if (Result::SUCCESS != queue.m_result)
+        {
+            client.setBroken();
+            return queue.m_result;
         }
+        if (queue.m_badDocuments > 0)
+        {
+            LOG_WARN(m_logger, "Leaderboard. Failed to process %lu documents", queue.m_badDocuments);
+        }
+        LOG_DEBUG(m_logger, "Leaderboard. Processed %lu documents", goodDocuments);
+
+        leaderboards.emplace(
+            std::piecewise_construct,
+            std::forward_as_tuple(-1, "Top"),
+            std::forward_as_tuple(std::move(tmpLeaderboard)));
     }
     catch (const mongocxx::query_exception& e)
     {
+        client.setBroken();
         LOG_ERROR(m_logger, "Cannot get leaderboard from DB, exception was thrown %s", e.what());
         return Result::DB_ERROR;
     }
-    if (badDocuments > 0)
-    {
-        LOG_WARN(m_logger, "Leaderboard. Failed to process %lu documents", badDocuments);
-    }
-    LOG_DEBUG(m_logger, "Leaderboard. Processed %lu documents", goodDocuments);
-
-    leaderboards.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(-1, "Top"),
-        std::forward_as_tuple(std::move(tmpLeaderboard)));
 
     return Result::SUCCESS;
 }
@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <chrono>
+
+#include <libconfig.h++>
+
+#include <common/Utils.h>
+#include <logger/LoggerDefines.h>
+#include <db/TieredStorage.h>
+#include <db/MongodbStorage.h>
+
+namespace db
+{
+
+namespace
+{
+// failures of the connection to MongoDB are transient, the other ones are not fixed by a retry
+inline bool isPermanent(const Result res)
+{
+    return Result::DB_ERROR != res;
+}
+} // namespace
+
+TieredStorage::TieredStorage():
+    m_memory(new InMemoryStorage()),
+    m_persistent(new MongodbStorage())
+{
+    m_logger = logger::Logger::getLogCategory("DB_TIERED");
+}
+
+TieredStorage::TieredStorage(std::unique_ptr<InMemoryStorage>&& memory, std::unique_ptr<Storage>&& persistent):
+    m_memory(std::move(memory)),
+    m_persistent(std::move(persistent))
+{
+    m_logger = logger::Logger::getLogCategory("DB_TIERED");
+}
+
+TieredStorage::~TieredStorage()
+{
+    stop();
+}
+
+Result TieredStorage::configure(const libconfig::Config& cfg)
+{
+    using namespace libconfig;
+
+    if (State::CREATED != m_state)
+    {
+        LOG_ERROR(m_logger, "Cannot configure storage in state %d(%s)",
+            static_cast<int32_t>(m_state), common::stateToStr(m_state));
+        return Result::INVALID_STATE;
+    }
+
+    Result res = m_memory->configure(cfg);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+    res = m_persistent->configure(cfg);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+
+    m_queueSize = 100000;
+    m_flushIntervalMs = 100;
+    m_batchSize = 1000;
+    m_maxRetries = 10;
+    m_retryIntervalMs = 100;
+    try
+    {
+        const Setting& setting = cfg.lookup("db.write-behind");
+        if (!setting.lookupValue("queue-size", m_queueSize))
+        {
+            LOG_WARN(m_logger, "Canont find 'queue-size' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("flush-interval", m_flushIntervalMs))
+        {
+            LOG_WARN(m_logger, "Canont find 'flush-interval' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("batch-size", m_batchSize))
+        {
+            LOG_WARN(m_logger, "Canont find 'batch-size' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("max-retries", m_maxRetries))
+        {
+            LOG_WARN(m_logger, "Canont find 'max-retries' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("retry-interval", m_retryIntervalMs))
+        {
+            LOG_WARN(m_logger, "Canont find 'retry-interval' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'db.write-behind' section in configuration. Default values will be used");
+    }
+    if (m_queueSize < 1 || m_batchSize < 1 || m_flushIntervalMs < 0 || m_maxRetries < 0 || m_retryIntervalMs < 1)
+    {
+        LOG_ERROR(m_logger, "Configuration is invalid: <queue-size: %d, flush-interval: %d ms, batch-size: %d, "
+            "max-retries: %d, retry-interval: %d ms>",
+            m_queueSize, m_flushIntervalMs, m_batchSize, m_maxRetries, m_retryIntervalMs);
+        return Result::CFG_INVALID;
+    }
+
+    LOG_INFO(m_logger, "Configuration parameters: <queue-size: %d, flush-interval: %d ms, batch-size: %d, "
+        "max-retries: %d, retry-interval: %d ms>",
+        m_queueSize, m_flushIntervalMs, m_batchSize, m_maxRetries, m_retryIntervalMs);
+
+    m_state = State::CONFIGURED;
+    return Result::SUCCESS;
+}
+
+Result TieredStorage::start()
+{
+    using std::swap;
+
+    if (State::CONFIGURED != m_state)
+    {
+        LOG_ERROR(m_logger, "Cannot start storage in state %d(%s)",
+            static_cast<int32_t>(m_state), common::stateToStr(m_state));
+        return Result::INVALID_STATE;
+    }
+
+    Result res = m_persistent->start();
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+    res = m_memory->start();
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+
+    // warm load: in-memory storage must contain everything that was persisted before
+    res = m_persistent->loadUsers(*m_memory);
+    if (Result::SUCCESS != res)
+    {
+        LOG_ERROR(m_logger, "Cannot load users from the persistent storage. Result: %d(%s)",
+            static_cast<int32_t>(res), common::resultToStr(res));
+        return res;
+    }
+    LOG_INFO(m_logger, "Warm load is finished, storage is ready");
+
+    m_isFlushThreadRunning = true;
+    std::thread flushThread(&TieredStorage::flushThreadFunc, this);
+    swap(flushThread, m_flushThread);
+    {
+        std::unique_lock<std::shared_timed_mutex> l(m_mutationsGuard);
+        m_isMutable = true;
+    }
+
+    m_state = State::STARTED;
+    return Result::SUCCESS;
+}
+
+void TieredStorage::stop()
+{
+    if (State::STARTED != m_state)
+    {
+        return ;
+    }
+
+    {
+        // mutations in progress are marked dirty before the flush thread is stopped
+        std::unique_lock<std::shared_timed_mutex> l(m_mutationsGuard);
+        m_isMutable = false;
+    }
+    {
+        std::unique_lock<std::mutex> l(m_dirtyGuard);
+        m_isFlushThreadRunning = false;
+        m_dirtyCv.notify_all();
+    }
+    // flush thread writes all dirty users before exit
+    m_flushThread.join();
+
+    m_memory->stop();
+    m_persistent->stop();
+
+    m_state = State::STOPPED;
+}
+
+template<class Write, class Mark>
+Result TieredStorage::mutate(const int64_t id, Write&& write, Mark&& mark)
+{
+    std::shared_lock<std::shared_timed_mutex> l(m_mutationsGuard);
+    if (!m_isMutable)
+    {
+        // nothing drains the queue after stop, so the mutation would never be persisted
+        LOG_ERROR(m_logger, "Cannot persist user <id: %ld>, storage is stopped", id);
+        return Result::INVALID_STATE;
+    }
+    Result res = write();
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+    return markDirty(id, std::forward<Mark>(mark));
+}
+
+template<class Func>
+Result TieredStorage::markDirty(const int64_t id, Func&& func)
+{
+    std::unique_lock<std::mutex> l(m_dirtyGuard);
+    auto it = m_dirtyUsers.find(id);
+    if (m_dirtyUsers.end() == it)
+    {
+        // only new dirty users take space in the queue, updates are coalesced
+        while (m_dirtyUsers.size() >= static_cast<size_t>(m_queueSize))
+        {
+            m_dirtyCv.notify_all();
+            m_dirtyNotFullCv.wait(l);
+        }
+        it = m_dirtyUsers.emplace(id, DirtyUser()).first;
+        m_dirtyOrder.push_back(id);
+    }
+    func(it->second);
+
+    if (m_dirtyUsers.size() >= static_cast<size_t>(m_batchSize))
+    {
+        m_dirtyCv.notify_all();
+    }
+    return Result::SUCCESS;
+}
+
+void TieredStorage::flushThreadFunc()
+{
+    using std::chrono::milliseconds;
+
+    // the persistent storage is given time to recover, so failed users are not retried in a busy loop
+    static const int64_t maxRetryDelayMs = 10000;
+
+    std::vector<std::pair<int64_t, DirtyUser> > batch;
+    batch.reserve(m_batchSize);
+    std::vector<std::pair<int64_t, DirtyUser> > failed;
+
+    std::unique_lock<std::mutex> l(m_dirtyGuard);
+    while (m_isFlushThreadRunning || !m_dirtyUsers.empty())
+    {
+        if (m_isFlushThreadRunning && m_dirtyOrder.size() < static_cast<size_t>(m_batchSize))
+        {
+            // give updates a chance to be coalesced, stop and a full batch wake the thread
+            m_dirtyCv.wait_for(l, milliseconds(m_flushIntervalMs));
+        }
+
+        // failed users wait for their retry time while the storage runs, after stop they are retried at once
+        Clock::time_point now = Clock::now();
+        while (!m_retryOrder.empty() && (!m_isFlushThreadRunning || m_retryOrder.begin()->first <= now))
+        {
+            m_dirtyOrder.push_front(m_retryOrder.begin()->second);
+            m_retryOrder.erase(m_retryOrder.begin());
+        }
+        while (!m_dirtyOrder.empty() && batch.size() < static_cast<size_t>(m_batchSize))
+        {
+            auto it = m_dirtyUsers.find(m_dirtyOrder.front());
+            m_dirtyOrder.pop_front();
+            if (m_isFlushThreadRunning && it->second.m_retryTime > now)
+            {
+                // new changes of the failed user wait with the failed ones
+                m_retryOrder.emplace(it->second.m_retryTime, it->first);
+                continue;
+            }
+            batch.emplace_back(it->first, std::move(it->second));
+            m_dirtyUsers.erase(it);
+        }
+        if (batch.empty())
+        {
+            continue;
+        }
+        m_dirtyNotFullCv.notify_all();
+        l.unlock();
+
+        for (auto&& user : batch)
+        {
+            if (flush(user.first, user.second))
+            {
+                continue;
+            }
+            if (++ user.second.m_attempts > m_maxRetries)
+            {
+                LOG_ERROR(m_logger, "User <id: %ld> is not persisted after %d attempts, its changes are dropped",
+                    user.first, user.second.m_attempts);
+                continue;
+            }
+            // every user backs off by its own failures, so the other users are flushed meanwhile
+            const int64_t delayMs = std::min(
+                static_cast<int64_t>(m_retryIntervalMs) << std::min(user.second.m_attempts - 1, 16),
+                maxRetryDelayMs);
+            now = Clock::now();
+            user.second.m_retryTime = now + milliseconds(delayMs);
+            failed.push_back(std::move(user));
+        }
+        LOG_DEBUG(m_logger, "%zu dirty users were flushed, %zu users will be retried",
+            batch.size() - failed.size(), failed.size());
+        batch.clear();
+
+        l.lock();
+        for (auto&& user : failed)
+        {
+            requeue(user.first, std::move(user.second));
+        }
+        failed.clear();
+    }
+}
+
+bool TieredStorage::flush(const int64_t id, DirtyUser& user)
+{
+    // in-memory storage has already accepted all these mutations, so transiently failed ones are kept for the retry
+    // and permanently failed ones are dropped
+    if (user.m_isRegistered || user.m_isRenamed)
+    {
+        const Result res = user.m_isRegistered
+            ? persistRegistration(id, user.m_name)
+            : m_persistent->renameUser(id, user.m_name);
+        if (Result::SUCCESS != res && !isPermanent(res))
+        {
+            LOG_ERROR(m_logger, "Cannot persist user <id: %ld, name: %s>. Result: %d(%s)",
+                id, user.m_name.c_str(), static_cast<int32_t>(res), common::resultToStr(res));
+            if (user.m_isRegistered)
+            {
+                // deals and connection of the user cannot be stored before its registration
+                return false;
+            }
+        }
+        else
+        {
+            if (Result::SUCCESS != res)
+            {
+                LOG_ERROR(m_logger, "Cannot persist user <id: %ld, name: %s>, it is dropped. Result: %d(%s)",
+                    id, user.m_name.c_str(), static_cast<int32_t>(res), common::resultToStr(res));
+            }
+            user.m_isRegistered = false;
+            user.m_isRenamed = false;
+        }
+    }
+
+    for (auto it = user.m_deals.begin(); it != user.m_deals.end(); )
+    {
+        const Result res = m_persistent->storeUserDeal(id, it->first, it->second);
+        if (Result::SUCCESS != res)
+        {
+            LOG_ERROR(m_logger, "Cannot persist user deal <id: %ld, time: %s, amount: %ld>%s. Result: %d(%s)",
+                id, common::timeToString(it->first).c_str(), it->second, (isPermanent(res) ? ", it is dropped" : ""),
+                static_cast<int32_t>(res), common::resultToStr(res));
+            if (!isPermanent(res))
+            {
+                ++ it;
+                continue;
+            }
+        }
+        it = user.m_deals.erase(it);
+    }
+
+    // the latest connection state is written, so the coalesced connect and disconnect do not fail
+    // when the state is persisted already
+    Result res = Result::SUCCESS;
+    switch (user.m_connection)
+    {
+        case DirtyUser::Connection::CONNECTED:
+            res = m_persistent->storeConnectedUser(id);
+            break;
+        case DirtyUser::Connection::DISCONNECTED:
+            res = m_persistent->removeConnectedUser(id);
+            res = (Result::USER_NOT_FOUND == res) ? Result::SUCCESS : res;
+            break;
+        case DirtyUser::Connection::NONE:
+            break;
+    }
+    if (Result::SUCCESS != res)
+    {
+        LOG_ERROR(m_logger, "Cannot persist connected user <id: %ld>%s. Result: %d(%s)",
+            id, (isPermanent(res) ? ", it is dropped" : ""), static_cast<int32_t>(res), common::resultToStr(res));
+    }
+    if (Result::SUCCESS == res || isPermanent(res))
+    {
+        user.m_connection = DirtyUser::Connection::NONE;
+    }
+
+    return !user.m_isRegistered && !user.m_isRenamed && user.m_deals.empty()
+        && DirtyUser::Connection::NONE == user.m_connection;
+}
+
+Result TieredStorage::persistRegistration(const int64_t id, const std::string& name)
+{
+    const Result res = m_persistent->storeUser(id, name);
+    if (Result::SUCCESS == res)
+    {
+        return res;
+    }
+    // the user cannot be persisted by anyone else: all users are loaded on start and registered in memory first
+    User persisted;
+    const Result found = m_persistent->getUser(persisted, id);
+    if (Result::SUCCESS == found)
+    {
+        return (persisted.m_name == name) ? Result::SUCCESS : m_persistent->renameUser(id, name);
+    }
+    return (Result::USER_NOT_FOUND == found) ? res : found;
+}
+
+void TieredStorage::requeue(const int64_t id, DirtyUser&& failed)
+{
+    auto it = m_dirtyUsers.find(id);
+    if (m_dirtyUsers.end() == it)
+    {
+        m_retryOrder.emplace(failed.m_retryTime, id);
+        m_dirtyUsers.emplace(id, std::move(failed));
+        return ;
+    }
+
+    // failed mutations are older than the queued ones
+    DirtyUser& user = it->second;
+    const bool hasName = user.m_isRegistered || user.m_isRenamed;
+    if (failed.m_isRegistered)
+    {
+        // the registration is written with the latest name
+        user.m_isRegistered = true;
+        user.m_isRenamed = false;
+    }
+    else if (failed.m_isRenamed && !hasName)
+    {
+        user.m_isRenamed = true;
+    }
+    if (!hasName)
+    {
+        user.m_name = std::move(failed.m_name);
+    }
+    for (auto&& deal : failed.m_deals)
+    {
+        user.m_deals[deal.first] += deal.second;
+    }
+    if (DirtyUser::Connection::NONE == user.m_connection)
+    {
+        user.m_connection = failed.m_connection;
+    }
+    user.m_attempts = failed.m_attempts;
+    // the user is in the dirty order, it is delayed when it is taken from there
+    user.m_retryTime = failed.m_retryTime;
+}
+
+Result TieredStorage::storeUser(const int64_t id, const std::string& name)
+{
+    return mutate(id,
+        [this, id, &name] () -> Result
+        {
+            return m_memory->storeUser(id, name);
+        },
+        [&name] (DirtyUser& user) -> void
+        {
+            user.m_isRegistered = true;
+            user.m_name = name;
+        });
+}
+
+Result TieredStorage::renameUser(const int64_t id, const std::string& name)
+{
+    return mutate(id,
+        [this, id, &name] () -> Result
+        {
+            return m_memory->renameUser(id, name);
+        },
+        [&name] (DirtyUser& user) -> void
+        {
+            // pending registration is written with the latest name
+            user.m_isRenamed = !user.m_isRegistered;
+            user.m_name = name;
+        });
+}
+
+Result TieredStorage::storeUserDeal(const int64_t id, const std::time_t t, const int64_t amount)
+{
+    return mutate(id,
+        [this, id, t, amount] () -> Result
+        {
+            return m_memory->storeUserDeal(id, t, amount);
+        },
+        [t, amount] (DirtyUser& user) -> void
+        {
+            user.m_deals[t] += amount;
+        });
+}
+
+void TieredStorage::storeUserDeals(const Deals& deals, std::vector<Result>& results)
+{
+    std::shared_lock<std::shared_timed_mutex> l(m_mutationsGuard);
+    if (!m_isMutable)
+    {
+        LOG_ERROR(m_logger, "Cannot persist %zu deals, storage is stopped", deals.size());
+        results.assign(deals.size(), Result::INVALID_STATE);
+        return ;
+    }
+    m_memory->storeUserDeals(deals, results);
+    for (size_t i = 0; i < deals.size(); ++ i)
+    {
+        if (Result::SUCCESS != results[i])
+        {
+            continue;
+        }
+        const Deal& deal = deals[i];
+        results[i] = markDirty(deal.m_id, [&deal] (DirtyUser& user) -> void
+            {
+                user.m_deals[deal.m_time] += deal.m_amount;
+            });
+    }
+}
+
+Result TieredStorage::storeConnectedUser(const int64_t id)
+{
+    return mutate(id,
+        [this, id] () -> Result
+        {
+            return m_memory->storeConnectedUser(id);
+        },
+        [] (DirtyUser& user) -> void
+        {
+            user.m_connection = DirtyUser::Connection::CONNECTED;
+        });
+}
+
+Result TieredStorage::removeConnectedUser(const int64_t id)
+{
+    return mutate(id,
+        [this, id] () -> Result
+        {
+            return m_memory->removeConnectedUser(id);
+        },
+        [] (DirtyUser& user) -> void
+        {
+            user.m_connection = DirtyUser::Connection::DISCONNECTED;
+        });
+}
+
+Result TieredStorage::getUser(User& user, const int64_t id) const
+{
+    return m_memory->getUser(user, id);
+}
+
+Result TieredStorage::getLeaderboards(
+    Leaderboards& leaderboards,
+    const int64_t count,
+    const uint64_t before,
+    const uint64_t after)
+        const
+{
+    return m_memory->getLeaderboards(leaderboards, count, before, after);
+}
+
+} // namespace db
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include <chrono>
+#include <future>
+
+#include <logger/Logger.h>
+#include <logger/LoggerDefines.h>
+#include <rabbitmq/EventLoop.h>
+#include <rabbitmq/Acknowledger.h>
+
+namespace rabbitmq
+{
+
+Acknowledger::Acknowledger(
+    EventLoop& eventLoop,
+    const std::shared_ptr<AMQP::TcpChannel>& channel,
+    const uint16_t maxPrefetch,
+    std::unique_ptr<PrefetchController>&& prefetchController):
+    m_eventLoop(eventLoop),
+    m_channel(channel),
+    m_order(maxPrefetch),
+    m_prefetchController(std::move(prefetchController))
+{
+    m_logger = logger::Logger::getLogCategory("RMQ_ACKNOWLEDGER");
+}
+
+void Acknowledger::received(const uint64_t deliveryTag)
+{
+    if (m_prefetchController)
+    {
+        m_receivedTimes.emplace(deliveryTag, Clock::now());
+    }
+}
+
+void Acknowledger::ack(const uint64_t deliveryTag)
+{
+    std::shared_ptr<Acknowledger> self = shared_from_this();
+    m_eventLoop.post([self, deliveryTag] () -> void
+        {
+            self->settle(deliveryTag, true, 0);
+        });
+}
+
+void Acknowledger::reject(const uint64_t deliveryTag)
+{
+    std::shared_ptr<Acknowledger> self = shared_from_this();
+    m_eventLoop.post([self, deliveryTag] () -> void
+        {
+            self->settle(deliveryTag, false, 0);
+        });
+}
+
+void Acknowledger::requeue(const uint64_t deliveryTag)
+{
+    std::shared_ptr<Acknowledger> self = shared_from_this();
+    m_eventLoop.post([self, deliveryTag] () -> void
+        {
+            self->settle(deliveryTag, false, AMQP::requeue);
+        });
+}
+
+void Acknowledger::settle(std::vector<Settlement>&& settlements)
+{
+    if (settlements.empty())
+    {
+        return ;
+    }
+    std::shared_ptr<Acknowledger> self = shared_from_this();
+    std::shared_ptr<std::vector<Settlement> > batch = std::make_shared<std::vector<Settlement> >(std::move(settlements));
+    m_eventLoop.post([self, batch] () -> void
+        {
+            for (auto&& settlement : *batch)
+            {
+                self->settle(settlement.first, settlement.second, 0);
+            }
+        });
+}
+
+void Acknowledger::settle(const uint64_t deliveryTag, const bool isSucceeded, const int rejectFlags)
+{
+    if (!m_channel)
+    {
+        LOG_WARN(m_logger, "Cannot settle delivery %lu: channel is closed", deliveryTag);
+        return ;
+    }
+    updatePrefetch(deliveryTag);
+    if (!isSucceeded)
+    {
+        m_channel->reject(deliveryTag, rejectFlags);
+    }
+    if (m_order.settle(deliveryTag, isSucceeded))
+    {
+        LOG_WARN(m_logger, "Delivery %lu is not settled while %zu following deliveries are settled, "
+            "the gap exceeds the prefetch", m_order.settledTag() + 1, m_order.outOfOrderCount());
+    }
+
+    // acks settled by the tasks that are posted already are sent together
+    if (0 != m_order.ackTag() && !m_isFlushPosted)
+    {
+        m_isFlushPosted = true;
+        std::shared_ptr<Acknowledger> self = shared_from_this();
+        m_eventLoop.post([self] () -> void
+            {
+                self->flush();
+            });
+    }
+}
+
+void Acknowledger::updatePrefetch(const uint64_t deliveryTag)
+{
+    auto it = m_receivedTimes.find(deliveryTag);
+    if (m_receivedTimes.end() == it)
+    {
+        return ;
+    }
+    const int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - it->second).count();
+    m_receivedTimes.erase(it);
+
+    if (!m_prefetchController->addSample(latencyUs))
+    {
+        return ;
+    }
+    m_channel->setQos(m_prefetchController->prefetch());
+    LOG_INFO(m_logger, "Prefetch is changed to %u, average latency: %.0f us",
+        static_cast<uint32_t>(m_prefetchController->prefetch()), m_prefetchController->averageLatency());
+}
+
+void Acknowledger::flush()
+{
+    m_isFlushPosted = false;
+    if (!m_channel || 0 == m_order.ackTag())
+    {
+        return ;
+    }
+    // rejected deliveries are settled already, so they are not affected
+    const uint64_t ackTag = m_order.takeAckTag();
+    m_channel->ack(ackTag, AMQP::multiple);
+    LOG_DEBUG(m_logger, "Deliveries are acked up to %lu", ackTag);
+}
+
+void Acknowledger::close()
+{
+    // the promise is shared, so the task can outlive the wait
+    std::shared_ptr<std::promise<void> > closed = std::make_shared<std::promise<void> >();
+    std::future<void> future = closed->get_future();
+    std::shared_ptr<Acknowledger> self = shared_from_this();
+    m_eventLoop.post([self, closed] () -> void
+        {
+            self->flush();
+            if (0 != self->m_order.outOfOrderCount())
+            {
+                LOG_WARN(self->m_logger, "Channel is closed with %zu deliveries settled out of order",
+                    self->m_order.outOfOrderCount());
+            }
+            self->m_channel.reset();
+            self->m_receivedTimes.clear();
+            closed->set_value();
+        });
+
+    if (std::future_status::ready != future.wait_for(std::chrono::seconds(5)))
+    {
+        LOG_ERROR(m_logger, "Cannot close acknowledger: event loop does not respond");
+    }
+}
+
+} // namespace rabbitmq
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <libconfig.h++>
 
 #include <logger/Logger.h>
@@ -10,36 +12,147 @@ namespace rabbitmq
 void Consumer::onMessageCallback(
     const AMQP::Message &message, uint64_t deliveryTag, bool redelivered)
 {
-    std::string messageString(message.body(), message.bodySize());
-    std::string exchange(message.exchange());
-    std::string routingkey(message.routingkey());
-
-    LOG_DEBUG(m_logger, "Message received: <Body: %s. Exchange: %s. Routing key :%s."
+    // exchange and routing key are read from the message only if they are logged
+    LOG_DEBUG(m_logger, "Message received: <Body: %.*s. Exchange: %s. Routing key :%s."
         "Delivery tag: %lu. Redelivered: %s>",
-        messageString.c_str(), exchange.c_str(), routingkey.c_str(),
+        static_cast<int>(message.bodySize()), message.body(),
+        message.exchange().c_str(), message.routingkey().c_str(),
         deliveryTag, (redelivered ? "true" : "false"));
 
+    m_acknowledger->received(deliveryTag);
     if (!m_messageProcessingCallback)
     {
-        LOG_ERROR(m_logger, "Cannot process message '%s'. Callback is not set",
-            messageString.c_str());
+        LOG_ERROR(m_logger, "Cannot process message '%.*s'. Callback is not set",
+            static_cast<int>(message.bodySize()), message.body());
+        m_acknowledger->reject(deliveryTag);
         return ;
     }
-    ProcessingItem item(
-        m_channel,
-        std::move(messageString),
-        std::move(exchange),
-        std::move(routingkey),
-        deliveryTag,
-        redelivered);
+
+    // the body is copied into the buffer of the pooled item, it is not allocated once the buffer is grown
+    ProcessingItemPtr item = m_itemPool->acquire();
+    item->m_acknowledger = m_acknowledger;
+    item->m_message.assign(message.body(), message.bodySize());
+    item->m_deliveryTag = deliveryTag;
+    item->m_redelivered = redelivered;
+    if (message.hasContentType())
+    {
+        item->m_contentType = ProcessingItem::contentTypeFromString(message.contentType());
+    }
+    if (message.hasMessageID())
+    {
+        item->m_messageId.assign(message.messageID());
+    }
 
     Result r = m_messageProcessingCallback(std::move(item));
     if (Result::SUCCESS != r)
     {
         LOG_ERROR(m_logger, "Cannot process message. Result: %d(%s)",
             static_cast<int32_t>(r), common::resultToStr(r));
+        // acks of the following deliveries wait until all previous ones are settled.
+        // Overflowed message and the message received while processing is stopped are held by the broker
+        if (Result::QUEUE_OVERFLOW == r || Result::INVALID_STATE == r)
+        {
+            m_acknowledger->requeue(deliveryTag);
+            return ;
+        }
+        m_acknowledger->reject(deliveryTag);
         return ;
     }
 }
 
+Result Consumer::doConfigure(const libconfig::Config& cfg)
+{
+    using namespace libconfig;
+
+    // every unacked delivery can be queued by the same processor, so the queue cannot overflow
+    int32_t processorQueueSize = 1024;
+    try
+    {
+        const Setting& setting = cfg.lookup("application");
+        setting.lookupValue("processor-queue-size", processorQueueSize);
+    }
+    catch (const SettingNotFoundException& e)
+    {
+    }
+
+    m_prefetchMax = std::min(processorQueueSize, static_cast<int32_t>(UINT16_MAX));
+    try
+    {
+        const Setting& setting = cfg.lookup("rabbitmq.prefetch");
+        if (!setting.lookupValue("max", m_prefetchMax))
+        {
+            LOG_WARN(m_logger, "Canont find 'max' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("min", m_prefetchMin))
+        {
+            LOG_WARN(m_logger, "Canont find 'min' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("adaptive", m_isPrefetchAdaptive))
+        {
+            LOG_WARN(m_logger, "Canont find 'adaptive' parameter in configuration. Default value will be used");
+        }
+        if (!setting.lookupValue("target-latency", m_targetLatencyMs))
+        {
+            LOG_WARN(m_logger, "Canont find 'target-latency' parameter in configuration. Default value will be used");
+        }
+    }
+    catch (const SettingNotFoundException& e)
+    {
+        LOG_WARN(m_logger, "Canont find 'rabbitmq.prefetch' section in configuration. Default values will be used");
+    }
+
+    if (m_prefetchMax < 1 || m_prefetchMax > processorQueueSize || m_prefetchMax > UINT16_MAX)
+    {
+        LOG_ERROR(m_logger, "'prefetch.max'[%d] parameter must be in [1, min(%d, %d)]: processor queue can overflow",
+            m_prefetchMax, processorQueueSize, static_cast<int32_t>(UINT16_MAX));
+        return Result::CFG_INVALID;
+    }
+    if (m_prefetchMin < 1 || m_prefetchMin > m_prefetchMax)
+    {
+        LOG_ERROR(m_logger, "'prefetch.min'[%d] parameter must be in [1, %d]", m_prefetchMin, m_prefetchMax);
+        return Result::CFG_INVALID;
+    }
+    if (m_targetLatencyMs < 1)
+    {
+        LOG_ERROR(m_logger, "'prefetch.target-latency'[%d] parameter is less than 1", m_targetLatencyMs);
+        return Result::CFG_INVALID;
+    }
+    LOG_INFO(m_logger, "Configuration parameters: <prefetch: <max: %d; min: %d; adaptive: %s; target-latency: %d ms>>",
+        m_prefetchMax, m_prefetchMin, (m_isPrefetchAdaptive ? "true" : "false"), m_targetLatencyMs);
+
+    m_itemPool.reset(new ProcessingItemPool(static_cast<size_t>(m_prefetchMax), [] () -> ProcessingItem*
+        {
+            ProcessingItem* item = new ProcessingItem();
+            item->m_message.reserve(pooledMessageSize);
+            return item;
+        }));
+    return Result::SUCCESS;
+}
+
+Result Consumer::doStart()
+{
+    Result res = setQosSync(static_cast<uint16_t>(m_prefetchMax));
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+
+    std::unique_ptr<PrefetchController> prefetchController;
+    if (m_isPrefetchAdaptive)
+    {
+        prefetchController.reset(new PrefetchController(
+            static_cast<uint16_t>(m_prefetchMin),
+            static_cast<uint16_t>(m_prefetchMax),
+            static_cast<int64_t>(m_targetLatencyMs) * 1000));
+    }
+    m_acknowledger = std::make_shared<Acknowledger>(m_eventLoop, m_channel,
+        static_cast<uint16_t>(m_prefetchMax), std::move(prefetchController));
+    return Result::SUCCESS;
+}
+
+void Consumer::doStop()
+{
+    m_acknowledger->close();
+}
+
 } // namespace rabbitmq
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <unistd.h>
+#include <sys/eventfd.h>
 
 #include <logger/LoggerDefines.h>
 
@@ -11,9 +12,67 @@ namespace rabbitmq
 EventLoop::EventLoop()
 {
     m_logger = logger::Logger::getLogCategory("EVENT_LOOP");
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0)
+    {
+        LOG_ERROR(m_logger, "Cannot create eventfd, posted tasks are run by timeout. Errno: %d(%s)",
+            errno, std::strerror(errno));
+        return ;
+    }
+    pollfd wakeFd = {0};
+    wakeFd.fd = m_wakeFd;
+    wakeFd.events = POLLIN;
+    m_pollFds.emplace_back(std::move(wakeFd));
+    m_connectionItems.emplace_back(nullptr, m_wakeFd, AMQP::readable);
 }
 EventLoop::~EventLoop()
-{}
+{
+    if (m_wakeFd >= 0)
+    {
+        close(m_wakeFd);
+    }
+}
+
+void EventLoop::post(Task&& task)
+{
+    bool isWakeNeeded;
+    {
+        std::unique_lock<std::mutex> l(m_tasksGuard);
+        isWakeNeeded = m_tasks.empty();
+        m_tasks.emplace_back(std::move(task));
+    }
+
+    const uint64_t value = 1;
+    if (isWakeNeeded && !m_isBusyPoll && m_wakeFd >= 0 && write(m_wakeFd, &value, sizeof(value)) < 0)
+    {
+        LOG_ERROR(m_logger, "Cannot wake event loop up. Errno: %d(%s)",
+            errno, std::strerror(errno));
+    }
+}
+
+void EventLoop::runTasks()
+{
+    std::vector<Task> tasks;
+    {
+        std::unique_lock<std::mutex> l(m_tasksGuard);
+        std::swap(tasks, m_tasks);
+    }
+    for (auto&& task : tasks)
+    {
+        task();
+    }
+}
+
+void EventLoop::setThreadInit(ThreadInit&& threadInit)
+{
+    m_threadInit = std::move(threadInit);
+}
+
+void EventLoop::setBusyPoll(const bool isBusyPoll)
+{
+    m_isBusyPoll = isBusyPoll;
+}
 
 void EventLoop::start()
 {
@@ -116,7 +175,11 @@ void EventLoop::remove(const ConnectionItem& item)
 
 void EventLoop::func()
 {
-    LOG_INFO(m_logger, "Event loop started");
+    if (m_threadInit)
+    {
+        m_threadInit();
+    }
+    LOG_INFO(m_logger, "Event loop started <busy-poll: %s>", (m_isBusyPoll ? "true" : "false"));
     while (m_isRunning)
     {
         {
@@ -128,12 +191,14 @@ void EventLoop::func()
                 m_connectionItemsQueue.pop();
             }
         }
+        runTasks();
+
         if (m_pollFds.empty())
         {
             sleep(1);
             continue;
         }
-        int res = poll(&m_pollFds[0], m_pollFds.size(), 100);
+        int res = poll(&m_pollFds[0], m_pollFds.size(), m_isBusyPoll ? 0 : 100);
         if (res < 0)
         {
             LOG_ERROR(m_logger, "Poll operation failed. Errno: %d(%s)",
@@ -147,6 +212,15 @@ void EventLoop::func()
 
         for (size_t i = 0, size = m_pollFds.size(); i < size && res > 0; ++i)
         {
+            if (m_pollFds[i].fd == m_wakeFd)
+            {
+                uint64_t value;
+                if ((m_pollFds[i].revents & POLLIN) && read(m_wakeFd, &value, sizeof(value)) > 0)
+                {
+                    -- res;
+                }
+                continue;
+            }
             if (m_pollFds[i].revents & (POLLHUP | POLLERR))
             {
                 LOG_ERROR(m_logger, "FD %d is bad. Errno: %d(%s)",
@@ -163,6 +237,7 @@ void EventLoop::func()
             }
         }
     }
+    runTasks();
     LOG_INFO(m_logger, "Event loop stopped");
 }
 
@@ -18,6 +18,8 @@ struct Configuration
     uint32_t m_userOffset = 0;
     uint32_t m_dealsPerUser = 10;
     uint32_t m_transactionSize = 100;
+    // text, binary or json
+    std::string m_format = "text";
 
     Result read(const libconfig::Config& cfg, logger::CategoryPtr& log);
 };
@@ -46,14 +48,25 @@ inline Result Configuration::read(const libconfig::Config& cfg, logger::Category
         {
             LOG_WARN(log, "Canont find 'transaction-size' parameter in configuration. Default value will be used");
         }
+        if (!setting.lookupValue("format", m_format))
+        {
+            LOG_WARN(log, "Canont find 'format' parameter in configuration. Default value will be used");
+        }
     }
     catch (const SettingNotFoundException& e)
     {
         LOG_WARN(log, "Canont find section 'tg' in configuration. Default values will be used");
     }
 
-    LOG_INFO(log, "Traffic generator configuration: <users-count: %u, user-offset: %u, deals-per-user: %u, transaction-size: %u>",
-        m_usersCount, m_userOffset, m_dealsPerUser, m_transactionSize);
+    if (m_format != "text" && m_format != "binary" && m_format != "json")
+    {
+        LOG_ERROR(log, "'format'[%s] parameter is invalid, text, binary or json is expected", m_format.c_str());
+        return Result::CFG_INVALID;
+    }
+
+    LOG_INFO(log, "Traffic generator configuration: <users-count: %u, user-offset: %u, deals-per-user: %u, transaction-size: %u, "
+        "format: %s>",
+        m_usersCount, m_userOffset, m_dealsPerUser, m_transactionSize, m_format.c_str());
 
     return Result::SUCCESS;
 }
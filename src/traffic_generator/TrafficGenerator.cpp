@@ -1,7 +1,11 @@
+#include <chrono>
 #include <random>
 
 #include <logger/LoggerDefines.h>
 #include <rabbitmq/Publisher.h>
+#include <rabbitmq/ProcessingItem.h>
+#include <app/BinaryProtocol.h>
+#include <app/JsonProtocol.h>
 #include <external/fantasyname/namegen.h>
 
 #include "TrafficGenerator.h"
@@ -104,8 +108,68 @@ void Generator::doDeinitialize()
     return ;
 }
 
+bool Generator::publishCommand(const app::Command& cmd, std::string& buf)
+{
+    buf.clear();
+    if (m_cfg.m_format == "binary")
+    {
+        if (Result::SUCCESS != app::binary::encode(buf, cmd))
+        {
+            return false;
+        }
+        return publishMessage(buf, rabbitmq::binaryContentType);
+    }
+    if (m_cfg.m_format == "json")
+    {
+        if (Result::SUCCESS != app::json::encode(buf, cmd))
+        {
+            return false;
+        }
+        return publishMessage(buf, rabbitmq::jsonContentType);
+    }
+
+    buf += app::commandTypeToStr(cmd.m_type);
+    buf += "(";
+    buf += std::to_string(cmd.m_id);
+    switch (cmd.m_type)
+    {
+        case app::CommandType::USER_REGISTERED:
+        case app::CommandType::USER_RENAMED:
+            buf += ",";
+            buf.append(cmd.m_name.data(), cmd.m_name.size());
+            break;
+        case app::CommandType::USER_DEAL:
+        case app::CommandType::USER_DEAL_WON:
+            buf += ",";
+            buf += common::timeToString(cmd.m_time);
+            buf += ",";
+            buf += std::to_string(cmd.m_amount);
+            break;
+        default:
+            break;
+    }
+    buf += ")";
+    return publishMessage(buf, nullptr);
+}
+
+bool Generator::publishMessage(const std::string& buf, const char* const contentType)
+{
+    // ids are unique across runs, so the application drops only redeliveries and replays of this run
+    const std::string messageId = m_runId + "-" + std::to_string(m_messagesCount++);
+    AMQP::Envelope envelope(buf.data(), buf.size());
+    envelope.setMessageID(messageId);
+    if (contentType)
+    {
+        envelope.setContentType(contentType);
+    }
+    return m_publisher->publish(m_publisherCfg.m_exchangeName, m_publisherCfg.m_routingKey, envelope);
+}
+
 Result Generator::writeData()
 {
+    m_runId = std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    m_messagesCount = 0;
     NameGen::Generator namesGenerator("ssM ssM");
     std::default_random_engine generator;
     std::uniform_int_distribution<uint16_t> distribution(
@@ -125,33 +189,40 @@ Result Generator::writeData()
         }
     } while (res != Result::SUCCESS);
 
+    std::string buf;
     for (size_t i = 0; i < m_cfg.m_usersCount; ++i)
     {
-        std::string idStr = std::to_string(m_cfg.m_userOffset + i);
-        if (!m_publisher->publish(m_publisherCfg.m_exchangeName, m_publisherCfg.m_routingKey,
-            "user_registered(" + idStr + "," + namesGenerator.toString() + ")"))
+        app::Command cmd;
+        cmd.m_id = m_cfg.m_userOffset + i;
+
+        const std::string name = namesGenerator.toString();
+        cmd.m_type = app::CommandType::USER_REGISTERED;
+        cmd.m_name = common::StringView(name);
+        if (!publishCommand(cmd, buf))
         {
             LOG_ERROR(m_logger, "Cannot publish message");
             continue;
         }
-        time_t t = time(nullptr);
+        cmd.m_time = time(nullptr);
         for (size_t deal = 0; deal < m_cfg.m_dealsPerUser; ++ deal)
         {
-            if (!m_publisher->publish(m_publisherCfg.m_exchangeName, m_publisherCfg.m_routingKey,
-                "user_deal(" + idStr + "," + common::timeToString(t) + "," + std::to_string(distribution(generator)) + ")"))
+            cmd.m_type = app::CommandType::USER_DEAL;
+            cmd.m_amount = distribution(generator);
+            if (!publishCommand(cmd, buf))
             {
                 LOG_ERROR(m_logger, "Cannot publish message");
                 continue;
             }
-            if (!m_publisher->publish(m_publisherCfg.m_exchangeName, m_publisherCfg.m_routingKey,
-                "user_deal_won(" + idStr + "," + common::timeToString(t) + "," + std::to_string(distribution(generator)) + ")"))
+            cmd.m_type = app::CommandType::USER_DEAL_WON;
+            cmd.m_amount = distribution(generator);
+            if (!publishCommand(cmd, buf))
             {
                 LOG_ERROR(m_logger, "Cannot publish message");
                 continue;
             }
         }
-        if (!m_publisher->publish(m_publisherCfg.m_exchangeName, m_publisherCfg.m_routingKey,
-            "user_connected(" + idStr + ")"))
+        cmd.m_type = app::CommandType::USER_CONNECTED;
+        if (!publishCommand(cmd, buf))
         {
             LOG_ERROR(m_logger, "Cannot publish message");
             continue;
@@ -159,8 +230,8 @@ Result Generator::writeData()
 
         if (rand() % 5 != 0)
         {
-            if (!m_publisher->publish(m_publisherCfg.m_exchangeName, m_publisherCfg.m_routingKey,
-                "user_disconnected(" + idStr + ")"))
+            cmd.m_type = app::CommandType::USER_DISCONNECTED;
+            if (!publishCommand(cmd, buf))
             {
                 LOG_ERROR(m_logger, "Cannot publish message");
                 continue;
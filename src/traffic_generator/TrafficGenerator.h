@@ -10,6 +10,7 @@
 #include <common/Types.h>
 #include <app/ApplicationBase.h>
 #include <app/Configuration.h>
+#include <app/Command.h>
 #include "Configuration.h"
 
 namespace tg
@@ -24,6 +25,9 @@ private:
 
     rabbitmq::PublisherPtr m_publisher;
     app::RmqHandlerCfg m_publisherCfg;
+    // every message has the "<run id>-<sequence>" message id, the run id is the start time
+    std::string m_runId;
+    uint64_t m_messagesCount = 0;
 
 private:
     Generator();
@@ -34,6 +38,11 @@ private:
     virtual void doStop() override;
     virtual void doDeinitialize() override;
 
+    // publishes the command in the configured format, buffer is reused between calls
+    bool publishCommand(const app::Command& cmd, std::string& buf);
+    // text messages have no content type (nullptr)
+    bool publishMessage(const std::string& buf, const char* const contentType);
+
 public:
     ~Generator();
     Generator(const Generator&) = delete;
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include <app/Autoscaler.h>
+
+TEST(Autoscaler, ScaleUp)
+{
+    // 2..8 workers, 10 messages per worker, 100 us
+    app::Autoscaler autoscaler(2, 8, 10, 100, 3);
+
+    ASSERT_EQ(autoscaler.update(2, 20, 50), 2);
+    // backlog
+    ASSERT_EQ(autoscaler.update(2, 21, 50), 3);
+    // latency
+    ASSERT_EQ(autoscaler.update(3, 0, 101), 4);
+    ASSERT_EQ(autoscaler.update(4, 1000, 50), 6);
+    ASSERT_EQ(autoscaler.update(6, 1000, 50), 8);
+    ASSERT_EQ(autoscaler.update(8, 1000, 50), 8);
+    // out of bounds
+    ASSERT_EQ(autoscaler.update(20, 0, 60), 8);
+    ASSERT_EQ(autoscaler.update(0, 0, 60), 2);
+}
+
+TEST(Autoscaler, ScaleDown)
+{
+    app::Autoscaler autoscaler(2, 8, 10, 100, 3);
+
+    ASSERT_EQ(autoscaler.update(4, 0, 10), 4);
+    ASSERT_EQ(autoscaler.update(4, 0, 10), 4);
+    // the low load is interrupted
+    ASSERT_EQ(autoscaler.update(4, 0, 60), 4);
+    ASSERT_EQ(autoscaler.update(4, 0, 10), 4);
+    ASSERT_EQ(autoscaler.update(4, 0, 10), 4);
+    ASSERT_EQ(autoscaler.update(4, 14, 10), 3);
+    for (int i = 0; i < 10; ++ i)
+    {
+        autoscaler.update(2, 0, 0);
+    }
+    ASSERT_EQ(autoscaler.update(2, 0, 0), 2);
+}
\ No newline at end of file
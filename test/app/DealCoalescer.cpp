@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <app/DealCoalescer.h>
+
+namespace
+{
+typedef app::DealCoalescer<int> Coalescer;
+// <id, time> to <amount, tokens>
+typedef std::map<std::tuple<int64_t, std::time_t>, std::tuple<int64_t, std::vector<int> > > Deals;
+
+Deals flush(Coalescer& coalescer)
+{
+    Deals deals;
+    coalescer.flush([&deals] (const int64_t id, const std::time_t t, const int64_t amount, std::vector<int>&& tokens) -> void
+        {
+            deals[std::make_tuple(id, t)] = std::make_tuple(amount, tokens);
+        });
+    return deals;
+}
+} // namespace
+
+TEST(DealCoalescer, Merge)
+{
+    Coalescer coalescer(60, std::chrono::seconds(10), 100);
+    ASSERT_TRUE(coalescer.empty());
+
+    coalescer.add(1, 120, 10, 1);
+    coalescer.add(1, 179, 20, 2);
+    coalescer.add(1, 180, 30, 3);
+    coalescer.add(2, 150, 40, 4);
+    coalescer.add(2, -1, 50, 5);
+    ASSERT_FALSE(coalescer.empty());
+
+    Deals deals = flush(coalescer);
+    ASSERT_TRUE(coalescer.empty());
+    ASSERT_EQ(deals.size(), 4);
+    ASSERT_EQ(deals[std::make_tuple(1, 120)], std::make_tuple(30, std::vector<int>({1, 2})));
+    ASSERT_EQ(deals[std::make_tuple(1, 180)], std::make_tuple(30, std::vector<int>({3})));
+    ASSERT_EQ(deals[std::make_tuple(2, 120)], std::make_tuple(40, std::vector<int>({4})));
+    ASSERT_EQ(deals[std::make_tuple(2, -60)], std::make_tuple(50, std::vector<int>({5})));
+    ASSERT_TRUE(flush(coalescer).empty());
+}
+
+TEST(DealCoalescer, Ready)
+{
+    const Coalescer::Clock::time_point now = Coalescer::Clock::now();
+
+    Coalescer coalescer(1, std::chrono::seconds(10), 3);
+    ASSERT_FALSE(coalescer.isReady(now));
+    coalescer.add(1, 1, 1, 1);
+    coalescer.add(1, 1, 1, 2);
+    ASSERT_FALSE(coalescer.isReady(now));
+    ASSERT_TRUE(coalescer.isReady(now + std::chrono::seconds(11)));
+    // deals are counted before merging
+    coalescer.add(1, 1, 1, 3);
+    ASSERT_TRUE(coalescer.isReady(now));
+    flush(coalescer);
+    ASSERT_FALSE(coalescer.isReady(now + std::chrono::seconds(11)));
+}
\ No newline at end of file
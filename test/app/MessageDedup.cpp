@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include <app/MessageDedup.h>
+
+using Verdict = app::MessageDedup::Verdict;
+
+namespace
+{
+rabbitmq::ProcessingItemPtr itemOf(rabbitmq::ProcessingItemPool& pool, const std::string& id, const uint64_t deliveryTag)
+{
+    rabbitmq::ProcessingItemPtr item = pool.acquire();
+    item->m_messageId = id;
+    item->m_deliveryTag = deliveryTag;
+    return item;
+}
+} // namespace
+
+TEST(MessageDedup, Duplicates)
+{
+    rabbitmq::ProcessingItemPool pool(16);
+    app::MessageDedup dedup(1000, std::chrono::seconds(60));
+    std::vector<rabbitmq::ProcessingItemPtr> duplicates;
+
+    rabbitmq::ProcessingItemPtr first = itemOf(pool, "1", 1);
+    rabbitmq::ProcessingItemPtr second = itemOf(pool, "2", 2);
+    ASSERT_EQ(Verdict::PROCESS, dedup.start(first));
+    ASSERT_EQ(Verdict::PROCESS, dedup.start(second));
+    dedup.finish("1", true, duplicates);
+    ASSERT_TRUE(duplicates.empty());
+    dedup.finish("2", true, duplicates);
+    ASSERT_TRUE(duplicates.empty());
+
+    rabbitmq::ProcessingItemPtr replay = itemOf(pool, "1", 3);
+    ASSERT_EQ(Verdict::DUPLICATE, dedup.start(replay));
+    // the item of the dropped duplicate is settled by the caller
+    ASSERT_TRUE(replay);
+    replay = itemOf(pool, "2", 4);
+    ASSERT_EQ(Verdict::DUPLICATE, dedup.start(replay));
+    replay = itemOf(pool, "3", 5);
+    ASSERT_EQ(Verdict::PROCESS, dedup.start(replay));
+}
+
+TEST(MessageDedup, RedeliveredWhilePending)
+{
+    // the channel is reconnected while the writes of the message are pending,
+    // so the broker delivers it again before the original delivery is settled
+    rabbitmq::ProcessingItemPool pool(16);
+    app::MessageDedup dedup(1000, std::chrono::seconds(60));
+    std::vector<rabbitmq::ProcessingItemPtr> duplicates;
+
+    rabbitmq::ProcessingItemPtr original = itemOf(pool, "deal", 1);
+    ASSERT_EQ(Verdict::PROCESS, dedup.start(original));
+    // redeliveries are held while the original writes are in flight, they are neither acked nor requeued,
+    // so the broker does not deliver them again: there is one redelivery per reconnect
+    for (uint64_t tag = 2; tag <= 3; ++ tag)
+    {
+        rabbitmq::ProcessingItemPtr redelivered = itemOf(pool, "deal", tag);
+        ASSERT_EQ(Verdict::IN_FLIGHT, dedup.start(redelivered));
+        ASSERT_FALSE(redelivered);
+    }
+
+    // the writes fail, so the held redeliveries are returned to be requeued and the next one stores the deal
+    dedup.finish("deal", false, duplicates);
+    ASSERT_EQ(duplicates.size(), 2u);
+    ASSERT_EQ(duplicates[0]->m_deliveryTag, 2u);
+    ASSERT_EQ(duplicates[1]->m_deliveryTag, 3u);
+    duplicates.clear();
+
+    rabbitmq::ProcessingItemPtr retry = itemOf(pool, "deal", 4);
+    ASSERT_EQ(Verdict::PROCESS, dedup.start(retry));
+    rabbitmq::ProcessingItemPtr redelivered = itemOf(pool, "deal", 5);
+    ASSERT_EQ(Verdict::IN_FLIGHT, dedup.start(redelivered));
+
+    // the writes succeed, so the held redelivery is returned to be acked and the replays are dropped
+    dedup.finish("deal", true, duplicates);
+    ASSERT_EQ(duplicates.size(), 1u);
+    ASSERT_EQ(duplicates[0]->m_deliveryTag, 5u);
+    duplicates.clear();
+
+    rabbitmq::ProcessingItemPtr replay = itemOf(pool, "deal", 6);
+    ASSERT_EQ(Verdict::DUPLICATE, dedup.start(replay));
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <common/Utils.h>
 #include <app/MessageParser.h>
+#include <app/BinaryProtocol.h>
+#include <app/JsonProtocol.h>
 #include <rabbitmq/ProcessingItem.h>
 
 #include "../fixtures/LoggerFixture.h"
@@ -15,7 +17,7 @@ TEST_F(MessageParserFixture, ParserNoCallbacks)
 {
     app::MessageParser parser;
 
-    rabbitmq::ProcessingItem item(nullptr, "", "", "", 0, false);
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
 
     std::vector<std::pair<std::string, Result> > commands = 
     {
@@ -136,7 +138,7 @@ TEST_F(MessageParserFixture, BadMessages)
     MessageParserCallbacks callbacks;
     parser.registerCallbackObject(callbacks);
 
-    rabbitmq::ProcessingItem item(nullptr, "", "", "", 0, false);
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
 
     std::vector<std::pair<std::string, Result> > commands =
     {
@@ -181,7 +183,7 @@ TEST_F(MessageParserFixture, ParserBadResult)
     MessageParserCallbacks callbacks;
     parser.registerCallbackObject(callbacks);
 
-    rabbitmq::ProcessingItem item(nullptr, "", "", "", 0, false);
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
 
     Result res = Result::DB_ERROR;
     std::vector<std::pair<std::string, Result> > commands = 
@@ -209,7 +211,7 @@ TEST_F(MessageParserFixture, ParserGoodResult)
     MessageParserCallbacks callbacks;
     parser.registerCallbackObject(callbacks);
 
-    rabbitmq::ProcessingItem item(nullptr, "", "", "", 0, false);
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
 
     callbacks.setResult(Result::SUCCESS);
     item.m_message = "user_registered(1,Arr)";
@@ -251,4 +253,330 @@ TEST_F(MessageParserFixture, ParserGoodResult)
     ASSERT_TRUE(callbacks.isCalled());
     ASSERT_EQ(callbacks.id(), 1);
     callbacks.reset();
+}
+
+TEST_F(MessageParserFixture, IntegerArguments)
+{
+    app::MessageParser parser;
+    MessageParserCallbacks callbacks;
+    parser.registerCallbackObject(callbacks);
+
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
+
+    std::vector<std::pair<std::string, int64_t> > goodCommands =
+    {
+        { "user_connected(0)", 0 },
+        { "user_connected(-5)", -5 },
+        { "user_connected(9223372036854775807)", INT64_MAX },
+        { "user_connected(-9223372036854775808)", INT64_MIN },
+    };
+    for (auto&& cmd : goodCommands)
+    {
+        callbacks.reset();
+        item.m_message = cmd.first;
+        ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+        ASSERT_TRUE(callbacks.isCalled());
+        ASSERT_EQ(cmd.second, callbacks.id());
+    }
+
+    std::vector<std::string> badCommands =
+    {
+        "user_connected(-)",
+        "user_connected(1a)",
+        "user_connected(9223372036854775808)",
+        "user_connected(123456789012345678901234)",
+        "user_deal(1,2017-05-20T10:10:10,100,1)",
+    };
+    for (auto&& cmd : badCommands)
+    {
+        callbacks.reset();
+        item.m_message = cmd;
+        ASSERT_EQ(Result::INVALID_FORMAT, parser.parseMessage(std::move(item)));
+        ASSERT_FALSE(callbacks.isCalled());
+    }
+}
+
+TEST_F(MessageParserFixture, BinaryMessages)
+{
+    app::MessageParser parser;
+    MessageParserCallbacks callbacks;
+    parser.registerCallbackObject(callbacks);
+
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
+    item.m_contentType = rabbitmq::ProcessingItem::ContentType::BINARY;
+
+    app::Command cmd;
+    cmd.m_type = app::CommandType::USER_REGISTERED;
+    cmd.m_id = 666;
+    cmd.m_name = common::StringView("Arr");
+    item.m_message.clear();
+    ASSERT_EQ(Result::SUCCESS, app::binary::encode(item.m_message, cmd));
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), 666);
+    ASSERT_EQ(callbacks.name(), "Arr");
+    callbacks.reset();
+
+    cmd.m_type = app::CommandType::USER_DEAL_WON;
+    cmd.m_time = 1150000000;
+    cmd.m_amount = -9;
+    item.m_message.clear();
+    ASSERT_EQ(Result::SUCCESS, app::binary::encode(item.m_message, cmd));
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), 666);
+    ASSERT_EQ(callbacks.time(), 1150000000);
+    ASSERT_EQ(callbacks.amount(), -9);
+    callbacks.reset();
+
+    cmd.m_type = app::CommandType::USER_DISCONNECTED;
+    item.m_message.clear();
+    ASSERT_EQ(Result::SUCCESS, app::binary::encode(item.m_message, cmd));
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), 666);
+    callbacks.reset();
+
+    // truncated and extended messages
+    cmd.m_type = app::CommandType::USER_DEAL;
+    std::string encoded;
+    ASSERT_EQ(Result::SUCCESS, app::binary::encode(encoded, cmd));
+    item.m_message = encoded.substr(0, encoded.size() - 1);
+    ASSERT_EQ(Result::INVALID_FORMAT, parser.parseMessage(std::move(item)));
+    item.m_message = encoded + '\0';
+    ASSERT_EQ(Result::INVALID_FORMAT, parser.parseMessage(std::move(item)));
+    item.m_message = std::string(1, '\x7f') + encoded.substr(1);
+    ASSERT_EQ(Result::CMD_NOT_SUPPORTED, parser.parseMessage(std::move(item)));
+    ASSERT_FALSE(callbacks.isCalled());
+
+    // commands that cannot be encoded do not leave partial bytes in the buffer
+    cmd.m_type = app::CommandType::USER_RENAMED;
+    cmd.m_name = common::StringView("");
+    ASSERT_EQ(Result::INVALID_FORMAT, app::binary::encode(encoded, cmd));
+    cmd.m_type = app::CommandType::UNKNOWN;
+    ASSERT_EQ(Result::CMD_NOT_SUPPORTED, app::binary::encode(encoded, cmd));
+    item.m_message = encoded;
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+}
+
+TEST_F(MessageParserFixture, MultiCommandMessages)
+{
+    app::MessageParser parser;
+    std::vector<int64_t> ids;
+    parser.registerOnUserConnectedCallback([&ids] (const int64_t id) -> Result
+        {
+            ids.push_back(id);
+            return (id < 0) ? Result::FAILED : Result::SUCCESS;
+        });
+
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
+
+    // lines are longer than the scanner blocks
+    std::string message;
+    for (int64_t id = 1000000000000; id < 1000000000100; ++ id)
+    {
+        message += "user_connected(" + std::to_string(id) + ")\n";
+    }
+    item.m_message = message;
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_EQ(ids.size(), 100);
+    ASSERT_EQ(ids.front(), 1000000000000);
+    ASSERT_EQ(ids.back(), 1000000000099);
+    ids.clear();
+
+    item.m_message = "user_connected(1)\r\n\r\nuser_connected(2)";
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_EQ(ids, std::vector<int64_t>({1, 2}));
+    ids.clear();
+
+    // all commands are processed, the first failure is returned
+    item.m_message = "user_connected(1)\nuser_connected(x)\nuser_connected(-3)\nuser_deal(1)\nuser_connected(4)";
+    ASSERT_EQ(Result::INVALID_FORMAT, parser.parseMessage(std::move(item)));
+    ASSERT_EQ(ids, std::vector<int64_t>({1, -3, 4}));
+    ids.clear();
+
+    item.m_message = "\n\n";
+    ASSERT_EQ(Result::INVALID_FORMAT, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(ids.empty());
+}
+
+TEST_F(MessageParserFixture, JsonMessages)
+{
+    app::MessageParser parser;
+    MessageParserCallbacks callbacks;
+    parser.registerCallbackObject(callbacks);
+
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
+    item.m_contentType = rabbitmq::ProcessingItem::ContentType::JSON;
+
+    std::time_t t;
+    ASSERT_EQ(Result::SUCCESS, common::timeFromString(t, "2017-05-20T10:10:10"));
+
+    item.m_message = R"({"type":"deal","id":666,"time":"2017-05-20T10:10:10","amount":-9})";
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), 666);
+    ASSERT_EQ(callbacks.time(), t);
+    ASSERT_EQ(callbacks.amount(), -9);
+    callbacks.reset();
+
+    // any order, spaces, unknown keys and epoch seconds
+    item.m_message = " { \"amount\" : 5, \"extra\" : {\"a\":[1, 2.5e3, true, null, \"}\"]}, \"time\" : 1150000000,\n"
+        " \"id\" : 1, \"type\" : \"user_deal_won\" } ";
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), 1);
+    ASSERT_EQ(callbacks.time(), 1150000000);
+    ASSERT_EQ(callbacks.amount(), 5);
+    callbacks.reset();
+
+    // escaped name is unescaped in place
+    item.m_message = R"({"type":"registered","id":2,"name":"A\"r\\r\u00e9\ud83d\ude00"})";
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), 2);
+    ASSERT_EQ(callbacks.name(), "A\"r\\r\xc3\xa9\xf0\x9f\x98\x80");
+    callbacks.reset();
+
+    item.m_message = R"({"type":"disconnected","id":3})";
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), 3);
+    callbacks.reset();
+
+    // encoded commands are decoded back
+    app::Command cmd;
+    cmd.m_type = app::CommandType::USER_RENAMED;
+    cmd.m_id = -4;
+    cmd.m_name = common::StringView("\"B\"\n");
+    item.m_message.clear();
+    ASSERT_EQ(Result::SUCCESS, app::json::encode(item.m_message, cmd));
+    ASSERT_EQ(Result::SUCCESS, parser.parseMessage(std::move(item)));
+    ASSERT_TRUE(callbacks.isCalled());
+    ASSERT_EQ(callbacks.id(), -4);
+    ASSERT_EQ(callbacks.name(), "\"B\"\n");
+    callbacks.reset();
+
+    // commands that cannot be encoded do not leave partial bytes in the buffer
+    std::string encoded;
+    cmd.m_name = common::StringView("");
+    ASSERT_EQ(Result::INVALID_FORMAT, app::json::encode(encoded, cmd));
+    cmd.m_type = app::CommandType::UNKNOWN;
+    ASSERT_EQ(Result::CMD_NOT_SUPPORTED, app::json::encode(encoded, cmd));
+    ASSERT_TRUE(encoded.empty());
+
+    std::vector<std::pair<std::string, Result> > badMessages =
+    {
+        { "", Result::INVALID_FORMAT },
+        { "{}", Result::INVALID_FORMAT },
+        { R"({"type":"connected"})", Result::INVALID_FORMAT },
+        { R"({"type":"connected","id":1)", Result::INVALID_FORMAT },
+        { R"({"type":"connected","id":1}x)", Result::INVALID_FORMAT },
+        { R"({"type":"connected","id":1.5})", Result::INVALID_FORMAT },
+        { R"({"type":"connected","id":"1"})", Result::INVALID_FORMAT },
+        { R"({"type":"deal","id":1,"amount":1})", Result::INVALID_FORMAT },
+        { R"({"type":"deal","id":1,"time":"2017-05-20","amount":1})", Result::INVALID_FORMAT },
+        { R"({"type":"registered","id":1,"name":""})", Result::INVALID_FORMAT },
+        { R"({"type":"registered","id":1,"name":"\ude00"})", Result::INVALID_FORMAT },
+        { R"({"type":"registered","id":1,"name":"\q"})", Result::INVALID_FORMAT },
+        { R"({"type":"connected","id":1,"x":[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]})",
+            Result::INVALID_FORMAT },
+        { R"({"type":"unknown","id":1})", Result::CMD_NOT_SUPPORTED },
+    };
+    for (auto&& message : badMessages)
+    {
+        item.m_message = message.first;
+        ASSERT_EQ(message.second, parser.parseMessage(std::move(item))) << message.first;
+        ASSERT_FALSE(callbacks.isCalled());
+    }
+}
+
+TEST_F(MessageParserFixture, PeekUserId)
+{
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
+    int64_t id = 0;
+
+    item.m_message = "user_deal(-42,2017-05-20T10:10:10,100)\nuser_connected(-42)";
+    ASSERT_EQ(Result::SUCCESS, app::MessageParserBase::peekUserId(item, id));
+    ASSERT_EQ(id, -42);
+    item.m_message = "user_connected\nuser_connected(5)";
+    ASSERT_EQ(Result::SUCCESS, app::MessageParserBase::peekUserId(item, id));
+    ASSERT_EQ(id, 5);
+    item.m_message = "user_connected";
+    ASSERT_EQ(Result::INVALID_FORMAT, app::MessageParserBase::peekUserId(item, id));
+    // commands of other users would be processed out of order
+    item.m_message = "user_deal(1,2017-05-20T10:10:10,100)\nuser_connected(2)";
+    ASSERT_EQ(Result::CMD_NOT_SUPPORTED, app::MessageParserBase::peekUserId(item, id));
+
+    item.m_contentType = rabbitmq::ProcessingItem::ContentType::JSON;
+    item.m_message = R"({"type":"registered", "name":"id", "id" : 7})";
+    ASSERT_EQ(Result::SUCCESS, app::MessageParserBase::peekUserId(item, id));
+    ASSERT_EQ(id, 7);
+    // keys in strings and nested objects are not matched
+    item.m_message = R"({"type":"registered", "name":"\"id\": 13,", "meta":{"id":14}, "id":8})";
+    ASSERT_EQ(Result::SUCCESS, app::MessageParserBase::peekUserId(item, id));
+    ASSERT_EQ(id, 8);
+    item.m_message = R"({"\u0069d":10, "type":"connected"})";
+    ASSERT_EQ(Result::SUCCESS, app::MessageParserBase::peekUserId(item, id));
+    ASSERT_EQ(id, 10);
+    item.m_message = R"({"id":9, "type":"connected"})";
+    ASSERT_EQ(Result::SUCCESS, app::MessageParserBase::peekUserId(item, id));
+    ASSERT_EQ(id, 9);
+    item.m_message = R"({"type":"registered", "name":"\"id\":13"})";
+    ASSERT_EQ(Result::INVALID_FORMAT, app::MessageParserBase::peekUserId(item, id));
+    item.m_message = R"({"type":"registered"})";
+    ASSERT_EQ(Result::INVALID_FORMAT, app::MessageParserBase::peekUserId(item, id));
+    // the body is not modified
+    ASSERT_EQ(item.m_message, R"({"type":"registered"})");
+
+    item.m_contentType = rabbitmq::ProcessingItem::ContentType::BINARY;
+    app::Command cmd;
+    cmd.m_type = app::CommandType::USER_CONNECTED;
+    cmd.m_id = 666;
+    item.m_message.clear();
+    ASSERT_EQ(Result::SUCCESS, app::binary::encode(item.m_message, cmd));
+    ASSERT_EQ(Result::SUCCESS, app::MessageParserBase::peekUserId(item, id));
+    ASSERT_EQ(id, 666);
+    item.m_message.resize(3);
+    ASSERT_EQ(Result::INVALID_FORMAT, app::MessageParserBase::peekUserId(item, id));
+}
+
+TEST_F(MessageParserFixture, PeekCommandType)
+{
+    rabbitmq::ProcessingItem item(nullptr, "", 0, false);
+
+    item.m_message = "user_connected(1)\nuser_deal(1,2017-05-20T10:10:10,100)";
+    ASSERT_EQ(app::CommandType::USER_CONNECTED, app::MessageParserBase::peekCommandType(item));
+    item.m_message = "user_deal_won(1,2017-05-20T10:10:10,100)";
+    ASSERT_EQ(app::CommandType::USER_DEAL_WON, app::MessageParserBase::peekCommandType(item));
+    item.m_message = "user_connected";
+    ASSERT_EQ(app::CommandType::UNKNOWN, app::MessageParserBase::peekCommandType(item));
+    // control commands of a batch are not queued behind the deals
+    item.m_message = "user_deal(1,2017-05-20T10:10:10,100)\nuser_registered(1,name)";
+    ASSERT_EQ(app::CommandType::USER_REGISTERED, app::MessageParserBase::peekCommandType(item));
+    item.m_message = "\r\n\nuser_deal(1,2017-05-20T10:10:10,100)\nuser_deal_won(1,2017-05-20T10:10:10,100)";
+    ASSERT_EQ(app::CommandType::USER_DEAL, app::MessageParserBase::peekCommandType(item));
+    // short names are supported by JSON only
+    item.m_message = "connected(1)";
+    ASSERT_EQ(app::CommandType::UNKNOWN, app::MessageParserBase::peekCommandType(item));
+
+    item.m_contentType = rabbitmq::ProcessingItem::ContentType::JSON;
+    item.m_message = R"({"id":7, "type" : "user_registered", "name":"type"})";
+    ASSERT_EQ(app::CommandType::USER_REGISTERED, app::MessageParserBase::peekCommandType(item));
+    item.m_message = R"({"name":"type", "type":"deal"})";
+    ASSERT_EQ(app::CommandType::USER_DEAL, app::MessageParserBase::peekCommandType(item));
+    item.m_message = R"({"type":7})";
+    ASSERT_EQ(app::CommandType::UNKNOWN, app::MessageParserBase::peekCommandType(item));
+
+    item.m_contentType = rabbitmq::ProcessingItem::ContentType::BINARY;
+    app::Command cmd;
+    cmd.m_type = app::CommandType::USER_DISCONNECTED;
+    cmd.m_id = 666;
+    item.m_message.clear();
+    ASSERT_EQ(Result::SUCCESS, app::binary::encode(item.m_message, cmd));
+    ASSERT_EQ(app::CommandType::USER_DISCONNECTED, app::MessageParserBase::peekCommandType(item));
+    item.m_message.assign(1, static_cast<char>(app::commandTypesCount));
+    ASSERT_EQ(app::CommandType::UNKNOWN, app::MessageParserBase::peekCommandType(item));
+    item.m_message.clear();
+    ASSERT_EQ(app::CommandType::UNKNOWN, app::MessageParserBase::peekCommandType(item));
 }
\ No newline at end of file
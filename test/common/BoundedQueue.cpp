@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <common/BoundedQueue.h>
+
+TEST(BoundedQueue, SingleThread)
+{
+    common::BoundedQueue<std::unique_ptr<int> > queue(3);
+    ASSERT_EQ(queue.capacity(), 4);
+    ASSERT_TRUE(queue.empty());
+
+    for (int i = 0; i < 4; ++ i)
+    {
+        std::unique_ptr<int> value(new int(i));
+        ASSERT_TRUE(queue.tryPush(std::move(value)));
+    }
+    std::unique_ptr<int> value(new int(4));
+    ASSERT_FALSE(queue.tryPush(std::move(value)));
+    // value is not moved if the queue is full
+    ASSERT_TRUE(value);
+
+    for (int i = 0; i < 4; ++ i)
+    {
+        ASSERT_TRUE(queue.tryPop(value));
+        ASSERT_EQ(*value, i);
+    }
+    ASSERT_FALSE(queue.tryPop(value));
+    ASSERT_TRUE(queue.empty());
+
+    // values which are not popped are destroyed with the queue
+    ASSERT_TRUE(queue.tryPush(std::move(value)));
+}
+
+TEST(BoundedQueue, ManyProducers)
+{
+    static constexpr int64_t producersCount = 4;
+    static constexpr int64_t valuesCount = 100000;
+
+    common::BoundedQueue<int64_t> queue(64);
+
+    std::vector<std::thread> producers;
+    for (int64_t p = 0; p < producersCount; ++ p)
+    {
+        producers.emplace_back([&queue, p] ()
+            {
+                for (int64_t i = 0; i < valuesCount; ++ i)
+                {
+                    int64_t value = p * valuesCount + i;
+                    while (!queue.tryPush(std::move(value)))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+    }
+
+    // values of every producer are popped in order
+    std::vector<int64_t> lastValues(producersCount, -1);
+    int64_t sum = 0;
+    for (int64_t count = 0; count < producersCount * valuesCount; ++ count)
+    {
+        int64_t value = 0;
+        while (!queue.tryPop(value))
+        {
+            std::this_thread::yield();
+        }
+
+        const int64_t producer = value / valuesCount;
+        ASSERT_LT(lastValues[producer], value);
+        lastValues[producer] = value;
+        sum += value;
+    }
+
+    for (auto&& producer : producers)
+    {
+        producer.join();
+    }
+    const int64_t total = producersCount * valuesCount;
+    ASSERT_EQ(sum, total * (total - 1) / 2);
+    ASSERT_TRUE(queue.empty());
+}
\ No newline at end of file
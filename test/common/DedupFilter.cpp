@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <common/DedupFilter.h>
+
+using common::DedupFilter;
+
+TEST(DedupFilter, Duplicates)
+{
+    // ids are spread over buckets unevenly, so the capacity exceeds the count of ids
+    DedupFilter filter(4000, std::chrono::seconds(60));
+    ASSERT_GE(filter.capacity(), 4000);
+
+    const DedupFilter::Clock::time_point now = DedupFilter::Clock::now();
+    for (int32_t i = 0; i < 500; ++ i)
+    {
+        ASSERT_TRUE(filter.insert("message-" + std::to_string(i), now));
+    }
+    for (int32_t i = 0; i < 500; ++ i)
+    {
+        ASSERT_FALSE(filter.insert("message-" + std::to_string(i), now + std::chrono::seconds(1)));
+    }
+    ASSERT_TRUE(filter.insert("message-500", now));
+
+    // contains does not remember the id
+    ASSERT_TRUE(filter.contains("message-1", now));
+    ASSERT_FALSE(filter.contains("message-501", now));
+    ASSERT_FALSE(filter.contains("message-501", now));
+    ASSERT_FALSE(filter.contains("message-1", now + std::chrono::seconds(60)));
+}
+
+TEST(DedupFilter, Ttl)
+{
+    DedupFilter filter(16, std::chrono::seconds(10));
+    const DedupFilter::Clock::time_point now = DedupFilter::Clock::now();
+    ASSERT_TRUE(filter.insert("id", now));
+    ASSERT_FALSE(filter.insert("id", now + std::chrono::seconds(9)));
+    // the duplicate does not extend the ttl
+    ASSERT_TRUE(filter.insert("id", now + std::chrono::seconds(10)));
+    ASSERT_FALSE(filter.insert("id", now + std::chrono::seconds(11)));
+}
+
+TEST(DedupFilter, Capacity)
+{
+    // memory is constant: the oldest ids are evicted when buckets are full
+    DedupFilter filter(64, std::chrono::hours(1));
+    const size_t capacity = filter.capacity();
+    const DedupFilter::Clock::time_point now = DedupFilter::Clock::now();
+    for (int32_t i = 0; i < 10000; ++ i)
+    {
+        ASSERT_TRUE(filter.insert(std::to_string(i), now + std::chrono::milliseconds(i)));
+    }
+    ASSERT_EQ(filter.capacity(), capacity);
+
+    // recent ids are remembered
+    const DedupFilter::Clock::time_point later = now + std::chrono::seconds(20);
+    ASSERT_FALSE(filter.insert(std::to_string(9999), later));
+    size_t forgotten = 0;
+    for (int32_t i = 0; i < 1000; ++ i)
+    {
+        forgotten += filter.insert(std::to_string(i), later) ? 1 : 0;
+    }
+    ASSERT_GT(forgotten, 900);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <common/LatencyHistogram.h>
+
+using common::LatencyHistogram;
+
+TEST(LatencyHistogram, Empty)
+{
+    LatencyHistogram histogram;
+    ASSERT_EQ(histogram.count(), 0);
+    ASSERT_EQ(histogram.max(), 0);
+    ASSERT_EQ(histogram.percentile(0.5), 0);
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+    LatencyHistogram histogram;
+    for (int64_t i = 1; i <= 1000; ++ i)
+    {
+        histogram.record(i * 1000);
+    }
+    ASSERT_EQ(histogram.count(), 1000);
+    ASSERT_EQ(histogram.max(), 1000000);
+
+    // values are rounded up to their buckets, the error is less than 1/16
+    const uint64_t p50 = histogram.percentile(0.5);
+    ASSERT_GE(p50, 500000);
+    ASSERT_LE(p50, 500000 + 500000 / 16);
+    const uint64_t p99 = histogram.percentile(0.99);
+    ASSERT_GE(p99, 990000);
+    ASSERT_LE(p99, 1000000);
+    ASSERT_EQ(histogram.percentile(1), 1000000);
+
+    // small values are exact, negative ones are 0
+    LatencyHistogram small;
+    small.record(-5);
+    small.record(3);
+    small.record(15);
+    ASSERT_EQ(small.percentile(0), 0);
+    ASSERT_EQ(small.percentile(0.5), 3);
+    ASSERT_EQ(small.percentile(1), 15);
+}
+
+TEST(LatencyHistogram, MoveTo)
+{
+    LatencyHistogram first;
+    LatencyHistogram second;
+    LatencyHistogram total;
+    first.record(10);
+    first.record(20);
+    second.record(INT64_MAX);
+
+    first.moveTo(total);
+    second.moveTo(total);
+    ASSERT_EQ(first.count(), 0);
+    ASSERT_EQ(first.max(), 0);
+    ASSERT_EQ(first.percentile(0.5), 0);
+    ASSERT_EQ(total.count(), 3);
+    ASSERT_EQ(total.max(), INT64_MAX);
+    ASSERT_EQ(total.percentile(0.5), 20);
+    ASSERT_EQ(total.percentile(1), INT64_MAX);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <common/ObjectPool.h>
+
+namespace
+{
+struct Buffer
+{
+    std::string m_data;
+
+    void reset()
+    {
+        m_data.clear();
+    }
+};
+} // namespace
+
+TEST(ObjectPool, Reuse)
+{
+    common::ObjectPool<Buffer> pool(2, [] () -> Buffer*
+        {
+            Buffer* buffer = new Buffer();
+            buffer->m_data.reserve(100);
+            return buffer;
+        });
+
+    Buffer* raw = nullptr;
+    {
+        common::ObjectPool<Buffer>::Ptr buffer = pool.acquire();
+        ASSERT_GE(buffer->m_data.capacity(), 100);
+        buffer->m_data.assign(50, 'x');
+        raw = buffer.get();
+    }
+
+    // released objects are reset and keep their buffers
+    std::vector<common::ObjectPool<Buffer>::Ptr> buffers;
+    bool isReused = false;
+    for (int i = 0; i < 2; ++ i)
+    {
+        buffers.push_back(pool.acquire());
+        isReused = isReused || raw == buffers.back().get();
+        ASSERT_TRUE(buffers.back()->m_data.empty());
+        ASSERT_GE(buffers.back()->m_data.capacity(), 100);
+    }
+    ASSERT_TRUE(isReused);
+
+    // exhausted pool creates objects, they are destroyed if the pool is full
+    buffers.push_back(pool.acquire());
+    ASSERT_TRUE(buffers.back());
+    buffers.clear();
+
+    common::ObjectPool<Buffer>::Ptr empty;
+    ASSERT_FALSE(empty);
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <common/ThreadPool.h>
+
+using common::ThreadPool;
+
+TEST(ThreadPool, Post)
+{
+    ThreadPool pool;
+    pool.start(4);
+    ASSERT_EQ(pool.workersCount(), 4);
+
+    static constexpr int32_t tasksCount = 10000;
+    std::atomic<int32_t> count{0};
+    std::promise<void> done;
+    for (int32_t i = 0; i < tasksCount; ++ i)
+    {
+        pool.post([&count, &done] () -> void
+            {
+                if (tasksCount == ++ count)
+                {
+                    done.set_value();
+                }
+            });
+    }
+    ASSERT_EQ(std::future_status::ready, done.get_future().wait_for(std::chrono::seconds(10)));
+    pool.stop();
+}
+
+TEST(ThreadPool, Priorities)
+{
+    ThreadPool pool;
+    pool.start(1);
+
+    // the only worker is busy while the tasks are posted
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([released] () -> void
+        {
+            released.wait();
+        });
+
+    std::mutex guard;
+    std::vector<int32_t> order;
+    std::promise<void> done;
+    pool.post([&guard, &order, &done] () -> void
+        {
+            std::unique_lock<std::mutex> l(guard);
+            order.push_back(2);
+            done.set_value();
+        },
+        ThreadPool::Priority::LOW);
+    pool.post([&guard, &order] () -> void
+        {
+            std::unique_lock<std::mutex> l(guard);
+            order.push_back(1);
+        },
+        ThreadPool::Priority::HIGH);
+    release.set_value();
+
+    ASSERT_EQ(std::future_status::ready, done.get_future().wait_for(std::chrono::seconds(10)));
+    ASSERT_EQ(order, std::vector<int32_t>({1, 2}));
+    pool.stop();
+}
+
+TEST(ThreadPool, PostAfter)
+{
+    ThreadPool pool;
+    pool.start(2);
+
+    const ThreadPool::Clock::time_point start = ThreadPool::Clock::now();
+    std::promise<ThreadPool::Clock::time_point> fired;
+    pool.postAfter(std::chrono::milliseconds(50), [&fired] () -> void
+        {
+            fired.set_value(ThreadPool::Clock::now());
+        });
+    std::future<ThreadPool::Clock::time_point> future = fired.get_future();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(10)));
+    ASSERT_GE(future.get() - start, std::chrono::milliseconds(50));
+
+    // delayed tasks are dropped on stop
+    pool.postAfter(std::chrono::hours(1), [] () -> void {});
+    pool.stop();
+}
+
+TEST(ThreadPool, ParallelFor)
+{
+    ThreadPool pool;
+    std::vector<int32_t> values(1000, 0);
+    auto func = [&values] (const size_t i) -> void
+        {
+            values[i] += static_cast<int32_t>(i);
+        };
+
+    // the caller runs all calls if the pool is not started
+    pool.parallelFor(values.size(), func);
+    pool.start(4);
+    pool.parallelFor(values.size(), func);
+    for (size_t i = 0; i < values.size(); ++ i)
+    {
+        ASSERT_EQ(values[i], 2 * static_cast<int32_t>(i));
+    }
+
+    // tasks can wait for their subtasks
+    std::promise<void> done;
+    pool.post([&pool, &values, &func, &done] () -> void
+        {
+            pool.parallelFor(values.size(), func);
+            done.set_value();
+        });
+    ASSERT_EQ(std::future_status::ready, done.get_future().wait_for(std::chrono::seconds(10)));
+    ASSERT_EQ(values.back(), 3 * static_cast<int32_t>(values.size() - 1));
+    pool.stop();
+}
+
+TEST(ThreadPool, ActiveWorkers)
+{
+    ThreadPool pool;
+    pool.start(1, 4);
+    ASSERT_EQ(pool.workersCount(), 4);
+    ASSERT_EQ(pool.activeWorkersCount(), 1);
+
+    // the only active worker is busy, so the task waits for the activation of another one
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([released] () -> void
+        {
+            released.wait();
+        });
+    std::promise<void> done;
+    pool.post([&done] () -> void
+        {
+            done.set_value();
+        });
+    std::future<void> future = done.get_future();
+    ASSERT_EQ(std::future_status::timeout, future.wait_for(std::chrono::milliseconds(100)));
+
+    pool.setActiveWorkersCount(2);
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(10)));
+    release.set_value();
+
+    pool.setActiveWorkersCount(0);
+    ASSERT_EQ(pool.activeWorkersCount(), 1);
+    pool.setActiveWorkersCount(10);
+    ASSERT_EQ(pool.activeWorkersCount(), 4);
+    pool.stop();
+}
+
+TEST(ThreadPool, Spin)
+{
+    ThreadPool pool;
+    pool.setSpinDuration(std::chrono::milliseconds(5));
+    pool.start(2);
+
+    // tasks posted while workers spin and after they sleep are run
+    std::atomic<int32_t> count{0};
+    for (int32_t i = 0; i < 20; ++ i)
+    {
+        std::promise<void> done;
+        pool.post([&count, &done] () -> void
+            {
+                ++ count;
+                done.set_value();
+            });
+        ASSERT_EQ(std::future_status::ready, done.get_future().wait_for(std::chrono::seconds(10)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(i % 2 ? 1 : 10));
+    }
+    ASSERT_EQ(count, 20);
+
+    std::promise<void> fired;
+    pool.postAfter(std::chrono::milliseconds(2), [&fired] () -> void
+        {
+            fired.set_value();
+        });
+    ASSERT_EQ(std::future_status::ready, fired.get_future().wait_for(std::chrono::seconds(10)));
+    pool.stop();
+}
+
+TEST(ThreadPool, PostDuringStop)
+{
+    // tasks posted while the pool is stopped are dropped, the workers are not destroyed under them
+    for (int32_t i = 0; i < 20; ++ i)
+    {
+        ThreadPool pool;
+        pool.start(4);
+        std::atomic<bool> isPosting{true};
+        std::thread poster([&pool, &isPosting] () -> void
+            {
+                while (isPosting)
+                {
+                    pool.post([] () -> void {});
+                }
+            });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pool.stop();
+        isPosting = false;
+        poster.join();
+        ASSERT_EQ(pool.workersCount(), 4);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <common/ThreadTopology.h>
+
+using common::CpuList;
+
+TEST(ThreadTopology, ParseCpuList)
+{
+    CpuList cpus;
+    ASSERT_TRUE(common::parseCpuList("", cpus));
+    ASSERT_TRUE(cpus.empty());
+
+    ASSERT_TRUE(common::parseCpuList("3", cpus));
+    ASSERT_EQ(cpus, CpuList({3}));
+
+    ASSERT_TRUE(common::parseCpuList("0,2-5,7", cpus));
+    ASSERT_EQ(cpus, CpuList({0, 2, 3, 4, 5, 7}));
+
+    ASSERT_FALSE(common::parseCpuList("0,", cpus));
+    ASSERT_FALSE(common::parseCpuList(",0", cpus));
+    ASSERT_FALSE(common::parseCpuList("5-2", cpus));
+    ASSERT_FALSE(common::parseCpuList("1-", cpus));
+    ASSERT_FALSE(common::parseCpuList("a", cpus));
+    ASSERT_FALSE(common::parseCpuList("0 1", cpus));
+    ASSERT_FALSE(common::parseCpuList("100000", cpus));
+}
+
+TEST(ThreadTopology, CpuListToString)
+{
+    ASSERT_EQ(common::cpuListToString(CpuList()), "any");
+    ASSERT_EQ(common::cpuListToString(CpuList({1})), "1");
+    ASSERT_EQ(common::cpuListToString(CpuList({0, 2, 3, 4, 5, 7})), "0,2-5,7");
+
+    CpuList cpus;
+    ASSERT_TRUE(common::parseCpuList(common::cpuListToString(CpuList({0, 1, 3, 4, 6})), cpus));
+    ASSERT_EQ(cpus, CpuList({0, 1, 3, 4, 6}));
+}
+
+TEST(ThreadTopology, ApplyPlacement)
+{
+    std::thread thread([] () -> void
+        {
+            // the first CPU the process may run on
+            const CpuList allowed = common::currentThreadCpus();
+            ASSERT_FALSE(allowed.empty());
+
+            common::ThreadPlacement placement;
+            placement.m_cpus = allowed;
+            placement.m_isSpread = true;
+            ASSERT_TRUE(common::applyThreadPlacement("test-thread-with-long-name", placement, allowed.size()));
+            ASSERT_EQ(common::currentThreadCpus(), CpuList({allowed.front()}));
+        });
+    thread.join();
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <common/TimeParser.h>
+
+using common::Result;
+
+namespace
+{
+std::time_t mktimeFromString(const char* str)
+{
+    struct tm timeStruct = {0};
+    strptime(str, "%Y-%m-%dT%H:%M:%S", &timeStruct);
+    timeStruct.tm_isdst = -1;
+    return mktime(&timeStruct);
+}
+} // namespace
+
+TEST(TimeParser, GoodTimes)
+{
+    std::vector<std::string> strs =
+    {
+        "2017-05-20T10:10:10",
+        "2000-02-29T00:00:00",
+        "1999-12-31T23:59:59",
+        "1970-01-01T00:00:00",
+        "2038-01-19T03:14:07",
+    };
+    // around the current time where the cached offsets are used
+    for (std::time_t t = time(nullptr) - 400 * 24 * 3600; t < time(nullptr) + 400 * 24 * 3600; t += 7 * 24 * 3600 + 3607)
+    {
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", std::localtime(&t));
+        strs.emplace_back(buf);
+    }
+
+    for (auto&& str : strs)
+    {
+        std::time_t t;
+        ASSERT_EQ(Result::SUCCESS, common::isoTimeFromString(t, str.data(), str.size()));
+        ASSERT_EQ(mktimeFromString(str.c_str()), t) << str;
+    }
+}
+
+TEST(TimeParser, BadTimes)
+{
+    std::vector<std::string> strs =
+    {
+        "",
+        "1234",
+        "2017-05-20T10:10",
+        "2017-05-20T10:10:10Z",
+        "2017-05-20 10:10:10",
+        "2017/05/20T10:10:10",
+        "2017-05-20T10-10:10",
+        "2017-05-20T10:10-10",
+        "2017-0a-20T10:10:10",
+        "2017-05-20T10:10:1a",
+        "2017-13-20T10:10:10",
+        "2017-00-20T10:10:10",
+        "2017-05-32T10:10:10",
+        "2017-05-20T24:10:10",
+        "2017-05-20T10:60:10",
+    };
+
+    for (auto&& str : strs)
+    {
+        std::time_t t;
+        ASSERT_EQ(Result::INVALID_FORMAT, common::isoTimeFromString(t, str.data(), str.size())) << str;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <db/AsyncExecutor.h>
+
+using db::AsyncExecutor;
+
+TEST(AsyncExecutor, KeyOrder)
+{
+    AsyncExecutor executor;
+    executor.start(4, 2);
+
+    // tasks of the same key are executed in order by one thread
+    std::vector<std::vector<int32_t> > executed(8);
+    for (int32_t i = 0; i < 1000; ++ i)
+    {
+        const int64_t key = i % 8;
+        ASSERT_TRUE(executor.execute(key, [&executed, key, i] () -> void
+            {
+                executed[key].push_back(i);
+            }));
+    }
+    executor.stop();
+
+    for (int64_t key = 0; key < 8; ++ key)
+    {
+        ASSERT_EQ(executed[key].size(), 125u);
+        for (size_t i = 1; i < executed[key].size(); ++ i)
+        {
+            ASSERT_LT(executed[key][i - 1], executed[key][i]);
+        }
+    }
+}
+
+TEST(AsyncExecutor, RefusedAfterStop)
+{
+    AsyncExecutor executor;
+    ASSERT_FALSE(executor.execute(1, [] () -> void {}));
+
+    executor.start(2, 1);
+    std::atomic<int32_t> executedCount{0};
+    ASSERT_TRUE(executor.execute(1, [&executedCount] () -> void
+        {
+            ++ executedCount;
+        }));
+    executor.stop();
+    ASSERT_EQ(executedCount.load(), 1);
+
+    // the task is not queued to the stopped thread, so the caller completes it
+    ASSERT_FALSE(executor.execute(1, [&executedCount] () -> void
+        {
+            ++ executedCount;
+        }));
+    ASSERT_EQ(executedCount.load(), 1);
+}
+
+TEST(AsyncExecutor, StopRace)
+{
+    // every task is either executed or refused, none of them is lost
+    for (int32_t attempt = 0; attempt < 20; ++ attempt)
+    {
+        AsyncExecutor executor;
+        executor.start(2, 4);
+        std::atomic<int32_t> executedCount{0};
+        std::atomic<int32_t> refusedCount{0};
+        std::thread producer([&executor, &executedCount, &refusedCount] () -> void
+            {
+                for (int32_t i = 0; i < 1000; ++ i)
+                {
+                    if (!executor.execute(i, [&executedCount] () -> void
+                        {
+                            ++ executedCount;
+                        }))
+                    {
+                        ++ refusedCount;
+                    }
+                }
+            });
+        std::this_thread::yield();
+        executor.stop();
+        producer.join();
+        ASSERT_EQ(executedCount + refusedCount, 1000);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+#include <db/Future.h>
+
+using db::Future;
+using db::Promise;
+using common::Result;
+
+TEST(Future, Completed)
+{
+    Future<std::string> future(Result::SUCCESS, "value");
+    ASSERT_TRUE(future.isReady());
+
+    bool isCalled = false;
+    future.then([&isCalled] (const Result res, std::string&& value) -> void
+        {
+            ASSERT_EQ(res, Result::SUCCESS);
+            ASSERT_EQ(value, "value");
+            isCalled = true;
+        });
+    // inline
+    ASSERT_TRUE(isCalled);
+}
+
+TEST(Future, ContinuationBeforeCompletion)
+{
+    Promise<std::string> promise;
+    Future<std::string> future = promise.future();
+    ASSERT_FALSE(future.isReady());
+
+    std::string result;
+    future.then([&result] (const Result res, std::string&& value) -> void
+        {
+            ASSERT_EQ(res, Result::FAILED);
+            result = std::move(value);
+        });
+    ASSERT_TRUE(result.empty());
+
+    // called by the completing thread, the second completion is ignored
+    promise.set(Result::FAILED, "first");
+    promise.set(Result::SUCCESS, "second");
+    ASSERT_EQ(result, "first");
+}
+
+TEST(Future, CompletionBeforeContinuation)
+{
+    Promise<std::string> promise;
+    Future<std::string> future = promise.future();
+    promise.set(Result::SUCCESS, "value");
+    ASSERT_TRUE(future.isReady());
+
+    std::string result;
+    future.then([&result] (const Result, std::string&& value) -> void
+        {
+            result = std::move(value);
+        });
+    ASSERT_EQ(result, "value");
+}
+
+TEST(Future, Get)
+{
+    Promise<int64_t> promise;
+    Future<int64_t> future = promise.future();
+    std::thread thread([promise] () mutable -> void
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            promise.set(Result::SUCCESS, 42);
+        });
+
+    int64_t value = 0;
+    ASSERT_EQ(future.get(value), Result::SUCCESS);
+    ASSERT_EQ(value, 42);
+    thread.join();
+
+    Future<int64_t> completed(Result::USER_NOT_FOUND, 7);
+    ASSERT_EQ(completed.get(value), Result::USER_NOT_FOUND);
+    ASSERT_EQ(value, 7);
+}
+
+TEST(Future, DroppedPromise)
+{
+    Future<int64_t> future(Result::SUCCESS, 0);
+    {
+        Promise<int64_t> promise;
+        future = promise.future();
+        // the copy is held by the task which is never executed
+        Promise<int64_t> task = promise;
+        ASSERT_FALSE(future.isReady());
+    }
+
+    // the last copy completes the future, so the waiting caller is not blocked forever
+    int64_t value = 42;
+    ASSERT_EQ(future.get(value), Result::FAILED);
+    ASSERT_EQ(value, 0);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include <libconfig.h++>
+#include <gtest/gtest.h>
+
+#include <ctime>
+#include <map>
+#include <vector>
+
+#include <db/InMemoryStorage.h>
+
+#include "../fixtures/LoggerFixture.h"
+
+class InMemoryStorageFixture : public LoggerFixture
+{};
+
+using common::Result;
+
+TEST_F(InMemoryStorageFixture, StoreUserDeals)
+{
+    libconfig::Config cfg;
+    db::InMemoryStorage storage;
+    ASSERT_EQ(Result::SUCCESS, storage.configure(cfg));
+    ASSERT_EQ(Result::SUCCESS, storage.start());
+    ASSERT_EQ(Result::SUCCESS, storage.storeUser(1, "first"));
+    ASSERT_EQ(Result::SUCCESS, storage.storeUser(3, "third"));
+
+    // the unknown user fails its deal only
+    const std::time_t t = std::time(nullptr);
+    db::Deals deals;
+    deals.emplace_back(1, t, 10);
+    deals.emplace_back(2, t, 20);
+    deals.emplace_back(3, t, 30);
+    deals.emplace_back(1, t, 5);
+
+    std::vector<Result> results;
+    storage.storeUserDealsAsync(std::move(deals), [&results] (const std::vector<Result>& batchResults) -> void
+        {
+            results = batchResults;
+        });
+    ASSERT_EQ(results, std::vector<Result>({Result::SUCCESS, Result::USER_NOT_FOUND, Result::SUCCESS, Result::SUCCESS}));
+
+    db::Leaderboards leaderboards;
+    ASSERT_EQ(Result::SUCCESS, storage.getLeaderboards(leaderboards, 10, 0, 0));
+    std::map<int64_t, int64_t> scores;
+    for (auto&& scoreUser : leaderboards.begin()->second)
+    {
+        scores[scoreUser.second.m_id] = scoreUser.first.m_score;
+    }
+    ASSERT_EQ(scores, (std::map<int64_t, int64_t>({{1, 15}, {3, 30}})));
+    storage.stop();
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include <libconfig.h++>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <map>
+#include <memory>
+
+#include <db/TieredStorage.h>
+
+#include "../fixtures/LoggerFixture.h"
+
+using common::Result;
+
+namespace
+{
+// in-memory storage in place of MongoDB, it counts the writes and fails the first ones if it is asked
+class PersistentStorage : public db::InMemoryStorage
+{
+public:
+    std::atomic<int32_t> m_failuresCount{0};
+    // the registration is written, but the reply is lost
+    std::atomic<int32_t> m_lostRepliesCount{0};
+    // deals of the user always fail
+    std::atomic<int64_t> m_failedDealsId{0};
+    std::atomic<int32_t> m_usersCount{0};
+    std::atomic<int32_t> m_dealsCount{0};
+    std::atomic<int32_t> m_failedDealsCount{0};
+    std::atomic<int32_t> m_disconnectsCount{0};
+
+private:
+    bool fail()
+    {
+        int32_t failuresCount = m_failuresCount.load();
+        while (failuresCount > 0)
+        {
+            if (m_failuresCount.compare_exchange_weak(failuresCount, failuresCount - 1))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    virtual Result storeUser(const int64_t id, const std::string& name) override
+    {
+        ++ m_usersCount;
+        if (fail())
+        {
+            return Result::DB_ERROR;
+        }
+        const Result res = db::InMemoryStorage::storeUser(id, name);
+        if (m_lostRepliesCount > 0)
+        {
+            -- m_lostRepliesCount;
+            return Result::DB_ERROR;
+        }
+        return res;
+    }
+
+    virtual Result storeUserDeal(const int64_t id, const std::time_t t, const int64_t amount) override
+    {
+        if (id == m_failedDealsId)
+        {
+            ++ m_failedDealsCount;
+            return Result::DB_ERROR;
+        }
+        ++ m_dealsCount;
+        return fail() ? Result::DB_ERROR : db::InMemoryStorage::storeUserDeal(id, t, amount);
+    }
+
+    virtual Result removeConnectedUser(const int64_t id) override
+    {
+        ++ m_disconnectsCount;
+        return db::InMemoryStorage::removeConnectedUser(id);
+    }
+};
+
+std::map<int64_t, int64_t> scoresOf(db::Storage& storage)
+{
+    std::map<int64_t, int64_t> scores;
+    db::Leaderboards leaderboards;
+    if (Result::SUCCESS != storage.getLeaderboards(leaderboards, 10, 0, 0) || leaderboards.empty())
+    {
+        return scores;
+    }
+    for (auto&& scoreUser : leaderboards.begin()->second)
+    {
+        scores[scoreUser.second.m_id] = scoreUser.first.m_score;
+    }
+    return scores;
+}
+} // namespace
+
+class TieredStorageFixture : public LoggerFixture
+{
+protected:
+    libconfig::Config m_cfg;
+    PersistentStorage* m_persistent = nullptr;
+    std::unique_ptr<db::TieredStorage> m_storage;
+
+protected:
+    virtual void SetUp() override
+    {
+        LoggerFixture::SetUp();
+        m_persistent = new PersistentStorage();
+        m_storage.reset(new db::TieredStorage(
+            std::unique_ptr<db::InMemoryStorage>(new db::InMemoryStorage()),
+            std::unique_ptr<db::Storage>(m_persistent)));
+        ASSERT_EQ(Result::SUCCESS, m_storage->configure(m_cfg));
+    }
+
+    virtual void TearDown() override
+    {
+        m_storage.reset();
+        LoggerFixture::TearDown();
+    }
+};
+
+TEST_F(TieredStorageFixture, Coalescing)
+{
+    ASSERT_EQ(Result::SUCCESS, m_storage->start());
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUser(1, "first"));
+    const std::time_t t = std::time(nullptr);
+    for (int32_t i = 0; i < 100; ++ i)
+    {
+        ASSERT_EQ(Result::SUCCESS, m_storage->storeUserDeal(1, t, 1));
+    }
+    m_storage->stop();
+
+    // deals of the same time are merged, so the persistent storage gets fewer writes
+    ASSERT_LT(m_persistent->m_dealsCount.load(), 100);
+    ASSERT_EQ(scoresOf(*m_persistent), (std::map<int64_t, int64_t>({{1, 100}})));
+}
+
+TEST_F(TieredStorageFixture, FlushOnStop)
+{
+    ASSERT_EQ(Result::SUCCESS, m_storage->start());
+    const std::time_t t = std::time(nullptr);
+    for (int64_t id = 1; id <= 10; ++ id)
+    {
+        ASSERT_EQ(Result::SUCCESS, m_storage->storeUser(id, "user"));
+        ASSERT_EQ(Result::SUCCESS, m_storage->storeUserDeal(id, t, id * 10));
+    }
+    m_storage->stop();
+
+    std::map<int64_t, int64_t> expected;
+    for (int64_t id = 1; id <= 10; ++ id)
+    {
+        db::User user;
+        ASSERT_EQ(Result::SUCCESS, m_persistent->getUser(user, id));
+        expected[id] = id * 10;
+    }
+    ASSERT_EQ(scoresOf(*m_persistent), expected);
+
+    // nothing persists mutations after stop, so they are refused before the in-memory storage is changed
+    ASSERT_EQ(Result::INVALID_STATE, m_storage->storeUser(11, "late"));
+    db::User user;
+    ASSERT_EQ(Result::USER_NOT_FOUND, m_storage->getUser(user, 11));
+}
+
+TEST_F(TieredStorageFixture, FailureRetry)
+{
+    ASSERT_EQ(Result::SUCCESS, m_storage->start());
+    // the registration fails twice, the deal waits for it
+    m_persistent->m_failuresCount = 2;
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUser(1, "first"));
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUserDeal(1, std::time(nullptr), 10));
+    m_storage->stop();
+
+    ASSERT_EQ(m_persistent->m_usersCount.load(), 3);
+    ASSERT_EQ(m_persistent->m_dealsCount.load(), 1);
+    db::User user;
+    ASSERT_EQ(Result::SUCCESS, m_persistent->getUser(user, 1));
+    ASSERT_EQ(user.m_name, "first");
+    ASSERT_EQ(scoresOf(*m_persistent), (std::map<int64_t, int64_t>({{1, 10}})));
+}
+
+TEST_F(TieredStorageFixture, LostRegistrationReply)
+{
+    ASSERT_EQ(Result::SUCCESS, m_storage->start());
+    // the failed registration finds the user written by the attempt whose reply is lost, so it is not retried
+    m_persistent->m_lostRepliesCount = 1;
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUser(1, "first"));
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUserDeal(1, std::time(nullptr), 10));
+    m_storage->stop();
+
+    ASSERT_EQ(m_persistent->m_usersCount.load(), 1);
+    ASSERT_EQ(m_persistent->m_dealsCount.load(), 1);
+    ASSERT_EQ(scoresOf(*m_persistent), (std::map<int64_t, int64_t>({{1, 10}})));
+}
+
+TEST_F(TieredStorageFixture, CoalescedConnection)
+{
+    ASSERT_EQ(Result::SUCCESS, m_storage->start());
+    // connect and disconnect are merged into the disconnect of the user which is not persisted as connected
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUser(1, "first"));
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeConnectedUser(1));
+    ASSERT_EQ(Result::SUCCESS, m_storage->removeConnectedUser(1));
+    m_storage->stop();
+
+    ASSERT_EQ(m_persistent->m_disconnectsCount.load(), 1);
+    ASSERT_EQ(Result::USER_NOT_FOUND, m_persistent->removeConnectedUser(1));
+}
+
+TEST_F(TieredStorageFixture, FailedUserBackoff)
+{
+    using std::chrono::milliseconds;
+    using std::chrono::steady_clock;
+
+    ASSERT_EQ(Result::SUCCESS, m_storage->start());
+    const std::time_t t = std::time(nullptr);
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUser(1, "failed"));
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUser(2, "second"));
+    m_persistent->m_failedDealsId = 1;
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUserDeal(1, t, 10));
+
+    // the failed user waits for 100, 200, 400 and 800 ms
+    const steady_clock::time_point deadline = steady_clock::now() + std::chrono::seconds(10);
+    while (m_persistent->m_failedDealsCount < 5 && steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+    ASSERT_GE(m_persistent->m_failedDealsCount.load(), 5);
+
+    // the other user is flushed while the failed one backs off
+    const steady_clock::time_point start = steady_clock::now();
+    ASSERT_EQ(Result::SUCCESS, m_storage->storeUserDeal(2, t, 20));
+    while (m_persistent->m_dealsCount < 1 && steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+    ASSERT_EQ(m_persistent->m_dealsCount.load(), 1);
+    ASSERT_LT(steady_clock::now() - start, milliseconds(1000));
+
+    m_storage->stop();
+    // the failed user is retried at once after stop, it is dropped after max-retries
+    ASSERT_EQ(m_persistent->m_failedDealsCount.load(), 11);
+    ASSERT_EQ(scoresOf(*m_persistent), (std::map<int64_t, int64_t>({{1, 0}, {2, 20}})));
+}
\ No newline at end of file
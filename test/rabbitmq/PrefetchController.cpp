@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <rabbitmq/PrefetchController.h>
+
+namespace
+{
+// feeds one adjustment period of the same latency
+bool addSamples(rabbitmq::PrefetchController& controller, const int64_t latencyUs)
+{
+    bool isChanged = false;
+    for (uint32_t i = 0, count = controller.prefetch(); i < count; ++ i)
+    {
+        isChanged = controller.addSample(latencyUs);
+    }
+    return isChanged;
+}
+} // namespace
+
+TEST(PrefetchController, Bounds)
+{
+    rabbitmq::PrefetchController controller(16, 1000, 100000);
+    ASSERT_EQ(controller.prefetch(), 1000);
+
+    // slow processing decreases prefetch down to min
+    ASSERT_TRUE(addSamples(controller, 500000));
+    ASSERT_EQ(controller.prefetch(), 750);
+    for (int i = 0; i < 100; ++ i)
+    {
+        addSamples(controller, 500000);
+    }
+    ASSERT_EQ(controller.prefetch(), 16);
+    ASSERT_FALSE(addSamples(controller, 500000));
+
+    // fast processing increases it up to max
+    for (int i = 0; i < 100; ++ i)
+    {
+        addSamples(controller, 1000);
+    }
+    ASSERT_EQ(controller.prefetch(), 1000);
+    ASSERT_FALSE(addSamples(controller, 1000));
+}
+
+TEST(PrefetchController, Smoothing)
+{
+    rabbitmq::PrefetchController controller(1, 8, 100);
+    ASSERT_EQ(controller.prefetch(), 8);
+
+    // a single spike does not change the average much
+    for (int i = 0; i < 7; ++ i)
+    {
+        ASSERT_FALSE(controller.addSample(10));
+    }
+    ASSERT_FALSE(controller.addSample(200));
+    ASSERT_DOUBLE_EQ(controller.averageLatency(), 10 + 0.2 * 190);
+    ASSERT_EQ(controller.prefetch(), 8);
+}
\ No newline at end of file
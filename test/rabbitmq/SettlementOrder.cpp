@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <rabbitmq/SettlementOrder.h>
+
+TEST(SettlementOrder, InOrder)
+{
+    rabbitmq::SettlementOrder order(16);
+
+    // consecutive acks are coalesced into the last tag
+    ASSERT_FALSE(order.settle(1, true));
+    ASSERT_FALSE(order.settle(2, true));
+    ASSERT_FALSE(order.settle(3, true));
+    ASSERT_EQ(order.settledTag(), 3);
+    ASSERT_EQ(order.takeAckTag(), 3);
+    ASSERT_EQ(order.takeAckTag(), 0);
+
+    // the rejected delivery does not move the ack tag
+    ASSERT_FALSE(order.settle(4, true));
+    ASSERT_FALSE(order.settle(5, false));
+    ASSERT_EQ(order.settledTag(), 5);
+    ASSERT_EQ(order.takeAckTag(), 4);
+
+    // rejects only are not acked
+    ASSERT_FALSE(order.settle(6, false));
+    ASSERT_EQ(order.takeAckTag(), 0);
+    ASSERT_EQ(order.outOfOrderCount(), 0);
+}
+
+TEST(SettlementOrder, OutOfOrderWithReject)
+{
+    rabbitmq::SettlementOrder order(16);
+
+    // nothing is acked until the first delivery is settled
+    ASSERT_FALSE(order.settle(2, true));
+    ASSERT_FALSE(order.settle(4, false));
+    ASSERT_FALSE(order.settle(3, true));
+    ASSERT_EQ(order.settledTag(), 0);
+    ASSERT_EQ(order.ackTag(), 0);
+    ASSERT_EQ(order.outOfOrderCount(), 3);
+
+    // the range is settled, the rejected last delivery is not covered by the ack
+    ASSERT_FALSE(order.settle(1, true));
+    ASSERT_EQ(order.settledTag(), 4);
+    ASSERT_EQ(order.outOfOrderCount(), 0);
+    ASSERT_EQ(order.takeAckTag(), 3);
+
+    // the rejected first delivery is skipped by the ack of the following ones
+    ASSERT_FALSE(order.settle(6, true));
+    ASSERT_FALSE(order.settle(5, false));
+    ASSERT_EQ(order.settledTag(), 6);
+    ASSERT_EQ(order.takeAckTag(), 6);
+
+    // settled deliveries are ignored
+    ASSERT_FALSE(order.settle(3, true));
+    ASSERT_FALSE(order.settle(6, true));
+    ASSERT_EQ(order.outOfOrderCount(), 0);
+    ASSERT_EQ(order.ackTag(), 0);
+}
+
+TEST(SettlementOrder, Close)
+{
+    rabbitmq::SettlementOrder order(16);
+
+    // the acknowledger flushes the pending ack on close, out of order deliveries are left unacked
+    ASSERT_FALSE(order.settle(1, true));
+    ASSERT_FALSE(order.settle(2, true));
+    ASSERT_FALSE(order.settle(4, true));
+    ASSERT_EQ(order.takeAckTag(), 2);
+    ASSERT_EQ(order.outOfOrderCount(), 1);
+    ASSERT_EQ(order.takeAckTag(), 0);
+}
+
+TEST(SettlementOrder, GapExceeded)
+{
+    rabbitmq::SettlementOrder order(4);
+
+    ASSERT_FALSE(order.settle(2, false));
+    ASSERT_FALSE(order.settle(4, true));
+    // the first delivery is stuck, it is reported once
+    ASSERT_TRUE(order.settle(5, false));
+    ASSERT_FALSE(order.settle(7, true));
+    ASSERT_EQ(order.outOfOrderCount(), 4);
+
+    ASSERT_FALSE(order.settle(1, true));
+    ASSERT_EQ(order.settledTag(), 2);
+    ASSERT_EQ(order.takeAckTag(), 1);
+
+    // the next stuck delivery is reported again
+    ASSERT_TRUE(order.settle(8, true));
+    ASSERT_FALSE(order.settle(3, true));
+    ASSERT_FALSE(order.settle(6, true));
+    ASSERT_EQ(order.settledTag(), 8);
+    ASSERT_EQ(order.takeAckTag(), 8);
+    ASSERT_EQ(order.outOfOrderCount(), 0);
+}
\ No newline at end of file